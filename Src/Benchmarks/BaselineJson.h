@@ -0,0 +1,14 @@
+
+#pragma once
+
+#include <nstd/Variant.h>
+
+/**
+* The Variant parser of Json before the pull parser was added. It is kept unchanged as the baseline of the benchmark.
+*/
+class BaselineJson
+{
+public:
+  static bool_t parse(const tchar_t* data, Variant& result);
+  static bool_t parse(const String& data, Variant& result);
+};
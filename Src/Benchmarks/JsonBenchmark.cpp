@@ -0,0 +1,206 @@
+
+#include <nstd/Console.h>
+#include <nstd/String.h>
+#include <nstd/Buffer.h>
+#include <nstd/Variant.h>
+#include <nstd/Time.h>
+
+#include "Tools/Json.h"
+
+#include "BaselineJson.h"
+
+#ifdef __GLIBC__
+
+#include <cstddef>
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+static size_t allocations = 0;
+
+// count the heap allocations by interposing the allocation functions of the c library
+extern "C" void* malloc(size_t size) {++allocations; return __libc_malloc(size);}
+extern "C" void* calloc(size_t count, size_t size) {++allocations; return __libc_calloc(count, size);}
+extern "C" void* realloc(void* ptr, size_t size) {++allocations; return __libc_realloc(ptr, size);}
+
+#define ALLOCATIONS_COUNTED true
+
+#else
+
+static size_t allocations = 0;
+
+#define ALLOCATIONS_COUNTED false
+
+#endif
+
+/**
+* A trade message of the Bitstamp websocket stream. The trade is a JSON document encoded as a string.
+*/
+static const char_t* bitstampPayload = "{\"event\": \"trade\", \"channel\": \"live_trades\", \"data\": \"{\\\"buy_order_id\\\": 1045396736, "
+  "\\\"timestamp\\\": \\\"1461080932\\\", \\\"price\\\": 431.05, \\\"amount\\\": 0.81230215, \\\"id\\\": 11056413, \\\"type\\\": 0, "
+  "\\\"sell_order_id\\\": 1045396709, \\\"price_str\\\": \\\"431.05\\\", \\\"amount_str\\\": \\\"0.81230215\\\"}\"}";
+
+/**
+* A response of the Kraken trades api.
+*/
+static const char_t* krakenPayload = "{\"error\":[],\"result\":{\"XXBTZUSD\":["
+  "[\"431.04100\",\"0.01210000\",1461080921.4398,\"s\",\"l\",\"\"],"
+  "[\"431.04100\",\"0.50000000\",1461080921.4441,\"s\",\"l\",\"\"],"
+  "[\"431.10000\",\"1.29000000\",1461080925.1712,\"b\",\"m\",\"\"],"
+  "[\"431.10000\",\"0.03370000\",1461080925.2216,\"b\",\"l\",\"\"],"
+  "[\"431.20000\",\"0.12500000\",1461080927.9807,\"b\",\"l\",\"\"],"
+  "[\"431.08900\",\"2.00000000\",1461080931.0042,\"s\",\"m\",\"\"],"
+  "[\"431.05000\",\"0.00890000\",1461080932.7713,\"s\",\"l\",\"\"],"
+  "[\"431.05000\",\"3.46211200\",1461080932.7759,\"s\",\"l\",\"\"],"
+  "[\"430.99900\",\"0.40000000\",1461080936.0811,\"s\",\"l\",\"\"],"
+  "[\"431.00000\",\"0.01000000\",1461080940.5513,\"b\",\"l\",\"\"]"
+  "],\"last\":\"1461080940551362546\"}}";
+
+static double sum = 0.; // keeps the results of the parsers alive
+
+/**
+* Parses a Bitstamp message into a Variant tree with BaselineJson or Json.
+*/
+template<class J> static void_t parseBitstampDom(tchar_t* data, size_t length)
+{
+  Variant message, trade;
+  if(!J::parse(data, message))
+    return;
+  const HashMap<String, Variant>& messageMap = message.toMap();
+  if(messageMap.find("event")->toString() != "trade" || !J::parse(messageMap.find("data")->toString(), trade))
+    return;
+  const HashMap<String, Variant>& tradeMap = trade.toMap();
+  sum += tradeMap.find("id")->toUInt64() + tradeMap.find("price")->toDouble() + tradeMap.find("amount")->toDouble();
+}
+
+static void_t parseBitstampPull(tchar_t* data, size_t length)
+{
+  Json::Parser parser(data, length);
+  static String key, event; // kept across messages like the members of the market adapter
+  tchar_t* tradeData = 0;
+  size_t tradeDataLength = 0;
+  if(parser.beginObject())
+    while(parser.nextMember(key))
+    {
+      if(key == "event")
+        parser.readString(event);
+      else if(key == "data")
+        parser.readStringInPlace(tradeData, tradeDataLength);
+      else
+        parser.skipValue();
+    }
+  if(parser.hasError() || event != "trade")
+    return;
+  Json::Parser tradeParser(tradeData, tradeDataLength);
+  uint64_t id = 0;
+  double price = 0., amount = 0.;
+  if(tradeParser.beginObject())
+    while(tradeParser.nextMember(key))
+    {
+      if(key == "id")
+        tradeParser.readUInt64(id);
+      else if(key == "price")
+        tradeParser.readDouble(price);
+      else if(key == "amount")
+        tradeParser.readDouble(amount);
+      else
+        tradeParser.skipValue();
+    }
+  sum += id + price + amount;
+}
+
+/**
+* Parses a Kraken response into a Variant tree with BaselineJson or Json.
+*/
+template<class J> static void_t parseKrakenDom(tchar_t* data, size_t length)
+{
+  Variant message;
+  if(!J::parse(data, message))
+    return;
+  const List<Variant>& trades = message.toMap().find("result")->toMap().find("XXBTZUSD")->toList();
+  for(List<Variant>::Iterator i = trades.begin(), end = trades.end(); i != end; ++i)
+  {
+    const List<Variant>& trade = i->toList();
+    List<Variant>::Iterator j = trade.begin();
+    double price = j->toDouble();
+    double amount = (++j)->toDouble();
+    sum += price + amount + (++j)->toDouble();
+  }
+}
+
+static void_t parseKrakenPull(tchar_t* data, size_t length)
+{
+  Json::Parser parser(data, length);
+  static String key; // kept across messages like the member of the market adapter
+  if(parser.beginObject())
+    while(parser.nextMember(key))
+    {
+      if(key != "result" || !parser.beginObject())
+      {
+        parser.skipValue();
+        continue;
+      }
+      while(parser.nextMember(key))
+      {
+        if(key != "XXBTZUSD" || !parser.beginArray())
+        {
+          parser.skipValue();
+          continue;
+        }
+        while(parser.nextElement() && parser.beginArray())
+        {
+          double values[3] = {};
+          for(size_t index = 0; parser.nextElement(); ++index)
+            if(index < 3)
+              parser.readDouble(values[index]);
+            else
+              parser.skipValue();
+          sum += values[0] + values[1] + values[2];
+        }
+      }
+    }
+}
+
+/**
+* Runs a parser on a payload and prints the throughput and the heap allocations per message.
+*/
+static void_t run(const char_t* name, const char_t* payloadData, void_t (*parse)(tchar_t* data, size_t length))
+{
+  static const uint_t iterations = 200000;
+  size_t payloadSize = String::length(payloadData);
+
+  // every message is copied to a buffer like the websocket does with received frames. the copy includes the
+  // terminating null character, since the baseline parser depends on it.
+  Buffer message;
+  message.resize(payloadSize + 1);
+  int64_t start = Time::microTicks();
+  size_t startAllocations = allocations;
+  for(uint_t i = 0; i < iterations; ++i)
+  {
+    Memory::copy((byte_t*)message, payloadData, payloadSize + 1);
+    parse((tchar_t*)(byte_t*)message, payloadSize);
+  }
+  size_t messageAllocations = allocations - startAllocations;
+  int64_t duration = Time::microTicks() - start;
+  if(duration <= 0)
+    duration = 1;
+
+  double seconds = (double)duration / 1000000.;
+  Console::printf("%-18s %10.0f messages/s %8.1f MB/s", name, iterations / seconds, iterations * (double)payloadSize / seconds / 1000000.);
+  if(ALLOCATIONS_COUNTED)
+    Console::printf(" %6.1f allocations/message\n", (double)messageAllocations / iterations);
+  else
+    Console::printf("\n");
+}
+
+int_t main(int_t argc, char_t* argv[])
+{
+  run("Bitstamp baseline", bitstampPayload, parseBitstampDom<BaselineJson>);
+  run("Bitstamp DOM", bitstampPayload, parseBitstampDom<Json>);
+  run("Bitstamp pull", bitstampPayload, parseBitstampPull);
+  run("Kraken baseline", krakenPayload, parseKrakenDom<BaselineJson>);
+  run("Kraken DOM", krakenPayload, parseKrakenDom<Json>);
+  run("Kraken pull", krakenPayload, parseKrakenPull);
+  return sum == 0. ? 1 : 0;
+}
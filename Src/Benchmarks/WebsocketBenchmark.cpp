@@ -0,0 +1,233 @@
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cstring>
+
+#include <nstd/Console.h>
+#include <nstd/String.h>
+#include <nstd/Buffer.h>
+#include <nstd/Thread.h>
+#include <nstd/Time.h>
+
+#include "Tools/Websocket.h"
+
+#ifdef __GLIBC__
+
+#include <cstddef>
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+static size_t allocations = 0;
+
+// count the heap allocations by interposing the allocation functions of the c library
+extern "C" void* malloc(size_t size) {++allocations; return __libc_malloc(size);}
+extern "C" void* calloc(size_t count, size_t size) {++allocations; return __libc_calloc(count, size);}
+extern "C" void* realloc(void* ptr, size_t size) {++allocations; return __libc_realloc(ptr, size);}
+
+#define ALLOCATIONS_COUNTED true
+
+#else
+
+static size_t allocations = 0;
+
+#define ALLOCATIONS_COUNTED false
+
+#endif
+
+/**
+* A trade message of the Bitstamp websocket stream.
+*/
+static const char_t* bitstampPayload = "{\"event\": \"trade\", \"channel\": \"live_trades\", \"data\": \"{\\\"buy_order_id\\\": 1045396736, "
+  "\\\"timestamp\\\": \\\"1461080932\\\", \\\"price\\\": 431.05, \\\"amount\\\": 0.81230215, \\\"id\\\": 11056413, \\\"type\\\": 0, "
+  "\\\"sell_order_id\\\": 1045396709, \\\"price_str\\\": \\\"431.05\\\", \\\"amount_str\\\": \\\"0.81230215\\\"}\"}";
+
+/**
+* A websocket server on the loopback interface that sends every received byte back. The client does not mask its
+* frames, so the echoed frames are valid server frames.
+*/
+class EchoServer
+{
+public:
+  EchoServer() : listenSocket(-1), port(0) {}
+
+  ~EchoServer()
+  {
+    if(listenSocket >= 0)
+    {
+      ::shutdown(listenSocket, SHUT_RDWR);
+      ::close(listenSocket);
+    }
+    thread.join();
+  }
+
+  bool_t start()
+  {
+    listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if(listenSocket < 0)
+      return false;
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addressSize = sizeof(address);
+    if(bind(listenSocket, (sockaddr*)&address, sizeof(address)) != 0 || listen(listenSocket, 4) != 0 ||
+       getsockname(listenSocket, (sockaddr*)&address, &addressSize) != 0)
+      return false;
+    port = ntohs(address.sin_port);
+    return thread.start(proc, this);
+  }
+
+  uint16_t getPort() const {return port;}
+
+private:
+  int_t listenSocket;
+  uint16_t port;
+  Thread thread;
+
+private:
+  static uint_t proc(void_t* param) {return ((EchoServer*)param)->proc();}
+
+  uint_t proc()
+  {
+    for(int_t s; (s = accept(listenSocket, 0, 0)) >= 0;)
+    {
+      int_t noDelay = 1;
+      setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+      handleConnection(s);
+      ::close(s);
+    }
+    return 0;
+  }
+
+  void_t handleConnection(int_t s)
+  {
+    // read the upgrade request and accept it with the response for the fixed key of the client
+    char_t buffer[4500];
+    size_t size = 0;
+    for(;;)
+    {
+      ssize_t received = ::recv(s, buffer + size, sizeof(buffer) - 1 - size, 0);
+      if(received <= 0)
+        return;
+      size += received;
+      buffer[size] = '\0';
+      if(strstr(buffer, "\r\n\r\n"))
+        break;
+      if(size == sizeof(buffer) - 1)
+        return;
+    }
+    static const char_t* response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+      "Sec-WebSocket-Accept: HSmrc0sMlYUkAGmm5OPpG2HaGWk=\r\n\r\n";
+    if(!sendAll(s, response, strlen(response)))
+      return;
+
+    // echo the frames
+    for(ssize_t received; (received = ::recv(s, buffer, sizeof(buffer), 0)) > 0;)
+      if(!sendAll(s, buffer, received))
+        return;
+  }
+
+  static bool_t sendAll(int_t s, const char_t* data, size_t size)
+  {
+    while(size > 0)
+    {
+      ssize_t sent = ::send(s, data, size, MSG_NOSIGNAL);
+      if(sent <= 0)
+        return false;
+      data += sent;
+      size -= sent;
+    }
+    return true;
+  }
+};
+
+/**
+* Sends batches of messages to the echo server and receives the echoed messages either by copying them into a
+* buffer or in place. Prints the throughput and the heap allocations per message.
+*/
+static bool_t run(const char_t* name, uint16_t port, bool_t inPlace)
+{
+  static const uint_t batches = 2000;
+  static const uint_t batchSize = 50;
+  size_t payloadSize = String::length(bitstampPayload);
+
+  Websocket websocket;
+  String url;
+  url.printf("ws://127.0.0.1:%hu/", port);
+  if(!websocket.connect(url))
+  {
+    Console::errorf("Could not connect to echo server: %s\n", (const char_t*)websocket.getErrorString());
+    return false;
+  }
+
+  Buffer buffer;
+  size_t bytes = 0;
+  int64_t start = Time::microTicks();
+  size_t startAllocations = allocations;
+  for(uint_t i = 0; i < batches; ++i)
+  {
+    for(uint_t j = 0; j < batchSize; ++j)
+      if(!websocket.send((const byte_t*)bitstampPayload, payloadSize))
+        return false;
+    for(uint_t j = 0; j < batchSize;)
+    {
+      if(inPlace)
+      {
+        byte_t* data;
+        size_t size;
+        if(!websocket.recv(data, size, 1000))
+          return false;
+        if(!data)
+          continue;
+        bytes += size;
+      }
+      else
+      {
+        if(!websocket.recv(buffer, 1000))
+          return false;
+        if(buffer.isEmpty())
+          continue;
+        bytes += buffer.size();
+      }
+      ++j;
+    }
+  }
+  size_t messageAllocations = allocations - startAllocations;
+  int64_t duration = Time::microTicks() - start;
+  if(duration <= 0)
+    duration = 1;
+  websocket.close();
+  if(bytes != (size_t)batches * batchSize * payloadSize)
+  {
+    Console::errorf("Received %u bytes instead of %u.\n", (uint_t)bytes, (uint_t)(batches * batchSize * payloadSize));
+    return false;
+  }
+
+  uint_t messages = batches * batchSize;
+  double seconds = (double)duration / 1000000.;
+  Console::printf("%-16s %10.0f messages/s %8.1f MB/s", name, messages / seconds, bytes / seconds / 1000000.);
+  if(ALLOCATIONS_COUNTED)
+    Console::printf(" %6.1f allocations/message\n", (double)messageAllocations / messages);
+  else
+    Console::printf("\n");
+  return true;
+}
+
+int_t main(int_t argc, char_t* argv[])
+{
+  EchoServer server;
+  if(!server.start())
+  {
+    Console::errorf("Could not start echo server.\n");
+    return 1;
+  }
+  if(!run("Echo copy", server.getPort(), false) ||
+     !run("Echo in place", server.getPort(), true))
+    return 1;
+  return 0;
+}
@@ -16,7 +16,7 @@
 #define DEFAULT_SELL_MIN_PRICE_SHIFT 0.01
 #define DEFAULT_MIN_BET 7.
 
-BetBot::Session::Session(Broker& broker) : broker(broker), buyInOrderId(0), sellInOrderId(0), lastBuyInTime(0), lastSellInTime(0), lastAssetBuyTime(0), lastAssetSellTime(0)
+BetBot::Session::Session(Broker& broker) : broker(broker), buyInOrderId(0), sellInOrderId(0), lastBuyInTime(0), lastSellInTime(0), lastAssetBuyTime(0), lastAssetSellTime(0), tradeHandler(TradeHandler::getMaxRawTradeAge() / 1000)
 {
   broker.registerProperty("Buy Profit Gain", DEFAULT_BUY_PROFIT_GAIN);
   broker.registerProperty("Sell Profit Gain", DEFAULT_SELL_PROFIT_GAIN);
@@ -16,7 +16,7 @@
 #define DEFAULT_SELL_PRICE_DROP 6.
 #define DEFAULT_SELL_PRICE_RISE 6.
 
-BetBot2::Session::Session(Broker& broker) : broker(broker), buyInOrderId(0), sellInOrderId(0), lastBuyInTime(0), lastSellInTime(0), lastAssetBuyTime(0), lastAssetSellTime(0)
+BetBot2::Session::Session(Broker& broker) : broker(broker), buyInOrderId(0), sellInOrderId(0), lastBuyInTime(0), lastSellInTime(0), lastAssetBuyTime(0), lastAssetSellTime(0), tradeHandler(TradeHandler::getMaxRawTradeAge() / 1000)
 {
   buyInState = idle;
   sellInState = idle;
@@ -66,6 +66,7 @@ private:
 
   private: // Bot::Session
     virtual void_t handleTrade(const Trade& trade, int64_t tradeAge);
+    virtual void_t handleCandle(const CandleEntity& candle, int64_t candleAge) {tradeHandler.addCandle(candle, candleAge);}
     virtual void_t handleBuy(uint64_t orderId, const Transaction& transaction);
     virtual void_t handleSell(uint64_t orderId, const Transaction& transaction);
     virtual void_t handleBuyTimeout(uint64_t orderId);
@@ -78,4 +79,5 @@ private:
 public: // Bot
   virtual Session* createSession(Broker& broker) {return new Session(broker);};
   virtual int64_t getMaxTradeAge() const {return TradeHandler::getMaxTradeAge();}
+  virtual int64_t getMaxRawTradeAge() const {return TradeHandler::getMaxRawTradeAge();}
 };
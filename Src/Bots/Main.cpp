@@ -3,42 +3,105 @@
 #include <nstd/Log.h>
 #include <nstd/Thread.h>
 #include <nstd/Time.h>
+#include <nstd/Process.h>
+#include <nstd/Array.h>
 #include <zlimdbprotocol.h>
 #include <megucoprotocol.h>
 
+#include "Tools/Candle.h"
 #include "Tools/Broker.h"
 #include "Tools/SimBroker.h"
 #include "Tools/LiveBroker.h"
+#include "Tools/Host.h"
 
 #include "Main.h"
 
 int_t main(int_t argc, char_t* argv[])
 {
-  if(argc < 3)
+  uint_t threads = 1;
+  List<String> sessionArgs;
+
+  // parse parameters
+  {
+    Process::Option options[] = {
+        {'t', "threads", Process::argumentFlag},
+        {'s', "simulation", Process::optionFlag},
+        {'h', "help", Process::optionFlag},
+    };
+    Process::Arguments arguments(argc, argv, options);
+    int_t character;
+    String argument;
+    while(arguments.read(character, argument))
+      switch(character)
+      {
+      case 't':
+        threads = argument.toUInt();
+        if(threads < 1)
+          threads = 1;
+        break;
+      case 's':
+        break;
+      case '\0':
+        sessionArgs.append(argument);
+        break;
+      case '?':
+        Console::errorf("Unknown option: %s.\n", (const char_t*)argument);
+        return -1;
+      case ':':
+        Console::errorf("Option %s required an argument.\n", (const char_t*)argument);
+        return -1;
+      default:
+        Console::errorf("Usage: %s [-t <count>] [-s] <user> <session> [<user> <session> ...]\n\
+  -t, --threads=<count>   Run the sessions in <count> worker threads. (default is 1)\n\
+  -s, --simulation        Mark the process as a simulation. The server runs it\n\
+                          with idle priority.\n", argv[0]);
+        return -1;
+      }
+  }
+  if(sessionArgs.isEmpty() || sessionArgs.size() % 2 != 0)
   {
     Console::errorf("error: Missing session attributes\n");
     return -1;
   }
-  String userName(argv[1], String::length(argv[1]));
-  uint64_t sessionId = String::toUInt64(argv[2]);
 
   Log::setFormat("%P> %m");
 
   //bool stop = true;
   //while(stop);
 
-  Main main;
+  // distribute the sessions among the hosts
+  size_t sessionCount = sessionArgs.size() / 2;
+  if(threads > sessionCount)
+    threads = (uint_t)sessionCount;
+  Array<Host*> hosts;
+  hosts.resize(threads);
+  for(uint_t i = 0; i < threads; ++i)
+    hosts[i] = new Host(i);
+  uint_t hostIndex = 0;
+  for(List<String>::Iterator i = sessionArgs.begin(), end = sessionArgs.end(); i != end; hostIndex = (hostIndex + 1) % threads)
+  {
+    const String& userName = *i;
+    uint64_t sessionId = (++i)->toUInt64();
+    ++i;
+    hosts[hostIndex]->addSession(userName, sessionId);
+  }
+  for(uint_t i = 1; i < threads; ++i)
+    if(!hosts[i]->start())
+      Log::errorf("Could not start worker thread %u.", i);
+
+  // main loop
+  Host& host = *hosts[0];
   for(;; Thread::sleep(10 * 1000))
   {
-    if(!main.connect(userName, sessionId))
+    if(!host.connect())
     {
-      Log::errorf("error: Could not connect to zlimdb server: %s", (const tchar_t*)main.getErrorString());
+      Log::errorf("error: Could not connect to zlimdb server: %s", (const tchar_t*)host.getErrorString());
       continue;
     }
     Log::infof("Connected to zlimdb server.");
 
-    main.process();
-    Log::errorf("Lost connection to zlimdb server: %s", (const char_t*)main.getErrorString());
+    host.process();
+    Log::errorf("Lost connection to zlimdb server: %s", (const char_t*)host.getErrorString());
   }
 
   return 0;
@@ -60,20 +123,17 @@ typedef FlipBot BotFactory;
 typedef TestBot BotFactory;
 #endif
 
-Main::~Main() {delete broker;}
+Main::Main(Host& host) : host(host), connection(host.getConnection()), brokerLatency(host.getBrokerLatency()), sessionLatency(host.getSessionLatency()),
+  broker(0), botSession(0), lastReceivedTradeId(0), sessionTableId(0) {}
 
-bool_t Main::connect(const String& userName, uint64_t sessionId)
+Main::~Main()
 {
-  // close current connections
-  delete broker;
-  broker = 0;
   delete botSession;
-  botSession = 0;
-
-  // create session entity connection
-  if(!connection.connect(*this))
-    return false;
+  delete broker;
+}
 
+bool_t Main::connect(const String& userName, uint64_t sessionId)
+{
   // subscribe to user session table
   String tablePrefix = String("users/") + userName + "/sessions/" + String::fromUInt64(sessionId);
   if(!connection.createTable(tablePrefix + "/session", sessionTableId))
@@ -145,6 +205,7 @@ bool_t Main::connect(const String& userName, uint64_t sessionId)
   // create local broker interface
   BotFactory botFactory;
   maxTradeAge = botFactory.getMaxTradeAge();
+  int64_t maxRawTradeAge = botFactory.getMaxRawTradeAge();
   if(simulation)
   {
     // get broker balance
@@ -236,16 +297,38 @@ bool_t Main::connect(const String& userName, uint64_t sessionId)
   int64_t serverTime, tableTime;
   if(!connection.sync(tradesTableId, serverTime, tableTime))
     return false;
-  if(!connection.subscribe(tradesTableId, zlimdb_query_type_since_time, tableTime - (simulation ? (7ULL * 24ULL * 60ULL * 60ULL * 1000ULL) : (maxTradeAge + 10 * 60 * 1000)), zlimdb_subscribe_flag_none))
-    return false;
-  while(connection.getResponse(buffer))
+  int64_t historyStart = tableTime - (simulation ? (7ULL * 24ULL * 60ULL * 60ULL * 1000ULL) : (maxTradeAge + 10 * 60 * 1000));
+  int64_t tradesStart = historyStart;
+
+  // replay the older part of the history from the one minute candles
+  if(maxRawTradeAge < maxTradeAge)
   {
-    for(const meguco_trade_entity* trade = (const meguco_trade_entity*)zlimdb_get_first_entity((const zlimdb_header*)buffer, sizeof(meguco_trade_entity));
-      trade;
-      trade = (const meguco_trade_entity*)zlimdb_get_next_entity((const zlimdb_header*)buffer, sizeof(meguco_trade_entity), &trade->entity))
-      broker->handleTrade(*botSession, *trade, true);
+    int64_t warmupEnd = simulation ? historyStart + maxTradeAge : tableTime;
+    int64_t candlesEnd = warmupEnd - maxRawTradeAge - 10 * 60 * 1000;
+    candlesEnd -= candlesEnd % (60 * 1000);
+    uint32_t candlesTableId;
+    if(candlesEnd > historyStart && connection.findTable(String("markets/") + marketName + "/candles/1m", candlesTableId))
+    {
+      if(!connection.query(candlesTableId, zlimdb_query_type_since_time, historyStart))
+        return false;
+      while(connection.getResponse(buffer))
+      {
+        for(const CandleEntity* candle = (const CandleEntity*)zlimdb_get_first_entity((const zlimdb_header*)buffer, sizeof(CandleEntity));
+          candle;
+          candle = (const CandleEntity*)zlimdb_get_next_entity((const zlimdb_header*)buffer, sizeof(CandleEntity), &candle->entity))
+          if((int64_t)candle->entity.time < candlesEnd)
+            broker->handleCandle(*botSession, *candle);
+      }
+      if(connection.getErrno() != 0)
+        return false;
+      tradesStart = candlesEnd;
+    }
+    else if(connection.getErrno() != 0 && connection.getErrno() != zlimdb_error_table_not_found)
+      return false;
   }
-  if(connection.getErrno() != 0)
+
+  // replay the recent trades and receive new trades through the subscription of the host
+  if(!host.subscribeTrades(*this, marketName, tradesTableId, tradesStart))
     return false;
 
   if(simulation)
@@ -426,23 +509,20 @@ bool_t Main::addLogMessage(int64_t time, const String& message)
   return true;
 }
 
-void_t Main::controlEntity(uint32_t tableId, uint32_t requestId, uint64_t entityId, uint32_t controlCode, const byte_t* data, size_t size)
-{
-  if(tableId == sessionTableId)
-    return controlUserSession(requestId, entityId, controlCode, data, size);
-  else
-    return (void_t)connection.sendControlResponse(requestId, zlimdb_error_invalid_request);
-}
-
-void_t Main::addedEntity(uint32_t tableId, const zlimdb_entity& entity)
+void_t Main::handleTrade(const Bot::Trade& trade, bool_t replayed)
 {
-  if(tableId == tradesTableId)
+  // a session that joined a running subscription may receive a trade of its history again
+  if(trade.id <= lastReceivedTradeId)
+    return;
+  lastReceivedTradeId = trade.id;
+  if(replayed)
   {
-    if(entity.size < sizeof(meguco_trade_entity))
-      return;
-    const meguco_trade_entity* trade = (const meguco_trade_entity*)&entity;
-    broker->handleTrade(*botSession, *trade, false);
+    broker->handleTrade(*botSession, trade, true);
+    return;
   }
+  int64_t start = Time::microTicks();
+  broker->handleTrade(*botSession, trade, false);
+  brokerLatency.add(Time::microTicks() - start);
 }
 
 void_t Main::controlUserSession(uint32_t requestId, uint64_t entityId, uint32_t controlCode, const byte_t* data, size_t size)
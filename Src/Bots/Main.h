@@ -5,19 +5,29 @@
 
 #include "Tools/ZlimdbConnection.h"
 #include "Tools/Bot.h"
+#include "Tools/Stats.h"
 
 class Broker;
+class Host;
 
-class Main : public ZlimdbConnection::Callback
+/**
+* The connection handler of one bot session. It loads the session from its tables and stores the changes the bot
+* makes. The zlimdb connection and the trades of the market are provided by the host that runs the session.
+*/
+class Main
 {
 public:
-  Main() : broker(0), botSession(0), lastReceivedTradeId(0) {}
+  Main(Host& host);
   ~Main();
 
   bool_t connect(const String& userName, uint64_t sessionId);
-  bool_t process() {return connection.process();}
   String getErrorString() {return connection.getErrorString();}
 
+  uint32_t getSessionTableId() const {return sessionTableId;}
+
+  void_t handleTrade(const Bot::Trade& trade, bool_t replayed);
+  void_t controlUserSession(uint32_t requestId, uint64_t entityId, uint32_t controlCode, const byte_t* data, size_t size);
+
   bool_t getBrokerBalance(meguco_user_broker_balance_entity& balance);
   bool_t getBrokerOrders(List<meguco_user_broker_order_entity>& orders);
   bool_t createBrokerOrder2(Bot::Order& order);
@@ -36,8 +46,13 @@ public:
 
   bool_t addLogMessage(int64_t time, const String& message);
 
+  Stats::Histogram& getSessionLatency() {return sessionLatency;}
+
 private:
-  ZlimdbConnection connection;
+  Host& host;
+  ZlimdbConnection& connection;
+  Stats::Histogram& brokerLatency;
+  Stats::Histogram& sessionLatency;
   int64_t maxTradeAge;
   bool_t simulation;
   Broker* broker;
@@ -57,13 +72,4 @@ private:
 
   uint32_t livePropertiesTableId;
   HashSet<String> liveProperties;
-
-private:
-  void_t controlUserSession(uint32_t requestId, uint64_t entityId, uint32_t controlCode, const byte_t* data, size_t size);
-
-private: // ZlimdbConnection::Callback
-  virtual void_t addedEntity(uint32_t tableId, const zlimdb_entity& entity);
-  virtual void_t updatedEntity(uint32_t tableId, const zlimdb_entity& entity) {}
-  virtual void_t removedEntity(uint32_t tableId, uint64_t entityId) {}
-  virtual void_t controlEntity(uint32_t tableId, uint32_t requestId, uint64_t entityId, uint32_t controlCode, const byte_t* data, size_t size);
 };
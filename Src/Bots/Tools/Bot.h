@@ -7,6 +7,8 @@
 
 #include <megucoprotocol.h>
 
+struct CandleEntity;
+
 class Bot
 {
 public:
@@ -154,6 +156,12 @@ public:
   public:
     virtual ~Session() {};
     virtual void_t handleTrade(const Trade& trade, int64_t tradeAge) = 0;
+    /**
+    * Replays a one minute candle of the trade history that is older than getMaxRawTradeAge().
+    * @param candle The candle.
+    * @param candleAge The age of the candle in milliseconds.
+    */
+    virtual void_t handleCandle(const CandleEntity& candle, int64_t candleAge) {}
     virtual void_t handleBuy(uint64_t orderId, const Transaction& transaction) = 0;
     virtual void_t handleSell(uint64_t orderId, const Transaction& transaction) = 0;
     virtual void_t handleBuyTimeout(uint64_t orderId) = 0;
@@ -166,4 +174,8 @@ public:
   virtual ~Bot() {}
   virtual Session* createSession(Broker& broker) = 0;
   virtual int64_t getMaxTradeAge() const = 0;
+  /**
+  * Returns the age up to which the trade history has to be replayed trade by trade. Older trades are replayed as candles.
+  */
+  virtual int64_t getMaxRawTradeAge() const {return getMaxTradeAge();}
 };
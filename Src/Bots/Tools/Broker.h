@@ -15,4 +15,5 @@ public:
 
   virtual const String& getLastError() const = 0;
   virtual void_t handleTrade(Bot::Session& session, const Bot::Trade& trade, bool_t replayed) = 0;
+  virtual void_t handleCandle(Bot::Session& session, const CandleEntity& candle) = 0;
 };
@@ -0,0 +1,357 @@
+
+#include <nstd/Log.h>
+#include <nstd/Time.h>
+#include <zlimdbprotocol.h>
+#include <megucoprotocol.h>
+
+#include "Host.h"
+#include "Main.h"
+
+static const int64_t sessionRetryInterval = 60 * 1000; // the time in milliseconds after which a session that could not be loaded is loaded again
+
+Host::Host(uint_t index) : index(index),
+  deliverLatency(stats.addHistogram("deliver")), brokerLatency(stats.addHistogram("broker")), sessionLatency(stats.addHistogram("session")),
+  joiningSession(0), retryTime(0)
+{
+  const ZlimdbConnection::Counters& counters = connection.getCounters();
+  stats.addCounter("zlimdb sent messages", counters.sentMessages);
+  stats.addCounter("zlimdb sent bytes", counters.sentBytes);
+  stats.addCounter("zlimdb received messages", counters.receivedMessages);
+  stats.addCounter("zlimdb received bytes", counters.receivedBytes);
+}
+
+Host::~Host() {closeSessions();}
+
+void_t Host::addSession(const String& userName, uint64_t sessionId)
+{
+  Session& session = sessions.append(Session());
+  session.userName = userName;
+  session.sessionId = sessionId;
+  session.main = 0;
+}
+
+bool_t Host::start()
+{
+  if(!thread.start(proc, this))
+    return false;
+  return true;
+}
+
+uint_t Host::proc()
+{
+  for(;; Thread::sleep(10 * 1000))
+  {
+    if(!connect())
+    {
+      Log::errorf("Worker %u could not connect to zlimdb server: %s", index, (const char_t*)getErrorString());
+      continue;
+    }
+    process();
+    Log::errorf("Worker %u lost connection to zlimdb server: %s", index, (const char_t*)getErrorString());
+  }
+  return 0;
+}
+
+void_t Host::closeSessions()
+{
+  for(HashMap<uint32_t, Market>::Iterator i = markets.begin(), end = markets.end(); i != end; ++i)
+    delete i->ringReader;
+  markets.clear();
+  ringTrades.clear();
+  for(List<Session>::Iterator i = sessions.begin(), end = sessions.end(); i != end; ++i)
+  {
+    delete i->main;
+    i->main = 0;
+  }
+  sessionsByTableId.clear();
+}
+
+bool_t Host::connect()
+{
+  // close current sessions
+  closeSessions();
+
+  // create session entity connection
+  if(!connection.connect(*this))
+    return false;
+
+  // load sessions, a session that cannot be loaded is retried from process() unless no session could be loaded
+  if(!loadSessions())
+    return false;
+  return !sessionsByTableId.isEmpty();
+}
+
+bool_t Host::loadSessions()
+{
+  retryTime = 0;
+  for(List<Session>::Iterator i = sessions.begin(), end = sessions.end(); i != end; ++i)
+  {
+    Session& session = *i;
+    if(session.main)
+      continue;
+    Main* main = new Main(*this);
+    if(!main->connect(session.userName, session.sessionId))
+    {
+      delete main;
+      if(!connection.isOpen())
+        return false;
+      Log::errorf("Could not load session %s/%llu: %s", (const char_t*)session.userName, session.sessionId, (const char_t*)getErrorString());
+      retryTime = Time::time() + sessionRetryInterval;
+      continue;
+    }
+    session.main = main;
+    sessionsByTableId.append(main->getSessionTableId(), main);
+  }
+  return true;
+}
+
+bool_t Host::process()
+{
+  for(;;)
+  {
+    if(retryTime)
+    {
+      int64_t timeout = retryTime - Time::time();
+      if(timeout <= 0)
+      {
+        if(!loadSessions())
+          return false;
+        continue;
+      }
+      if(!connection.process((uint_t)timeout))
+        return false;
+    }
+    else if(!connection.process())
+      return false;
+    if(!handleRingTrades())
+      return false;
+  }
+}
+
+bool_t Host::subscribeTrades(Main& session, const String& marketName, uint32_t tradesTableId, int64_t since)
+{
+  joiningSession = &session;
+  joiningTradesTableId = tradesTableId;
+  joiningTrades.clear();
+
+  // use the trade ring of the market when the first session of the market is loaded and the ring is available
+  RingReader* ringReader = 0;
+  uint64_t ringPosition = 0;
+  bool_t subscribed = markets.contains(tradesTableId);
+  if(!subscribed)
+  {
+    ringReader = new RingReader(*this, tradesTableId);
+    if(ringReader->ring.open(marketName, false))
+    {
+      ringPosition = ringReader->ring.getTail();
+      subscribed = true;
+    }
+    else
+    {
+      delete ringReader;
+      ringReader = 0;
+    }
+  }
+
+  // get trade history
+  int64_t lastTradeTime = since;
+  bool_t result = subscribed ?
+    connection.query(tradesTableId, zlimdb_query_type_since_time, since) :
+    connection.subscribe(tradesTableId, zlimdb_query_type_since_time, since, zlimdb_subscribe_flag_none);
+  if(result)
+  {
+    byte_t buffer[ZLIMDB_MAX_MESSAGE_SIZE];
+    while(connection.getResponse(buffer))
+    {
+      for(const meguco_trade_entity* trade = (const meguco_trade_entity*)zlimdb_get_first_entity((const zlimdb_header*)buffer, sizeof(meguco_trade_entity));
+        trade;
+        trade = (const meguco_trade_entity*)zlimdb_get_next_entity((const zlimdb_header*)buffer, sizeof(meguco_trade_entity), &trade->entity))
+      {
+        session.handleTrade(*trade, true);
+        if((int64_t)trade->entity.time > lastTradeTime)
+          lastTradeTime = trade->entity.time;
+      }
+    }
+    result = connection.getErrno() == 0;
+  }
+  joiningSession = 0;
+  if(!result)
+  {
+    delete ringReader;
+    return false;
+  }
+
+  // replay trades that were received in the meantime and join the subscription
+  for(List<Bot::Trade>::Iterator i = joiningTrades.begin(), end = joiningTrades.end(); i != end; ++i)
+    session.handleTrade(*i, false);
+  joiningTrades.clear();
+  HashMap<uint32_t, Market>::Iterator it = markets.find(tradesTableId);
+  if(it == markets.end())
+  {
+    Market& market = markets.append(tradesTableId, Market());
+    market.sessions.append(&session);
+    market.ringReader = ringReader;
+    market.lastTradeTime = lastTradeTime;
+
+    // the ring is read from before the history query, the overlap is skipped by the sessions
+    if(ringReader && !ringReader->start(ringPosition))
+      return unsubscribeRing(tradesTableId);
+  }
+  else
+    it->sessions.append(&session);
+  return true;
+}
+
+void_t Host::addedEntity(uint32_t tableId, const zlimdb_entity& entity)
+{
+  if(entity.size < sizeof(meguco_trade_entity))
+    return;
+  handleTrade(tableId, *(const meguco_trade_entity*)&entity);
+}
+
+void_t Host::handleTrade(uint32_t tableId, const meguco_trade_entity& entity)
+{
+  HashMap<uint32_t, Market>::Iterator it = markets.find(tableId);
+  bool_t joining = joiningSession && tableId == joiningTradesTableId;
+  if(it == markets.end() && !joining)
+    return;
+  Bot::Trade trade(entity);
+  int64_t now = Time::time();
+  deliverLatency.add((now - (int64_t)trade.time) * 1000LL);
+  if(joining)
+    joiningTrades.append(trade);
+  if(it != markets.end())
+  {
+    Market& market = *it;
+    if((int64_t)trade.time > market.lastTradeTime)
+      market.lastTradeTime = trade.time;
+    for(List<Main*>::Iterator i = market.sessions.begin(), end = market.sessions.end(); i != end; ++i)
+      (*i)->handleTrade(trade, false);
+  }
+  stats.check(now);
+}
+
+bool_t Host::handleRingTrades()
+{
+  List<RingTrade> ringTrades;
+  mutex.lock();
+  ringTrades.swap(this->ringTrades);
+  mutex.unlock();
+  for(List<RingTrade>::Iterator i = ringTrades.begin(), end = ringTrades.end(); i != end; ++i)
+  {
+    const RingTrade& ringTrade = *i;
+    if(ringTrade.failed)
+    {
+      if(!unsubscribeRing(ringTrade.tradesTableId))
+        return false;
+    }
+    else
+      handleTrade(ringTrade.tradesTableId, ringTrade.trade);
+  }
+  return true;
+}
+
+bool_t Host::unsubscribeRing(uint32_t tradesTableId)
+{
+  HashMap<uint32_t, Market>::Iterator it = markets.find(tradesTableId);
+  if(it == markets.end() || !it->ringReader)
+    return true;
+  Market& market = *it;
+  delete market.ringReader;
+  market.ringReader = 0;
+  Log::warningf("Worker %u lost the trade ring of trades table %u, falling back to zlimdb.", index, tradesTableId);
+
+  // subscribe to the trades table and replay the trades the sessions might have missed
+  if(!connection.subscribe(tradesTableId, zlimdb_query_type_since_time, market.lastTradeTime, zlimdb_subscribe_flag_none))
+    return false;
+  List<meguco_trade_entity> trades;
+  byte_t buffer[ZLIMDB_MAX_MESSAGE_SIZE];
+  while(connection.getResponse(buffer))
+  {
+    for(const meguco_trade_entity* trade = (const meguco_trade_entity*)zlimdb_get_first_entity((const zlimdb_header*)buffer, sizeof(meguco_trade_entity));
+      trade;
+      trade = (const meguco_trade_entity*)zlimdb_get_next_entity((const zlimdb_header*)buffer, sizeof(meguco_trade_entity), &trade->entity))
+      trades.append(*trade);
+  }
+  if(connection.getErrno() != 0)
+    return false;
+  for(List<meguco_trade_entity>::Iterator i = trades.begin(), end = trades.end(); i != end; ++i)
+    handleTrade(tradesTableId, *i);
+  return true;
+}
+
+void_t Host::addRingTrades(uint32_t tradesTableId, const List<meguco_trade_entity>& trades, bool_t failed)
+{
+  mutex.lock();
+  for(List<meguco_trade_entity>::Iterator i = trades.begin(), end = trades.end(); i != end; ++i)
+  {
+    RingTrade& ringTrade = ringTrades.append(RingTrade());
+    ringTrade.tradesTableId = tradesTableId;
+    ringTrade.failed = false;
+    ringTrade.trade = *i;
+  }
+  if(failed)
+  {
+    RingTrade& ringTrade = ringTrades.append(RingTrade());
+    ringTrade.tradesTableId = tradesTableId;
+    ringTrade.failed = true;
+  }
+  mutex.unlock();
+  connection.interrupt();
+}
+
+Host::RingReader::~RingReader()
+{
+  stopping = true;
+  ring.interrupt();
+  thread.join();
+}
+
+bool_t Host::RingReader::start(uint64_t position)
+{
+  this->position = position;
+  if(!thread.start(proc, this))
+    return false;
+  return true;
+}
+
+uint_t Host::RingReader::proc()
+{
+  List<meguco_trade_entity> trades;
+  meguco_trade_entity trade;
+  for(;;)
+  {
+    TradeRing::Result result;
+    while((result = ring.read(position, trade)) == TradeRing::ok)
+      trades.append(trade);
+    if(result == TradeRing::overrun)
+    {
+      host.addRingTrades(tradesTableId, trades, true);
+      return 0;
+    }
+    if(!trades.isEmpty())
+    {
+      host.addRingTrades(tradesTableId, trades, false);
+      trades.clear();
+    }
+    if(stopping)
+      return 0;
+    ring.wait(position, 1000);
+    if(stopping)
+      return 0;
+    if(!ring.isWriterAlive())
+    {
+      host.addRingTrades(tradesTableId, trades, true);
+      return 0;
+    }
+  }
+}
+
+void_t Host::controlEntity(uint32_t tableId, uint32_t requestId, uint64_t entityId, uint32_t controlCode, const byte_t* data, size_t size)
+{
+  HashMap<uint32_t, Main*>::Iterator it = sessionsByTableId.find(tableId);
+  if(it != sessionsByTableId.end())
+    return (*it)->controlUserSession(requestId, entityId, controlCode, data, size);
+  else
+    return (void_t)connection.sendControlResponse(requestId, zlimdb_error_invalid_request);
+}
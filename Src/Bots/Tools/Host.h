@@ -0,0 +1,140 @@
+
+#pragma once
+
+#include <nstd/HashMap.h>
+#include <nstd/List.h>
+#include <nstd/Thread.h>
+#include <nstd/Mutex.h>
+
+#include "Tools/ZlimdbConnection.h"
+#include "Tools/TradeRing.h"
+#include "Tools/Bot.h"
+#include "Tools/Stats.h"
+
+class Main;
+
+/**
+* Runs a group of bot sessions on one zlimdb connection. The sessions on the same market share one subscription to
+* the trades table of the market and every trade is decoded once for all of them. A bot process runs one host per
+* worker thread.
+* When the market process runs on the same host, the trades are read from the shared memory trade ring of the market
+* instead of the trades table. The host falls back to the trades table when it cannot keep up with the ring or when
+* the market process is gone.
+*/
+class Host : public ZlimdbConnection::Callback
+{
+public:
+  /**
+  * @param index The index of the worker thread that runs the host.
+  */
+  Host(uint_t index);
+  ~Host();
+
+  void_t addSession(const String& userName, uint64_t sessionId);
+
+  /**
+  * Runs the connection loop of the host in a worker thread.
+  */
+  bool_t start();
+
+  bool_t connect();
+  bool_t process();
+  String getErrorString() {return connection.getErrorString();}
+
+  ZlimdbConnection& getConnection() {return connection;}
+  Stats::Histogram& getBrokerLatency() {return brokerLatency;}
+  Stats::Histogram& getSessionLatency() {return sessionLatency;}
+
+  /**
+  * Replays the trade history of a market to a session and passes the following trades of the market on to it.
+  * The first session of a market subscribes to the trade ring or the trades table, later sessions query their
+  * history and join the subscription. Trades that arrive while the history is loaded are held back and replayed
+  * afterwards.
+  * @param session The session.
+  * @param marketName The channel name of the market.
+  * @param tradesTableId The id of the trades table of the market.
+  * @param since The time of the oldest trade of the history.
+  * @return \c false when the history could not be loaded
+  */
+  bool_t subscribeTrades(Main& session, const String& marketName, uint32_t tradesTableId, int64_t since);
+
+private:
+  struct Session
+  {
+    String userName;
+    uint64_t sessionId;
+    Main* main;
+  };
+
+  class RingReader
+  {
+  public:
+    TradeRing ring;
+
+  public:
+    RingReader(Host& host, uint32_t tradesTableId) : host(host), tradesTableId(tradesTableId), stopping(false) {}
+    ~RingReader();
+
+    bool_t start(uint64_t position);
+
+  private:
+    Host& host;
+    uint32_t tradesTableId;
+    uint64_t position;
+    Thread thread;
+    volatile bool_t stopping;
+
+  private:
+    static uint_t proc(void_t* param) {return ((RingReader*)param)->proc();}
+    uint_t proc();
+  };
+
+  struct Market
+  {
+    List<Main*> sessions;
+    RingReader* ringReader;
+    int64_t lastTradeTime;
+  };
+
+  struct RingTrade
+  {
+    uint32_t tradesTableId;
+    bool_t failed;
+    meguco_trade_entity trade;
+  };
+
+private:
+  uint_t index;
+  Thread thread;
+  Stats stats;
+  Stats::Histogram& deliverLatency;
+  Stats::Histogram& brokerLatency;
+  Stats::Histogram& sessionLatency;
+  ZlimdbConnection connection;
+  List<Session> sessions;
+  HashMap<uint32_t, Main*> sessionsByTableId;
+  HashMap<uint32_t, Market> markets;
+  Main* joiningSession;
+  uint32_t joiningTradesTableId;
+  List<Bot::Trade> joiningTrades;
+  Mutex mutex;
+  List<RingTrade> ringTrades;
+  int64_t retryTime;
+
+private:
+  static uint_t proc(void_t* param) {return ((Host*)param)->proc();}
+  uint_t proc();
+
+  void_t closeSessions();
+  bool_t loadSessions();
+  void_t handleTrade(uint32_t tableId, const meguco_trade_entity& entity);
+  bool_t handleRingTrades();
+  bool_t unsubscribeRing(uint32_t tradesTableId);
+  void_t addRingTrades(uint32_t tradesTableId, const List<meguco_trade_entity>& trades, bool_t failed);
+
+private: // ZlimdbConnection::Callback
+  virtual void_t addedEntity(uint32_t tableId, const zlimdb_entity& entity);
+  virtual void_t updatedEntity(uint32_t tableId, const zlimdb_entity& entity) {}
+  virtual void_t removedEntity(uint32_t tableId, uint64_t entityId) {}
+  virtual void_t controlEntity(uint32_t tableId, uint32_t requestId, uint64_t entityId, uint32_t controlCode, const byte_t* data, size_t size);
+};
@@ -5,6 +5,8 @@
 #include <megucoprotocol.h>
 #include <zlimdbprotocol.h>
 
+#include "Tools/Candle.h"
+
 #include "LiveBroker.h"
 #include "Main.h"
 
@@ -48,7 +50,17 @@ doneRefreshing:
 
   cancelTimedOutOrders(botSession);
 
+  int64_t start = Time::microTicks();
   botSession.handleTrade(trade, 0);
+  main.getSessionLatency().add(Time::microTicks() - start);
+}
+
+void_t LiveBroker::handleCandle(Bot::Session& botSession, const CandleEntity& candle)
+{
+  int64_t candleAge = Time::time() - candle.entity.time;
+  if(candleAge <= 0LL)
+    candleAge = 1LL;
+  botSession.handleCandle(candle, candleAge);
 }
 
 void_t LiveBroker::refreshOrders(Bot::Session& botSession)
@@ -75,5 +75,6 @@ public: // Broker
 
   virtual const String& getLastError() const {return error;}
   virtual void_t handleTrade(Bot::Session& session, const Bot::Trade& trade, bool_t replayed);
+  virtual void_t handleCandle(Bot::Session& session, const CandleEntity& candle);
 };
 
@@ -3,6 +3,8 @@
 #include <nstd/Time.h>
 #include <nstd/Math.h>
 
+#include "Tools/Candle.h"
+
 #include "SimBroker.h"
 #include "Main.h"
 
@@ -80,7 +82,16 @@ void_t SimBroker::handleTrade(Bot::Session& botSession, const Bot::Trade& trade,
     }
   }
 
+  int64_t start = Time::microTicks();
   botSession.handleTrade(trade, 0);
+  main.getSessionLatency().add(Time::microTicks() - start);
+}
+
+void_t SimBroker::handleCandle(Bot::Session& botSession, const CandleEntity& candle)
+{
+  if(startTime == 0)
+    startTime = candle.entity.time;
+  botSession.handleCandle(candle, startTime + maxTradeAge - candle.entity.time);
 }
 
 bool_t SimBroker::buy(double price, double amount, double total, int64_t timeout, uint64_t* id, double* orderedAmount)
@@ -16,3 +16,19 @@ const uint64_t TradeHandler::depths[13] = {
   12 * 60 * 60,
   24 * 60 * 60
 };
+
+const uint64_t TradeHandler::bucketWidths[13] = {
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  2 * 60 * 60 / 120,
+  4 * 60 * 60 / 120,
+  6 * 60 * 60 / 120,
+  12 * 60 * 60 / 120,
+  24 * 60 * 60 / 120
+};
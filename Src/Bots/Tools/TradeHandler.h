@@ -4,6 +4,7 @@
 #include <nstd/Math.h>
 
 #include "Bot.h"
+#include "Tools/Candle.h"
 
 class TradeHandler
 {
@@ -59,7 +60,24 @@ public:
 public:
   static int64_t getMaxTradeAge() {return depths[sizeof(depths) / sizeof(*depths) - 1] * 1000ULL;}
 
+  /**
+  * Returns the age up to which individual trades are needed. Older trades can be passed as candles to addCandle().
+  */
+  static int64_t getMaxRawTradeAge() {return depths[(int)regression1h] * 1000ULL;}
+
 public:
+  /**
+  * @param bucketAge The age in seconds after which the trades of the long regressions are folded into time buckets or
+  *                  0 to keep every trade. The regressions with a bucket width stay within their window by at most one
+  *                  bucket width (1/120 of the window) and keep at most 121 buckets plus the trades younger than
+  *                  \c bucketAge.
+  */
+  explicit TradeHandler(uint64_t bucketAge)
+  {
+    for(int i = 0; i < (int)numOfRegressions; ++i)
+      averager[i].setBuckets(bucketWidths[i], bucketAge);
+  }
+
   void add(const Bot::Trade& trade, int64_t tradeAge)
   {
     uint64_t tradeAgeSecs = tradeAge / 1000ULL;
@@ -74,6 +92,18 @@ public:
       */
   }
 
+  /**
+  * Seeds the regressions that are longer than getMaxRawTradeAge() with the trades of a candle.
+  */
+  void addCandle(const CandleEntity& candle, int64_t candleAge)
+  {
+    uint64_t candleAgeSecs = candleAge / 1000ULL;
+    uint64_t timeSecs = candle.entity.time / 1000ULL;
+
+    for(int i = (int)regression2h; i < (int)numOfRegressions; ++i)
+      averager[i].addCandle(timeSecs, candleAgeSecs, candle, depths[i]);
+  }
+
   bool_t isComplete() const {return averager[(int)numOfRegressions - 1].isComplete();}
 
   Values& getValues()
@@ -91,10 +121,16 @@ private:
   class Averager
   {
   public:
-    Averager() : complete(false), startTime(0), x(0), sumXY(0.), sumY(0.), sumX(0.), sumXX(0.), sumN(0.), newSumXY(0.), newSumY(0.), newSumX(0.), newSumXX(0.), newSumN(0.), minPrice(1.7976931348623158e+308), maxPrice(0.), needMinMaxUpdate(false) {}
+    Averager() : complete(false), bucketWidth(0), bucketAge(0), startTime(0), x(0), sumXY(0.), sumY(0.), sumX(0.), sumXX(0.), sumN(0.), newSumXY(0.), newSumY(0.), newSumX(0.), newSumXX(0.), newSumN(0.), newCount(0), minPrice(1.7976931348623158e+308), maxPrice(0.), needMinMaxUpdate(false) {}
 
     bool_t isComplete() const {return complete;}
 
+    void setBuckets(uint64_t bucketWidth, uint64_t bucketAge)
+    {
+      this->bucketWidth = bucketAge ? bucketWidth : 0;
+      this->bucketAge = bucketAge;
+    }
+
     void add(uint64_t time, uint64_t tradeAge, double amount, double price, uint64_t maxAge)
     {
       if(tradeAge > maxAge)
@@ -107,37 +143,42 @@ private:
       const double& y = price;
       const double& n = amount;
 
-      const double nx = n * x;
-      const double ny = n * y;
-      const double nxy = nx * y;
-      const double nxx = nx * x;
-
-      sumXY += nxy;
-      sumY += ny;
-      sumX += nx;
-      sumXX += nxx;
-      sumN += n;
-
-      newSumXY += nxy;
-      newSumY += ny;
-      newSumX += nx;
-      newSumXX += nxx;
-      newSumN += n;
-      if(++newCount == (unsigned int)data.size())
-        useNewSum();
-
       DataEntry& dataEntry = data.append(DataEntry());
       dataEntry.time = time;
-      dataEntry.x = x;
-      dataEntry.y = y;
       dataEntry.n = n;
+      dataEntry.nx = n * x;
+      dataEntry.ny = n * y;
+      dataEntry.nxy = dataEntry.nx * y;
+      dataEntry.nxx = dataEntry.nx * x;
+      dataEntry.front = dataEntry.back = dataEntry.min = dataEntry.max = y;
+      addEntry(dataEntry, maxAge);
+    }
 
-      if(price > maxPrice)
-        maxPrice = price;
-      if(price < minPrice)
-        minPrice = price;
+    void addCandle(uint64_t time, uint64_t candleAge, const CandleEntity& candle, uint64_t maxAge)
+    {
+      if(candleAge > maxAge || candle.volume <= 0.)
+        return;
 
-      limitToAge(maxAge);
+      if(startTime == 0)
+        startTime = time;
+
+      // the moments of the candle are relative to the start of the candle
+      const double d = (double)(time - startTime);
+      x = d;
+      const double& n = candle.volume;
+
+      DataEntry& dataEntry = data.append(DataEntry());
+      dataEntry.time = time;
+      dataEntry.n = n;
+      dataEntry.nx = candle.sumX + d * n;
+      dataEntry.ny = candle.vwap * n;
+      dataEntry.nxy = candle.sumXY + d * dataEntry.ny;
+      dataEntry.nxx = candle.sumXX + 2. * d * candle.sumX + d * d * n;
+      dataEntry.front = candle.open;
+      dataEntry.back = candle.close;
+      dataEntry.min = candle.low;
+      dataEntry.max = candle.high;
+      addEntry(dataEntry, maxAge);
     }
 
     void getLine(Values::RegressionLine& rl)
@@ -150,21 +191,30 @@ private:
         updateMinMax();
       rl.min = minPrice;
       rl.max = maxPrice;
-      rl.back = data.back().y;
-      rl.front = data.front().y;
+      rl.back = data.back().back;
+      rl.front = buckets.isEmpty() ? data.front().front : buckets.front().front;
     }
 
   private:
     struct DataEntry
     {
       uint64_t time;
-      double x;
       double n;
-      double y;
+      double nx;
+      double ny;
+      double nxy;
+      double nxx;
+      double front;
+      double back;
+      double min;
+      double max;
     };
 
   private:
     bool complete;
+    uint64_t bucketWidth;
+    uint64_t bucketAge;
+    List<DataEntry> buckets;
     List<DataEntry> data;
     uint64_t startTime;
     double x;
@@ -185,41 +235,97 @@ private:
     bool needMinMaxUpdate;
 
   private:
+    void addEntry(const DataEntry& dataEntry, uint64_t maxAge)
+    {
+      sumXY += dataEntry.nxy;
+      sumY += dataEntry.ny;
+      sumX += dataEntry.nx;
+      sumXX += dataEntry.nxx;
+      sumN += dataEntry.n;
+
+      newSumXY += dataEntry.nxy;
+      newSumY += dataEntry.ny;
+      newSumX += dataEntry.nx;
+      newSumXX += dataEntry.nxx;
+      newSumN += dataEntry.n;
+      if(++newCount == (unsigned int)(buckets.size() + data.size()))
+        useNewSum();
+
+      if(dataEntry.max > maxPrice)
+        maxPrice = dataEntry.max;
+      if(dataEntry.min < minPrice)
+        minPrice = dataEntry.min;
+
+      if(bucketWidth)
+        foldBuckets();
+      limitToAge(maxAge);
+    }
+
+    void foldBuckets()
+    {
+      uint64_t now = data.back().time;
+      while(now - data.front().time > bucketAge)
+      {
+        const DataEntry& dataEntry = data.front();
+        uint64_t bucketTime = dataEntry.time - dataEntry.time % bucketWidth;
+
+        // the newest newCount entries are covered by the new sums, so do not merge across that boundary
+        if(!buckets.isEmpty() && buckets.back().time == bucketTime && newCount != (unsigned int)data.size())
+        {
+          if(newCount > (unsigned int)data.size())
+            --newCount;
+
+          DataEntry& bucket = buckets.back();
+          bucket.n += dataEntry.n;
+          bucket.nx += dataEntry.nx;
+          bucket.ny += dataEntry.ny;
+          bucket.nxy += dataEntry.nxy;
+          bucket.nxx += dataEntry.nxx;
+          bucket.back = dataEntry.back;
+          if(dataEntry.min < bucket.min)
+            bucket.min = dataEntry.min;
+          if(dataEntry.max > bucket.max)
+            bucket.max = dataEntry.max;
+        }
+        else
+          buckets.append(dataEntry).time = bucketTime;
+        data.removeFront();
+      }
+    }
+
     void limitToAge(uint64_t maxAge)
     {
       if(data.isEmpty())
         return;
       uint64_t now = data.back().time;
 
-      while(!data.isEmpty())
+      if(removeOlderThan(buckets, now, maxAge))
+        removeOlderThan(data, now, maxAge);
+    }
+
+    bool removeOlderThan(List<DataEntry>& entries, uint64_t now, uint64_t maxAge)
+    {
+      while(!entries.isEmpty())
       {
-        DataEntry& dataEntry = data.front();
+        DataEntry& dataEntry = entries.front();
         if(now - dataEntry.time <= maxAge)
-          return;
-
-        const double& x = dataEntry.x;
-        const double& y = dataEntry.y;
-        const double& n = dataEntry.n;
+          return false;
 
-        if(y >= maxPrice || y <= minPrice)
+        if(dataEntry.max >= maxPrice || dataEntry.min <= minPrice)
           needMinMaxUpdate = true;
 
-        const double nx = n * x;
-        const double ny = n * y;
-        const double nxy = nx * y;
-        const double nxx = nx * x;
+        sumXY -= dataEntry.nxy;
+        sumY -= dataEntry.ny;
+        sumX -= dataEntry.nx;
+        sumXX -= dataEntry.nxx;
+        sumN -= dataEntry.n;
 
-        sumXY -= nxy;
-        sumY -= ny;
-        sumX -= nx;
-        sumXX -= nxx;
-        sumN -= n;
-
-        data.removeFront();
+        entries.removeFront();
         complete = true;
-        if(newCount == (unsigned int)data.size())
+        if(newCount == (unsigned int)(buckets.size() + data.size()))
           useNewSum();
       }
+      return true;
     }
 
     void useNewSum()
@@ -230,11 +336,11 @@ private:
       sumXX = newSumXX;
       sumN = newSumN;
 
-      sumXY = 0;
-      sumY = 0;
-      sumX = 0;
-      sumXX = 0;
-      sumN = 0;
+      newSumXY = 0;
+      newSumY = 0;
+      newSumX = 0;
+      newSumXX = 0;
+      newSumN = 0;
       newCount = 0;
     }
 
@@ -242,16 +348,21 @@ private:
     {
       minPrice = 1.7976931348623158e+308;
       maxPrice = 0.;
-      double price;
-      for(List<DataEntry>::Iterator i = data.begin(), end = data.end(); i != end; ++i)
+      updateMinMax(buckets);
+      updateMinMax(data);
+      needMinMaxUpdate = false;
+    }
+
+    void updateMinMax(const List<DataEntry>& entries)
+    {
+      for(List<DataEntry>::Iterator i = entries.begin(), end = entries.end(); i != end; ++i)
       {
-        price = i->y;
-        if(price > maxPrice)
-          maxPrice = price;
-        if(price < minPrice)
-          minPrice = price;
+        const DataEntry& dataEntry = *i;
+        if(dataEntry.max > maxPrice)
+          maxPrice = dataEntry.max;
+        if(dataEntry.min < minPrice)
+          minPrice = dataEntry.min;
       }
-      needMinMaxUpdate = false;
     }
   };
   /*
@@ -385,6 +496,7 @@ private:
   */
 private:
   static const uint64_t depths[13];
+  static const uint64_t bucketWidths[13];
 
 private:
   Values values;
@@ -2,6 +2,7 @@
 #include <nstd/Time.h>
 #include <nstd/Thread.h>
 #include <nstd/Math.h>
+#include <nstd/HashSet.h>
 
 #include "Tools/Sha256.h"
 #include "Tools/Hex.h"
@@ -10,33 +11,43 @@
 
 #include "BitstampBtcUsd.h"
 
+static const int64_t maxLowPriorityWait = 1000; // the time in milliseconds that a request of lower priority may wait for the rate limit
+
 BitstampBtcUsd::BitstampBtcUsd(const String& clientId, const String& key, const String& secret) :
-  clientId(clientId), key(key), secret(secret),
-  balanceLoaded(false), ordersLoaded(false), lastRequestTime(0), lastNonce(0) {}
+  clientId(clientId), key(key), secret(secret), signer((const byte_t*)(const char_t*)secret, secret.length()), apiUrl("https://www.bitstamp.net/api"),
+  balanceLoaded(false), ordersLoaded(false),
+  rateLimiter(8, 1000, 600, 10 * 60 * 1000, 2, 50), lastNonce(0) {} // bitstamp allows 600 requests per 10 minutes
+
+bool_t BitstampBtcUsd::setServerUrl(const String& url)
+{
+  apiUrl = url + "/api";
+  return true;
+}
 
-bool_t BitstampBtcUsd::loadBalanceAndFee()
+bool_t BitstampBtcUsd::loadBalanceAndFee(RateLimiter::Priority priority)
 {
   if(balanceLoaded)
     return true;
   meguco_user_broker_balance_entity balance;
-  if(!loadBalance(balance))
+  if(!loadBalance(balance, priority))
     return false;
   return true;
 }
 
-bool_t BitstampBtcUsd::loadOrders()
+bool_t BitstampBtcUsd::loadOrders(RateLimiter::Priority priority)
 {
   if(ordersLoaded)
     return true;
   List<meguco_user_broker_order_entity> orders;
-  if(!loadOrders(orders))
+  if(!loadOrders(orders, priority))
     return false;
   return true;
 }
 
 bool_t BitstampBtcUsd::createOrder(meguco_user_broker_order_type type, double price, double amount, double total, meguco_user_broker_order_entity& order)
 {
-  if(!loadBalanceAndFee())
+  // the balance and the fee are needed to compute the order, so they are loaded with the priority of the order
+  if(!loadBalanceAndFee(RateLimiter::highPriority))
     return false;
 
   bool buy = type == meguco_user_broker_order_buy;
@@ -99,16 +110,14 @@ bool_t BitstampBtcUsd::createOrder(meguco_user_broker_order_type type, double pr
   args.append("amount", amountStr);
   args.append("price", priceStr);
 
-  String url = buy ? String("https://www.bitstamp.net/api/buy/") : String("https://www.bitstamp.net/api/sell/");
-  Variant result;
-  if(!request(url, false, args, result))
+  String url = apiUrl + (buy ? "/buy/" : "/sell/");
+  const Json::Value* orderData;
+  if(!request(url, false, args, RateLimiter::highPriority, orderData))
     return false;
 
-  const HashMap<String, Variant>& orderData = result.toMap();
-
   ZlimdbConnection::setEntityHeader(order.entity, 0, 0, sizeof(order));
-  order.raw_id = orderData.find("id")->toUInt64();
-  String btype = orderData.find("type")->toString();
+  order.raw_id = orderData->find("id")->toUInt64();
+  String btype = orderData->find("type")->toString();
   if(btype != "0" && btype != "1")
   {
     error = "Received invalid order type.";
@@ -118,7 +127,7 @@ bool_t BitstampBtcUsd::createOrder(meguco_user_broker_order_type type, double pr
   buy = btype == "0";
   order.type = buy ? meguco_user_broker_order_buy : meguco_user_broker_order_sell;
 
-  String dateStr = orderData.find("datetime")->toString();
+  String dateStr = orderData->find("datetime")->toString();
   const tchar_t* lastDot = dateStr.findLast('.');
   if(lastDot)
     dateStr.resize(lastDot - (const tchar_t*)dateStr);
@@ -131,8 +140,8 @@ bool_t BitstampBtcUsd::createOrder(meguco_user_broker_order_type type, double pr
   order.entity.id = 0;
   order.entity.time = time.toTimestamp();
 
-  price = orderData.find("price")->toDouble();
-  amount = Math::abs(orderData.find("amount")->toDouble());
+  price = orderData->find("price")->toDouble();
+  amount = Math::abs(orderData->find("amount")->toDouble());
   order.total = Math::abs(getOrderCharge(buy ? amount : -amount, price));
   order.price = price;
   order.amount = amount;
@@ -166,9 +175,9 @@ bool_t BitstampBtcUsd::getOrder(uint32_t entityId, BotProtocol::Order& order)
 */
 bool_t BitstampBtcUsd::cancelOrder(uint64_t id)
 {
-  if(!loadBalanceAndFee())
+  if(!loadBalanceAndFee(RateLimiter::highPriority))
     return false;
-  if(!loadOrders())
+  if(!loadOrders(RateLimiter::highPriority))
     return false;
 
   HashMap<uint64_t, meguco_user_broker_order_entity>::Iterator it = orders.find(id);
@@ -181,10 +190,10 @@ bool_t BitstampBtcUsd::cancelOrder(uint64_t id)
 
   HashMap<String, Variant> args;
   args.append("id", id);
-  Variant result;
-  if(!request("https://www.bitstamp.net/api/cancel_order/", false, args, result))
+  const Json::Value* result;
+  if(!request(apiUrl + "/cancel_order/", false, args, RateLimiter::highPriority, result))
     return false;
-  if(!result.toBool())
+  if(!result->toBool())
   {
     // todo: check if order is still on the orders list... if not, than it is already canceled and we should return true
     error = "Could not find or cancel order.";
@@ -209,39 +218,40 @@ bool_t BitstampBtcUsd::cancelOrder(uint64_t id)
 
 bool_t BitstampBtcUsd::loadOrders(List<meguco_user_broker_order_entity>& orders)
 {
-  if(!loadBalanceAndFee())
+  return loadOrders(orders, RateLimiter::normalPriority);
+}
+
+bool_t BitstampBtcUsd::loadOrders(List<meguco_user_broker_order_entity>& orders, RateLimiter::Priority priority)
+{
+  if(!loadBalanceAndFee(priority))
     return false;
 
-  Variant result;
-  if(!request("https://www.bitstamp.net/api/open_orders/", false, HashMap<String, Variant>(), result))
+  const Json::Value* result;
+  if(!request(apiUrl + "/open_orders/", false, HashMap<String, Variant>(), priority, result))
     return false;
 
-  const List<Variant>& ordersData = result.toList();
   this->orders.clear();
   meguco_user_broker_order_entity order;
   ZlimdbConnection::setEntityHeader(order.entity, 0, 0, sizeof(order));
   Time time(true);
-  for(List<Variant>::Iterator i = ordersData.begin(), end = ordersData.end(); i != end; ++i)
+  for(const Json::Value* orderData = result->getFirst(); orderData; orderData = orderData->getNext())
   {
-    const Variant& orderDataVar = *i;
-    HashMap<String, Variant> orderData = orderDataVar.toMap();
-    
-    order.raw_id = orderData.find("id")->toUInt64();
-    String type = orderData.find("type")->toString();
+    order.raw_id = orderData->find("id")->toUInt64();
+    String type = orderData->find("type")->toString();
     if(type != "0" && type != "1")
       continue;
 
     bool buy = type == "0";
     order.type = buy ? meguco_user_broker_order_buy : meguco_user_broker_order_sell;
 
-    String dateStr = orderData.find("datetime")->toString();
+    String dateStr = orderData->find("datetime")->toString();
 
     if(dateStr.scanf("%d-%d-%d %d:%d:%d", &time.year, &time.month, &time.day, &time.hour, &time.min, &time.sec) != 6)
       continue;
     order.entity.time = time.toTimestamp();
 
-    double price = orderData.find("price")->toDouble();
-    double amount = Math::abs(orderData.find("amount")->toDouble());
+    double price = orderData->find("price")->toDouble();
+    double amount = Math::abs(orderData->find("amount")->toDouble());
     order.total = Math::abs(getOrderCharge(buy ? amount : -amount, price));
     order.timeout = 0;
     order.state = meguco_user_broker_order_open;
@@ -257,58 +267,82 @@ bool_t BitstampBtcUsd::loadOrders(List<meguco_user_broker_order_entity>& orders)
 
 bool_t BitstampBtcUsd::loadBalance(meguco_user_broker_balance_entity& balance)
 {
-  Variant result;
-  if(!request("https://www.bitstamp.net/api/balance/", false, HashMap<String, Variant>(), result))
+  return loadBalance(balance, RateLimiter::normalPriority);
+}
+
+bool_t BitstampBtcUsd::loadBalance(meguco_user_broker_balance_entity& balance, RateLimiter::Priority priority)
+{
+  const Json::Value* balanceData;
+  if(!request(apiUrl + "/balance/", false, HashMap<String, Variant>(), priority, balanceData))
     return false;
 
-  const HashMap<String, Variant>& balanceData = result.toMap();
   ZlimdbConnection::setEntityHeader(balance.entity, 0, 0, sizeof(balance));
-  balance.reserved_usd = balanceData.find("usd_reserved")->toDouble();
-  balance.reserved_btc = balanceData.find("btc_reserved")->toDouble();
-  balance.available_usd = balanceData.find("usd_available")->toDouble();
-  balance.available_btc = balanceData.find("btc_available")->toDouble();
-  balance.fee =  balanceData.find("fee")->toDouble() * 0.01;
+  balance.reserved_usd = balanceData->find("usd_reserved")->toDouble();
+  balance.reserved_btc = balanceData->find("btc_reserved")->toDouble();
+  balance.available_usd = balanceData->find("usd_available")->toDouble();
+  balance.available_btc = balanceData->find("btc_available")->toDouble();
+  balance.fee =  balanceData->find("fee")->toDouble() * 0.01;
   this->balance = balance;
   this->balanceLoaded = true;
   return true;
 }
 
-bool_t BitstampBtcUsd::loadTransactions(List<meguco_user_broker_transaction_entity>& transactions)
+bool_t BitstampBtcUsd::loadTransactions(uint64_t sinceRawId, List<meguco_user_broker_transaction_entity>& transactions)
 {
-  Variant result;
-  if(!request("https://www.bitstamp.net/api/user_transactions/", false, HashMap<String, Variant>(), result))
-    return false;
+  const size_t pageSize = 100;
 
   meguco_user_broker_transaction_entity transaction;
   ZlimdbConnection::setEntityHeader(transaction.entity, 0, 0, sizeof(transaction));
-  const List<Variant>& transactionData = result.toList();
   Time time(true);
-  for(List<Variant>::Iterator i = transactionData.begin(), end = transactionData.end(); i != end; ++i)
+  HashMap<String, Variant> args;
+  args.append("limit", (uint64_t)pageSize);
+  Variant& offset = *args.append("offset", (uint64_t)0);
+  HashSet<uint64_t> rawIds;
+  for(size_t page = 0;; ++page)
   {
-    const Variant& transactionDataVar = *i;
-    const HashMap<String, Variant>& transactionData = transactionDataVar.toMap();
-    
-    transaction.raw_id = transactionData.find("id")->toUInt64();
-    String type = transactionData.find("type")->toString();
-    if(type != "2")
-      continue;
-
-    String dateStr = transactionData.find("datetime")->toString();
-    if(dateStr.scanf("%d-%d-%d %d:%d:%d", &time.year, &time.month, &time.day, &time.hour, &time.min, &time.sec) != 6)
-      continue;
-    transaction.entity.time = time.toTimestamp();
-
-    double fee = Math::abs(transactionData.find("fee")->toDouble());
-
-    double value = transactionData.find("usd")->toDouble();
-    bool buy = value < 0.;
-    transaction.type = buy ? meguco_user_broker_transaction_buy : meguco_user_broker_transaction_sell;
-    double amount = Math::abs(transactionData.find("btc")->toDouble());
-    transaction.total = buy ? (Math::abs(value) + fee) : (Math::abs(value) - fee);
-    transaction.price = Math::abs(value) / Math::abs(amount);
-    transaction.amount = amount;
+    // the transactions are sorted from newest to oldest, so new transactions shift the offsets of the older ones
+    // and a page may repeat transactions of the previous page
+    offset = (uint64_t)(page * pageSize);
+    const Json::Value* result;
+    if(!request(apiUrl + "/user_transactions/", false, args, RateLimiter::lowPriority, result))
+      return false;
 
-    transactions.append(transaction);
+    size_t count = 0;
+    bool_t reachedKnown = false;
+    for(const Json::Value* transactionData = result->getFirst(); transactionData; transactionData = transactionData->getNext(), ++count)
+    {
+      transaction.raw_id = transactionData->find("id")->toUInt64();
+      if(transaction.raw_id <= sinceRawId)
+      {
+        reachedKnown = true;
+        break;
+      }
+      if(rawIds.contains(transaction.raw_id))
+        continue;
+      rawIds.append(transaction.raw_id);
+      String type = transactionData->find("type")->toString();
+      if(type != "2")
+        continue;
+
+      String dateStr = transactionData->find("datetime")->toString();
+      if(dateStr.scanf("%d-%d-%d %d:%d:%d", &time.year, &time.month, &time.day, &time.hour, &time.min, &time.sec) != 6)
+        continue;
+      transaction.entity.time = time.toTimestamp();
+
+      double fee = Math::abs(transactionData->find("fee")->toDouble());
+
+      double value = transactionData->find("usd")->toDouble();
+      bool buy = value < 0.;
+      transaction.type = buy ? meguco_user_broker_transaction_buy : meguco_user_broker_transaction_sell;
+      double amount = Math::abs(transactionData->find("btc")->toDouble());
+      transaction.total = buy ? (Math::abs(value) + fee) : (Math::abs(value) - fee);
+      transaction.price = Math::abs(value) / Math::abs(amount);
+      transaction.amount = amount;
+
+      transactions.append(transaction);
+    }
+    if(sinceRawId == 0 || reachedKnown || count < pageSize)
+      break;
   }
 
   return true;
@@ -355,9 +389,21 @@ double BitstampBtcUsd::getOrderCharge(double amount, double price) const
   }
 }
 
-bool_t BitstampBtcUsd::request(const String& url, bool_t isPublic, const HashMap<String, Variant>& params, Variant& result)
+bool_t BitstampBtcUsd::request(const String& url, bool_t isPublic, const HashMap<String, Variant>& params, RateLimiter::Priority priority, const Json::Value*& result)
 {
-  avoidSpamming();
+  // the broker handles one request at a time, so lower priority requests are refused instead of delaying the
+  // requests behind them when the budget is tight
+  for(int64_t wait; !rateLimiter.tryAcquire(priority, Time::time(), wait);)
+  {
+    if(priority != RateLimiter::highPriority && wait > maxLowPriorityWait)
+    {
+      error.printf("Request limit reached. Try again in %d seconds.", (int_t)((wait + 999) / 1000));
+      return false;
+    }
+    Thread::sleep(wait);
+  }
+
+  arena.reset();
 
   Buffer buffer;
   if (isPublic)
@@ -379,7 +425,7 @@ bool_t BitstampBtcUsd::request(const String& url, bool_t isPublic, const HashMap
     nonce.printf("%llu", newNonce);
     String message = nonce + clientId + key;
     byte_t signatureBuffer[Sha256::digestSize];
-    Sha256::hmac((const byte_t*)(const char_t*)secret, secret.length(), (const byte_t*)(const char_t*)message, message.length(), signatureBuffer);
+    signer.sign((const byte_t*)(const char_t*)message, message.length(), signatureBuffer);
     String signature = Hex::toString(signatureBuffer, sizeof(signatureBuffer));
     signature.toUpperCase();
     
@@ -397,36 +443,27 @@ bool_t BitstampBtcUsd::request(const String& url, bool_t isPublic, const HashMap
     }
   }
 
-  if(!Json::parse(buffer, result) || result.isNull())
+  if(!Json::parse(buffer, arena, result) || result->isNull())
   {
     error = "Received unparsable data.";
     return false;
   }
-  else if(result.getType() == Variant::mapType && result.toMap().contains("error"))
+  else if(result->getType() == Json::Value::objectType && result->contains("error"))
   {
     List<String> errors;
     struct ErrorStringCollector
     {
-      static void collect(const Variant& var, List<String>& errors)
+      static void collect(const Json::Value* value, List<String>& errors)
       {
-        switch(var.getType())
+        switch(value->getType())
         {
-        case Variant::stringType:
-          errors.append(var.toString());
+        case Json::Value::stringType:
+          errors.append(value->toString());
           break;
-        case Variant::listType:
-          {
-            const List<Variant>& list = var.toList();
-            for(List<Variant>::Iterator i = list.begin(), end = list.end(); i != end; ++i)
-              collect(*i, errors);
-          }
-          break;
-        case Variant::mapType:
-          {
-            const HashMap<String, Variant>& map = var.toMap();
-            for(HashMap<String, Variant>::Iterator i = map.begin(), end = map.end(); i != end; ++i)
-              collect(*i, errors);
-          }
+        case Json::Value::arrayType:
+        case Json::Value::objectType:
+          for(const Json::Value* i = value->getFirst(); i; i = i->getNext())
+            collect(i, errors);
           break;
         default:
           break;
@@ -448,19 +485,3 @@ bool_t BitstampBtcUsd::request(const String& url, bool_t isPublic, const HashMap
   else
     return true;
 }
-
-void_t BitstampBtcUsd::avoidSpamming()
-{
-  const int64_t queryDelay = 1337LL;
-  int64_t now = Time::time();
-  int64_t elapsed = lastRequestTime == 0 ? queryDelay : (now - lastRequestTime);
-  if(elapsed < queryDelay)
-  {
-    int64_t sleepMs = queryDelay - elapsed;
-    Thread::sleep(sleepMs);
-    lastRequestTime = now + sleepMs;
-  }
-  else
-    lastRequestTime = now;
-  // TODO: allow more than 1 request per second but limit requests to 600 per 10 minutes
-}
@@ -5,6 +5,9 @@
 
 #include "Tools/Broker.h"
 #include "Tools/HttpRequest.h"
+#include "Tools/Json.h"
+#include "Tools/RateLimiter.h"
+#include "Tools/Sha256.h"
 
 class BitstampBtcUsd : public Broker
 {
@@ -15,6 +18,8 @@ private:
   String clientId;
   String key;
   String secret;
+  Sha256::Hmac signer;
+  String apiUrl;
 
   meguco_user_broker_balance_entity balance;
   bool_t balanceLoaded;
@@ -24,8 +29,9 @@ private:
   String error;
 
   HttpRequest httpRequest;
+  Json::Arena arena;
 
-  int64_t lastRequestTime;
+  RateLimiter rateLimiter;
   uint64_t lastNonce;
 
   //HashMap<uint32_t, String> entityIds;
@@ -33,22 +39,23 @@ private:
   //uint32_t nextEntityId;
 
 private:
-  bool_t request(const String& url, bool_t isPublic, const HashMap<String, Variant>& params, Variant& result);
-
-  void_t avoidSpamming();
+  bool_t request(const String& url, bool_t isPublic, const HashMap<String, Variant>& params, RateLimiter::Priority priority, const Json::Value*& result);
 
   double getOrderCharge(double amount, double price) const;
   double getMaxSellAmout() const;
   double getMaxBuyAmout(double price) const;
 
-  bool_t loadBalanceAndFee();
-  bool_t loadOrders();
+  bool_t loadBalanceAndFee(RateLimiter::Priority priority);
+  bool_t loadOrders(RateLimiter::Priority priority);
+  bool_t loadOrders(List<meguco_user_broker_order_entity>& orders, RateLimiter::Priority priority);
+  bool_t loadBalance(meguco_user_broker_balance_entity& balance, RateLimiter::Priority priority);
 
 private: // Market
   virtual const String& getLastError() const {return error;}
+  virtual bool_t setServerUrl(const String& url);
   virtual bool_t loadOrders(List<meguco_user_broker_order_entity>& orders);
   virtual bool_t loadBalance(meguco_user_broker_balance_entity& balance);
-  virtual bool_t loadTransactions(List<meguco_user_broker_transaction_entity>& transactions);
+  virtual bool_t loadTransactions(uint64_t sinceRawId, List<meguco_user_broker_transaction_entity>& transactions);
   virtual bool_t createOrder(meguco_user_broker_order_type type, double price, double amount, double total, meguco_user_broker_order_entity& order);
   //virtual bool_t getOrder(uint64_t id, meguco_user_market_order_entity& order);
   virtual bool_t cancelOrder(uint64_t rawId);
@@ -22,6 +22,9 @@ int_t main(int_t argc, char_t* argv[])
   }
   String userName(argv[1], String::length(argv[1]));
   uint64_t brokerId = String::toUInt64(argv[2]);
+  String serverUrl;
+  if(argc > 3)
+    serverUrl = String(argv[3], String::length(argv[3]));
 
   Log::setFormat("%P> %m");
 
@@ -34,6 +37,7 @@ int_t main(int_t argc, char_t* argv[])
 
   // create connection to bot server
   Main main;
+  main.setServerUrl(serverUrl);
   for(;; Thread::sleep(10 * 1000))
   {
     if(!main.connect(userName, brokerId))
@@ -58,6 +62,7 @@ bool_t Main::connect(const String& userName, uint64_t brokerId)
   broker = 0;
   orders2.clear();
   transactions2.clear();
+  lastTransactionRawId = 0;
   balance.entity.id = 0;
 
   // establish connection to ZlimDB server
@@ -90,6 +95,11 @@ bool_t Main::connect(const String& userName, uint64_t brokerId)
   if(connection.getErrno() != 0)
     return false;
   broker = new BrokerImpl(brokerUserName, brokerKey, brokerSecret);
+  if(!serverUrl.isEmpty() && !broker->setServerUrl(serverUrl))
+  {
+    Log::errorf("Could not use server url %s.", (const char_t*)serverUrl);
+    return false;
+  }
 
   // load orders table
   if(!connection.createTable(tablePrefix + "/orders", userBrokerOrdersTableId))
@@ -116,7 +126,11 @@ bool_t Main::connect(const String& userName, uint64_t brokerId)
     for(const meguco_user_broker_transaction_entity* transaction = (const meguco_user_broker_transaction_entity*)zlimdb_get_first_entity((const zlimdb_header*)buffer, sizeof(meguco_user_broker_transaction_entity));
         transaction;
         transaction = (const meguco_user_broker_transaction_entity*)zlimdb_get_next_entity((const zlimdb_header*)buffer, sizeof(meguco_user_broker_transaction_entity), &transaction->entity))
+    {
       transactions2.append(transaction->entity.id, *transaction);
+      if(transaction->raw_id > lastTransactionRawId)
+        lastTransactionRawId = transaction->raw_id;
+    }
   }
   if(connection.getErrno() != 0)
     return false;
@@ -196,51 +210,28 @@ void_t Main::controlUserBroker(uint32_t requestId, uint64_t entityId, uint32_t c
     return (void_t)connection.sendControlResponse(requestId, 0, 0);
   case meguco_user_broker_control_refresh_transactions:
     {
+      // load transactions that are newer than the newest known transaction
       List<meguco_user_broker_transaction_entity> newTransactions;
-      if(!broker->loadTransactions(newTransactions))
+      if(!broker->loadTransactions(lastTransactionRawId, newTransactions))
       {
         addLogMessage(meguco_log_error, broker->getLastError());
         return (void_t)connection.sendControlResponse(requestId, 0);
       }
-      Map<int64_t, meguco_user_broker_transaction_entity*> sortedNewTransactions;
+      Map<uint64_t, meguco_user_broker_transaction_entity*> sortedNewTransactions;
       for(List<meguco_user_broker_transaction_entity>::Iterator i = newTransactions.begin(), end = newTransactions.end(); i != end; ++i)
-        sortedNewTransactions.insert((*i).entity.time, &*i);
-      HashMap<uint64_t, meguco_user_broker_transaction_entity> transactionsapByRaw;
-      for(HashMap<uint64_t, meguco_user_broker_transaction_entity>::Iterator i = transactions2.begin(), end = transactions2.end(); i != end; ++i)
-      {
-        meguco_user_broker_transaction_entity& transaction = *i;
-        transactionsapByRaw.append(transaction.raw_id, transaction);
-      }
-      transactions2.clear();
-      for(Map<int64_t, meguco_user_broker_transaction_entity*>::Iterator i = sortedNewTransactions.begin(), end = sortedNewTransactions.end(); i != end; ++i)
+        if((*i).raw_id > lastTransactionRawId)
+          sortedNewTransactions.insert((*i).raw_id, &*i);
+
+      // add them in the order they occurred
+      for(Map<uint64_t, meguco_user_broker_transaction_entity*>::Iterator i = sortedNewTransactions.begin(), end = sortedNewTransactions.end(); i != end; ++i)
       {
         meguco_user_broker_transaction_entity& transaction = **i;
-        HashMap<uint64_t, meguco_user_broker_transaction_entity>::Iterator it = transactionsapByRaw.find(transaction.raw_id);
-        if(it == transactionsapByRaw.end() || it->entity.id == 0)
-        { // add
-          uint64_t id;
-          if(connection.add(userBrokerTransactionsTableId, transaction.entity, id))
-          {
-            transaction.entity.id = id;
-            transactions2.append(transaction.entity.id, transaction);
-          }
-        }
-        else
-        { // update
-          transaction.entity.id = it->entity.id;
-          if(Memory::compare(&*it, &transaction, sizeof(transaction)) != 0 &&
-             connection.update(userBrokerTransactionsTableId, transaction.entity))
-            transactions2.append(transaction.entity.id, transaction);
-          else
-            transactions2.append(transaction.entity.id, *it);
-          transactionsapByRaw.remove(it);
-        }
-      }
-      for(HashMap<uint64_t, meguco_user_broker_transaction_entity>::Iterator i = transactionsapByRaw.begin(), end = transactionsapByRaw.end(); i != end; ++i)
-      { // remove
-        meguco_user_broker_transaction_entity& transaction = *i;
-        if(!connection.remove(userBrokerTransactionsTableId, transaction.entity.id))
-          transactions2.append(transaction.entity.id, transaction);
+        uint64_t id;
+        if(!connection.add(userBrokerTransactionsTableId, transaction.entity, id))
+          break;
+        transaction.entity.id = id;
+        transactions2.append(transaction.entity.id, transaction);
+        lastTransactionRawId = transaction.raw_id;
       }
     }
     return (void_t)connection.sendControlResponse(requestId, 0, 0);
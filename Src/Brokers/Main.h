@@ -12,9 +12,10 @@ class Broker;
 class Main : public ZlimdbConnection::Callback
 {
 public:
-  Main() : broker(0) {}
+  Main() : broker(0), lastTransactionRawId(0) {}
   ~Main();
 
+  void_t setServerUrl(const String& url) {serverUrl = url;}
   bool_t connect(const String& userName, uint64_t brokerId);
   bool_t process() {return connection.process();}
   String getErrorString() const {return connection.getErrorString();}
@@ -22,6 +23,7 @@ public:
 private:
   ZlimdbConnection connection;
   Broker* broker;
+  String serverUrl;
 
   uint32_t userBrokerTableId;
   uint32_t userBrokerOrdersTableId;
@@ -31,6 +33,7 @@ private:
 
   HashMap<uint64_t, meguco_user_broker_order_entity> orders2;
   HashMap<uint64_t, meguco_user_broker_transaction_entity> transactions2;
+  uint64_t lastTransactionRawId;
   meguco_user_broker_balance_entity balance;
 
 private: // ZlimdbConnection::Callback
@@ -13,9 +13,21 @@ public:
 
   virtual const String& getLastError() const = 0;
 
+  /**
+  * Replaces the address of the exchange, e.g. to connect to a local mock exchange.
+  * @param url The base url of the exchange, e.g. "http://localhost:8080".
+  * @return \c false when the broker does not support other servers
+  */
+  virtual bool_t setServerUrl(const String& url) {return false;}
+
   virtual bool_t loadOrders(List<meguco_user_broker_order_entity>& orders) = 0;
   virtual bool_t loadBalance(meguco_user_broker_balance_entity& balance) = 0;
-  virtual bool_t loadTransactions(List<meguco_user_broker_transaction_entity>& transactions) = 0;
+  /**
+  * Loads the transactions that are newer than a given transaction.
+  * @param sinceRawId The raw id of the newest known transaction or 0 to load the recent transactions.
+  * @param transactions Receives the transactions.
+  */
+  virtual bool_t loadTransactions(uint64_t sinceRawId, List<meguco_user_broker_transaction_entity>& transactions) = 0;
   virtual bool_t createOrder(meguco_user_broker_order_type type, double price, double amount, double total, meguco_user_broker_order_entity& order) = 0;
   //virtual bool_t getOrder(uint64_t id, meguco_user_market_order_entity& order) = 0;
   virtual bool_t cancelOrder(uint64_t rawId) = 0;
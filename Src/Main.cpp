@@ -5,6 +5,7 @@
 #include <nstd/Process.h>
 #include <nstd/Error.h>
 #include <nstd/HashSet.h>
+#include <nstd/Time.h>
 
 #include <megucoprotocol.h>
 
@@ -13,12 +14,18 @@
 int_t main(int_t argc, char_t* argv[])
 {
   String logFile;
+  uint64_t latencyCpus = 0;
+  uint64_t botMemoryLimit = 0;
+  bool_t useMarketHost = false;
   String binaryDir = File::dirname(String(argv[0], String::length(argv[0])));
 
   // parse parameters
   {
     Process::Option options[] = {
         {'b', "daemon", Process::argumentFlag | Process::optionalFlag},
+        {'c', "latency-cpus", Process::argumentFlag},
+        {'m', "bot-memory", Process::argumentFlag},
+        {'s', "market-host", Process::optionFlag},
         {'h', "help", Process::optionFlag},
     };
     Process::Arguments arguments(argc, argv, options);
@@ -30,6 +37,20 @@ int_t main(int_t argc, char_t* argv[])
       case 'b':
         logFile = argument.isEmpty() ? String("MegucoServer.log") : argument;
         break;
+      case 'c':
+        for(size_t pos = 0; pos < argument.length();)
+        {
+          uint_t cpu = argument.token(',', pos).toUInt();
+          if(cpu < 64)
+            latencyCpus |= 1ULL << cpu;
+        }
+        break;
+      case 'm':
+        botMemoryLimit = argument.toUInt64() * 1024 * 1024;
+        break;
+      case 's':
+        useMarketHost = true;
+        break;
       case '?':
         Console::errorf("Unknown option: %s.\n", (const char_t*)argument);
         return -1;
@@ -37,8 +58,16 @@ int_t main(int_t argc, char_t* argv[])
         Console::errorf("Option %s required an argument.\n", (const char_t*)argument);
         return -1;
       default:
-        Console::errorf("Usage: %s [-b]\n\
-  -b, --daemon[=<file>]   Detach from calling shell and write output to <file>.\n", argv[0]);
+        Console::errorf("Usage: %s [-b] [-c <cpus>] [-m <size>] [-s]\n\
+  -b, --daemon[=<file>]   Detach from calling shell and write output to <file>.\n\
+  -c, --latency-cpus=<cpus>\n\
+                          Reserve a comma separated list of cpus for market\n\
+                          processes, brokers and live bot sessions. Market\n\
+                          processes and brokers run with real-time priority\n\
+                          on these cpus.\n\
+  -m, --bot-memory=<size> Limit the address space of bot processes to <size> MiB.\n\
+  -s, --market-host       Run all markets in one MarketHost process instead of\n\
+                          one process per market.\n", argv[0]);
         return -1;
       }
   }
@@ -58,7 +87,7 @@ int_t main(int_t argc, char_t* argv[])
 #endif
 
   // initialize process manager
-  Main server(binaryDir);
+  Main server(binaryDir, latencyCpus, botMemoryLimit, useMarketHost);
   if(!server.init())
   {
     Log::errorf("Could not initialize process: %s", (const char_t*)server.getErrorString());
@@ -103,7 +132,7 @@ bool_t Main::connect()
   autostartProcesses.append("Services/Market.exe");
   autostartProcesses.append("Services/User.exe");
 #else
-  autostartProcesses.append("Services/Market");
+  autostartProcesses.append(useMarketHost ? String("Services/Market --market-host") : String("Services/Market"));
   autostartProcesses.append("Services/User");
 #endif
 
@@ -112,6 +141,8 @@ bool_t Main::connect()
     return error = connection.getErrorString(), false;
   if(!connection.subscribe(processesTableId, zlimdb_subscribe_flag_responder))
     return error = connection.getErrorString(), false;
+  if(!connection.createTable("processes/stats", processStatsTableId))
+    return error = connection.getErrorString(), false;
   HashMap<uint64_t, Process> processesInTable;
   String command;
   while(connection.getResponse(buffer))
@@ -188,7 +219,7 @@ bool_t Main::connect()
     Process& process = localProcesses.append(id, Process());
     process.entityId = id;
     process.command = cmd;
-    processManager.startProcess(id, binaryDir + "/" + cmd);
+    processManager.startProcess(id, binaryDir + "/" + cmd, getRestartPolicy(cmd), getResourceLimits(cmd), getSchedulingProfile(cmd));
   }
 
   return true;
@@ -198,17 +229,62 @@ bool_t Main::process()
 {
   for(;;)
   {
+    // notifications that were queued while the connection was down are handled before waiting for the first time
+    __atomic_store_n(&interruptPending, 0, __ATOMIC_SEQ_CST);
+    uint64_t entityId;
+    while(terminatedProcesses.pop(entityId))
+      removeProcess(entityId);
+    ProcessManager::Usage usage;
+    while(sampledProcessUsage.pop(usage))
+      addProcessStats(usage);
     if(!connection.process())
       return error = connection.getErrorString(), false;
-    List<uint64_t> terminatedProcesses;
-    mutex.lock();
-    terminatedProcesses.swap(this->terminatedProcesses);
-    mutex.unlock();
-    for(List<uint64_t>::Iterator i = terminatedProcesses.begin(), end = terminatedProcesses.end(); i != end; ++i)
-      removeProcess(*i);
   }
 }
 
+ProcessManager::RestartPolicy Main::getRestartPolicy(const String& command)
+{
+  // market feeds and services are restarted when they crash, bots and brokers are started and stopped by the user service
+  if(command.startsWith("Markets/") || command.startsWith("MarketHost") || command.startsWith("Services/"))
+    return ProcessManager::RestartPolicy(true);
+  return ProcessManager::RestartPolicy();
+}
+
+ProcessManager::ResourceLimits Main::getResourceLimits(const String& command) const
+{
+  ProcessManager::ResourceLimits limits;
+  if(command.startsWith("Bots/"))
+    limits.memory = botMemoryLimit;
+  return limits;
+}
+
+ProcessManager::SchedulingProfile Main::getSchedulingProfile(const String& command) const
+{
+  // market feeds and brokers run with a higher priority, live bot sessions with a lower priority and simulations only
+  // get the cpu and the disk when they are not used otherwise. real-time priority is only used when cpus were reserved
+  // for it, since a busy real-time process could otherwise starve the rest of the system.
+  typedef ProcessManager::SchedulingProfile Profile;
+  if(command.startsWith("Markets/") || command.startsWith("MarketHost"))
+  {
+    if(latencyCpus)
+      return Profile(Profile::fifoPolicy, 10, -5, latencyCpus, Profile::bestEffortIoClass, 0);
+    return Profile(Profile::otherPolicy, 0, -5, 0, Profile::bestEffortIoClass, 0);
+  }
+  if(command.startsWith("Brokers/"))
+  {
+    if(latencyCpus)
+      return Profile(Profile::fifoPolicy, 5, -5, latencyCpus, Profile::bestEffortIoClass, 2);
+    return Profile(Profile::otherPolicy, 0, -3, 0, Profile::bestEffortIoClass, 2);
+  }
+  if(command.startsWith("Bots/"))
+  {
+    if(command.endsWith(" --simulation"))
+      return Profile(Profile::idlePolicy, 0, 0, latencyCpus ? ~latencyCpus : 0, Profile::idleIoClass, 7);
+    return Profile(Profile::otherPolicy, 0, 5, latencyCpus, Profile::bestEffortIoClass, 4);
+  }
+  return Profile();
+}
+
 void_t Main::removeProcess(uint64_t entityId)
 {
   HashMap<uint64_t, Process>::Iterator it = localProcesses.find(entityId);
@@ -219,12 +295,46 @@ void_t Main::removeProcess(uint64_t entityId)
   localProcesses.remove(it);
 }
 
-void_t Main::terminatedProcess(uint64_t entityId)
+void_t Main::interrupt()
+{
+  // the connection is interrupted only once until the main loop has picked up the queued notifications
+  if(__atomic_exchange_n(&interruptPending, 1, __ATOMIC_SEQ_CST) == 0)
+    connection.interrupt();
+}
+
+bool_t Main::terminatedProcess(uint64_t entityId)
+{
+  bool_t queued = terminatedProcesses.push(entityId);
+  interrupt();
+  return queued;
+}
+
+void_t Main::addProcessStats(const ProcessManager::Usage& usage)
+{
+  if(!localProcesses.contains(usage.id))
+    return;
+  meguco_process_stats_entity stats;
+  ZlimdbConnection::setEntityHeader(stats.entity, 0, Time::time(), sizeof(stats));
+  stats.process_id = usage.id;
+  stats.pid = usage.pid;
+  stats.cpu_time = usage.cpuTime;
+  stats.resident_memory = usage.residentMemory;
+  stats.read_bytes = usage.readBytes;
+  stats.written_bytes = usage.writtenBytes;
+  stats.voluntary_context_switches = usage.voluntaryContextSwitches;
+  stats.involuntary_context_switches = usage.involuntaryContextSwitches;
+  uint64_t id;
+  if(!connection.add(processStatsTableId, stats.entity, id))
+    Log::warningf("Could not add process stats: %s", (const char_t*)connection.getErrorString());
+}
+
+void_t Main::sampledUsage(const Array<ProcessManager::Usage>& usage)
 {
-  mutex.lock();
-  terminatedProcesses.append(entityId);
-  mutex.unlock();
-  connection.interrupt();
+  // samples that do not fit into the queue are dropped, the next interval brings new ones
+  for(size_t i = 0, count = usage.size(); i < count; ++i)
+    if(!sampledProcessUsage.push(usage[i]))
+      break;
+  interrupt();
 }
 
 void_t Main::controlEntity(uint32_t tableId, uint32_t requestId, uint64_t entityId, uint32_t controlCode, const byte_t* data, size_t size)
@@ -257,7 +367,7 @@ void_t Main::controlProcess(uint32_t requestId, uint64_t entityId, uint32_t cont
       Process& process = localProcesses.append(id, Process());
       process.entityId = id;
       process.command = cmd;
-      processManager.startProcess(id, binaryDir + "/" + cmd);
+      processManager.startProcess(id, binaryDir + "/" + cmd, getRestartPolicy(cmd), getResourceLimits(cmd), getSchedulingProfile(cmd));
       return (void_t)connection.sendControlResponse(requestId, (const byte_t*)&id, sizeof(id));
     }
     break;
@@ -2,16 +2,22 @@
 #pragma once
 
 #include <nstd/HashMap.h>
-#include <nstd/List.h>
-#include <nstd/Mutex.h>
 
 #include "Tools/ZlimdbConnection.h"
 #include "Tools/ProcessManager.h"
+#include "Tools/MpscQueue.h"
+#include "Tools/Protocol.h"
 
 class Main : public ZlimdbConnection::Callback, public ProcessManager::Callback
 {
 public:
-  Main(const String& binaryDir) : binaryDir(binaryDir) {}
+  /**
+  * @param binaryDir The directory of the binaries of the started processes.
+  * @param latencyCpus The cpus that are reserved for latency critical processes or 0.
+  * @param botMemoryLimit The maximum address space of a bot process in bytes or 0.
+  * @param useMarketHost Whether the market service should run all markets in one MarketHost process.
+  */
+  Main(const String& binaryDir, uint64_t latencyCpus, uint64_t botMemoryLimit, bool_t useMarketHost) : binaryDir(binaryDir), latencyCpus(latencyCpus), botMemoryLimit(botMemoryLimit), useMarketHost(useMarketHost), interruptPending(0) {}
   bool_t init();
   const String& getErrorString() const {return error;}
   bool_t connect();
@@ -27,19 +33,31 @@ private:
 private:
   String error;
   String binaryDir;
+  uint64_t latencyCpus;
+  uint64_t botMemoryLimit;
+  bool_t useMarketHost;
   ZlimdbConnection connection;
   uint32_t processesTableId;
+  uint32_t processStatsTableId;
   ProcessManager processManager;
   HashMap<uint64_t, Process> localProcesses;
-  Mutex mutex;
-  List<uint64_t> terminatedProcesses;
+  MpscQueue<uint64_t, 1024> terminatedProcesses;
+  MpscQueue<ProcessManager::Usage, 1024> sampledProcessUsage;
+  uint32_t interruptPending;
 
 private:
+  static ProcessManager::RestartPolicy getRestartPolicy(const String& command);
+  ProcessManager::ResourceLimits getResourceLimits(const String& command) const;
+  ProcessManager::SchedulingProfile getSchedulingProfile(const String& command) const;
+
   void_t removeProcess(uint64_t entityId);
+  void_t addProcessStats(const ProcessManager::Usage& usage);
+  void_t interrupt();
   void_t controlProcess(uint32_t requestId, uint64_t entityId, uint32_t controlCode, const byte_t* data, size_t size);
 
 private: // ProcessManager::Callback
-  virtual void_t terminatedProcess(uint64_t entityId);
+  virtual bool_t terminatedProcess(uint64_t entityId);
+  virtual void_t sampledUsage(const Array<ProcessManager::Usage>& usage);
 
 private: // ZlimdbConnection::Callback
   virtual void_t addedEntity(uint32_t tableId, const zlimdb_entity& entity) {}
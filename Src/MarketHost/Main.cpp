@@ -0,0 +1,335 @@
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <nstd/Log.h>
+#include <nstd/Console.h>
+#include <nstd/Process.h>
+#include <nstd/Thread.h>
+#include <nstd/Time.h>
+#include <nstd/Error.h>
+
+#include "BitstampBtcUsd.h"
+#include "BitfinexBtcUsd.h"
+#include "BtcChinaBtcCny.h"
+#include "BtceBtcUsd.h"
+#include "HuobiBtcCny.h"
+#include "KrakenBtcUsd.h"
+
+#include "Main.h"
+
+static const char_t* marketNames[] = {"BitstampBtcUsd", "BitfinexBtcUsd", "BtcChinaBtcCny", "BtceBtcUsd", "HuobiBtcCny", "KrakenBtcUsd"};
+
+int_t main(int_t argc, char_t* argv[])
+{
+  String serverUrl;
+  List<String> markets;
+
+  // parse parameters
+  {
+    Process::Option options[] = {
+        {'s', "server", Process::argumentFlag},
+        {'h', "help", Process::optionFlag},
+    };
+    Process::Arguments arguments(argc, argv, options);
+    int_t character;
+    String argument;
+    while(arguments.read(character, argument))
+      switch(character)
+      {
+      case 's':
+        serverUrl = argument;
+        break;
+      case '\0':
+        markets.append(argument);
+        break;
+      case '?':
+        Console::errorf("Unknown option: %s.\n", (const char_t*)argument);
+        return -1;
+      case ':':
+        Console::errorf("Option %s required an argument.\n", (const char_t*)argument);
+        return -1;
+      default:
+        Console::errorf("Usage: %s [-s <url>] [<market> ...]\n\
+  -s, --server=<url>   Connect to the exchange at <url> instead of the public servers.\n", argv[0]);
+        return -1;
+      }
+  }
+  Log::setFormat("%P> %m");
+
+  Main main;
+  main.setServerUrl(serverUrl);
+  if(!markets.isEmpty())
+  {
+    for(List<String>::Iterator i = markets.begin(), end = markets.end(); i != end; ++i)
+      if(!main.addMarket(*i))
+        return Log::errorf("Unknown market or unsupported server url: %s", (const char_t*)*i), 1;
+  }
+  else
+    for(size_t i = 0; i < sizeof(marketNames) / sizeof(*marketNames); ++i)
+      main.addMarket(String(marketNames[i], String::length(marketNames[i]))); // markets that do not support the server url are skipped
+
+  for(;; Thread::sleep(10 * 1000))
+  {
+    if(!main.connect())
+    {
+      Log::errorf("Could not connect to zlimdb server: %s", (const char_t*)main.getErrorString());
+      continue;
+    }
+    Log::infof("Connected to zlimdb server.");
+    main.process();
+    Log::errorf("Lost connection to zlimdb server: %s", (const char_t*)main.getErrorString());
+  }
+  return 0;
+}
+
+Main::Main() : multi(*this)
+{
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+  timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  epoll_event event;
+  event.events = EPOLLIN;
+  event.data.fd = timerFd;
+  epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &event);
+
+  const ZlimdbConnection::Counters& counters = zlimdbConnection.getCounters();
+  stats.addCounter("zlimdb sent messages", counters.sentMessages);
+  stats.addCounter("zlimdb sent bytes", counters.sentBytes);
+  stats.addCounter("zlimdb received messages", counters.receivedMessages);
+  stats.addCounter("zlimdb received bytes", counters.receivedBytes);
+}
+
+Main::~Main()
+{
+  for(List<Session*>::Iterator i = sessions.begin(), end = sessions.end(); i != end; ++i)
+    delete *i;
+  ::close(timerFd);
+  ::close(epollFd);
+}
+
+bool_t Main::addMarket(const String& name)
+{
+  Market* market = 0;
+  if(name == "BitstampBtcUsd")
+    market = new BitstampBtcUsd;
+  else if(name == "BitfinexBtcUsd")
+    market = new BitfinexBtcUsd;
+  else if(name == "BtcChinaBtcCny")
+    market = new BtcChinaBtcCny;
+  else if(name == "BtceBtcUsd")
+    market = new BtceBtcUsd;
+  else if(name == "HuobiBtcCny")
+    market = new HuobiBtcCny;
+  else if(name == "KrakenBtcUsd")
+    market = new KrakenBtcUsd;
+  else
+    return false;
+  if(!serverUrl.isEmpty() && !market->setServerUrl(serverUrl))
+  {
+    delete market;
+    return false;
+  }
+  sessions.append(new Session(*this, market));
+  return true;
+}
+
+bool_t Main::connect()
+{
+  if(zlimdbConnection.isOpen())
+    return true;
+
+  if(!zlimdbConnection.connect(*this))
+    return error = zlimdbConnection.getErrorString(), false;
+  for(List<Session*>::Iterator i = sessions.begin(), end = sessions.end(); i != end; ++i)
+  {
+    Session& session = **i;
+    const String& channelName = session.market->getChannelName();
+    if(!zlimdbConnection.createTable(String("markets/") + channelName + "/trades", session.tradesTableId) ||
+       !zlimdbConnection.createTable(String("markets/") + channelName + "/ticker", session.tickerTableId) ||
+       !session.candleBuilder.open(channelName) ||
+       !session.tradeSink.open(session.tradesTableId))
+    {
+      error = zlimdbConnection.getErrorString();
+      zlimdbConnection.close();
+      return false;
+    }
+    if(!session.tradeSink.isRingOpen() && !session.tradeSink.openRing(channelName))
+      Log::warningf("Could not create trade ring of %s: %s", (const char_t*)channelName, (const char_t*)Error::getErrorString());
+  }
+  return true;
+}
+
+void_t Main::process()
+{
+  epoll_event events[64];
+  for(;;)
+  {
+    // connect or step markets that are due
+    int64_t now = Time::time();
+    int64_t nextTime = now + 60 * 1000;
+    for(List<Session*>::Iterator i = sessions.begin(), end = sessions.end(); i != end; ++i)
+    {
+      Session& session = **i;
+      if(session.nextStepTime <= now)
+      {
+        if(!session.market->isOpen())
+        {
+          const String& channelName = session.market->getChannelName();
+          Log::infof("Connecting to %s...", (const char_t*)channelName);
+          if(!session.market->connect())
+          {
+            Log::errorf("Could not connect to %s: %s", (const char_t*)channelName, (const char_t*)session.market->getErrorString());
+            session.nextStepTime = now + 10 * 1000;
+            continue;
+          }
+          Log::infof("Connected to %s.", (const char_t*)channelName);
+        }
+        step(session);
+        now = Time::time();
+      }
+      if(session.nextStepTime < nextTime)
+        nextTime = session.nextStepTime;
+    }
+    if(!zlimdbConnection.isOpen())
+      break;
+    stats.check(now);
+
+    // wait for the next event
+    int64_t timeout = multi.getTimeout();
+    if(timeout >= 0 && now + timeout < nextTime)
+      nextTime = now + timeout;
+    timeout = nextTime - now;
+    if(timeout < 1)
+      timeout = 1; // a zero value would disarm the timer
+    itimerspec timerSpec = {};
+    timerSpec.it_value.tv_sec = timeout / 1000;
+    timerSpec.it_value.tv_nsec = (timeout % 1000) * 1000000L;
+    timerfd_settime(timerFd, 0, &timerSpec, 0);
+    int_t count = epoll_wait(epollFd, events, sizeof(events) / sizeof(*events), -1);
+    if(count < 0)
+    {
+      if(errno == EINTR)
+        continue;
+      error = Error::getErrorString();
+      break;
+    }
+
+    // handle events
+    bool_t completed = false;
+    for(int_t i = 0; i < count; ++i)
+    {
+      const epoll_event& event = events[i];
+      int_t fd = event.data.fd;
+      if(fd == timerFd)
+      {
+        uint64_t expirations;
+        if(::read(timerFd, &expirations, sizeof(expirations)) < 0) {}
+        if(multi.getTimeout() == 0)
+          completed |= multi.process();
+        continue;
+      }
+      HashMap<int_t, Session*>::Iterator it = marketSockets.find(fd);
+      if(it != marketSockets.end())
+      {
+        Session& session = **it;
+        if(session.market->isOpen())
+          step(session);
+      }
+      else
+        completed |= multi.process(fd, (event.events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0, (event.events & EPOLLOUT) != 0);
+    }
+
+    // let markets handle completed http requests
+    if(completed)
+      for(List<Session*>::Iterator i = sessions.begin(), end = sessions.end(); i != end; ++i)
+      {
+        Session& session = **i;
+        if(session.market->isOpen())
+          step(session);
+      }
+  }
+
+  for(List<Session*>::Iterator i = sessions.begin(), end = sessions.end(); i != end; ++i)
+    close(**i);
+}
+
+void_t Main::step(Session& session)
+{
+  int64_t timeout;
+  if(!session.market->step(session, multi, timeout))
+  {
+    Log::errorf("Lost connection to %s: %s", (const char_t*)session.market->getChannelName(), (const char_t*)session.market->getErrorString());
+    close(session); // reconnect to reload the trade history
+    session.nextStepTime = Time::time() + 10 * 1000;
+    return;
+  }
+  session.nextStepTime = Time::time() + timeout;
+  updateSocket(session);
+}
+
+void_t Main::close(Session& session)
+{
+  if(session.socket >= 0)
+  {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, session.socket, 0);
+    marketSockets.remove(session.socket);
+    session.socket = -1;
+  }
+  session.market->close();
+}
+
+void_t Main::updateSocket(Session& session)
+{
+  int_t socket = session.market->getSocket();
+  if(socket == session.socket)
+    return;
+  if(session.socket >= 0)
+  {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, session.socket, 0);
+    marketSockets.remove(session.socket);
+  }
+  session.socket = socket;
+  if(socket >= 0)
+  {
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = socket;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, socket, &event);
+    marketSockets.append(socket, &session);
+  }
+}
+
+void_t Main::updatedSocket(int_t fd, bool_t read, bool_t write)
+{
+  epoll_event event;
+  event.events = (read ? EPOLLIN : 0) | (write ? EPOLLOUT : 0);
+  event.data.fd = fd;
+  if(epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event) != 0 && errno == ENOENT)
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+}
+
+void_t Main::removedSocket(int_t fd)
+{
+  epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, 0);
+}
+
+bool_t Main::Session::receivedTrade(const Market::Trade& trade)
+{
+  return tradeSink.add(trade);
+}
+
+bool_t Main::Session::receivedTicker(const Market::Ticker& ticker)
+{
+  meguco_ticker_entity tickerEntity;
+  tickerEntity.entity.id = 0;
+  tickerEntity.entity.time = ticker.time;
+  tickerEntity.entity.size = sizeof(tickerEntity);
+  tickerEntity.ask = ticker.ask;
+  tickerEntity.bid = ticker.bid;
+  uint64_t id;
+  if(!main.zlimdbConnection.add(tickerTableId, tickerEntity.entity, id))
+    return false;
+  return true;
+}
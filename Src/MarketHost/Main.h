@@ -0,0 +1,81 @@
+
+#pragma once
+
+#include <nstd/HashMap.h>
+#include <nstd/List.h>
+
+#include <megucoprotocol.h>
+
+#include "Tools/ZlimdbConnection.h"
+#include "Tools/HttpRequest.h"
+#include "Tools/Market.h"
+#include "Tools/TradeSink.h"
+#include "Tools/CandleBuilder.h"
+#include "Tools/Stats.h"
+
+class Main : public ZlimdbConnection::Callback, public HttpRequest::Multi::Callback
+{
+public:
+  Main();
+  ~Main();
+
+  const String& getErrorString() const {return error;}
+
+  void_t setServerUrl(const String& url) {serverUrl = url;}
+  bool_t addMarket(const String& name);
+
+  bool_t connect();
+  void_t process();
+
+private:
+  class Session : public Market::Callback
+  {
+  public:
+    Main& main;
+    Market* market;
+    uint32_t tradesTableId;
+    uint32_t tickerTableId;
+    CandleBuilder candleBuilder;
+    TradeSink tradeSink;
+    int_t socket;
+    int64_t nextStepTime;
+
+  public:
+    Session(Main& main, Market* market) : main(main), market(market), candleBuilder(main.zlimdbConnection), tradeSink(main.zlimdbConnection, &candleBuilder), socket(-1), nextStepTime(0)
+    {
+      tradeSink.setStats(main.stats, market->getChannelName() + " ");
+    }
+    ~Session() {delete market;}
+
+  public: // Market::Callback
+    virtual bool_t receivedTrade(const Market::Trade& trade);
+    virtual bool_t receivedTicker(const Market::Ticker& ticker);
+    virtual bool_t flushTrades() {return tradeSink.flush();}
+  };
+
+private:
+  Stats stats;
+  ZlimdbConnection zlimdbConnection;
+  HttpRequest::Multi multi;
+  int_t epollFd;
+  int_t timerFd;
+  List<Session*> sessions;
+  HashMap<int_t, Session*> marketSockets;
+  String serverUrl;
+  String error;
+
+private:
+  void_t step(Session& session);
+  void_t close(Session& session);
+  void_t updateSocket(Session& session);
+
+private: // ZlimdbConnection::Callback
+  virtual void_t addedEntity(uint32_t tableId, const zlimdb_entity& entity) {};
+  virtual void_t updatedEntity(uint32_t tableId, const zlimdb_entity& entity) {};
+  virtual void_t removedEntity(uint32_t tableId, uint64_t entityId) {};
+  virtual void_t controlEntity(uint32_t tableId, uint32_t requestId, uint64_t entityId, uint32_t controlCode, const byte_t* data, size_t size) {};
+
+private: // HttpRequest::Multi::Callback
+  virtual void_t updatedSocket(int_t fd, bool_t read, bool_t write);
+  virtual void_t removedSocket(int_t fd);
+};
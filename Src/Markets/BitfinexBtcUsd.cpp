@@ -2,7 +2,7 @@
 #include <nstd/Thread.h>
 #include <nstd/Time.h>
 #include <nstd/Console.h>
-#include <nstd/Variant.h>
+#include <nstd/Array.h>
 
 #include "Tools/Json.h"
 #include "Tools/HttpRequest.h"
@@ -19,51 +19,86 @@ bool_t BitfinexBtcUsd::process(Callback& callback)
 {
   HttpRequest httpRequest;
   Buffer data;
-  String dataStr;
   for(;; Thread::sleep(14000))
   {
-    String url("https://api.bitfinex.com/v1/trades/btcusd");
-    if(lastTimestamp != 0)
-      url.printf("https://api.bitfinex.com/v1/trades/btcusd?timestamp=%llu", lastTimestamp);
-    if(!httpRequest.get(url, data, false))
+    if(!httpRequest.get(getUrl(), data, false))
     {
       error = httpRequest.getErrorString();
       open = false;
       return false;
     }
+    if(!handleResponse(data, callback))
+      return false;
+  }
+
+  return false; // unreachable
+}
+
+bool_t BitfinexBtcUsd::step(Callback& callback, HttpRequest::Multi& multi, int64_t& timeout)
+{
+  bool_t completed;
+  if(!pollingRequest.step(multi, getUrl(), timeout, completed))
+  {
+    error = pollingRequest.getErrorString();
+    open = false;
+    return false;
+  }
+  if(completed)
+    return handleResponse(pollingRequest.getData(), callback);
+  return true;
+}
 
-    dataStr.attach((const char_t*)(byte_t*)data, data.size());
-    Variant dataVar;
-    if(!Json::parse(dataStr, dataVar))
+String BitfinexBtcUsd::getUrl() const
+{
+  String url("https://api.bitfinex.com/v1/trades/btcusd");
+  if(lastTimestamp != 0)
+    url.printf("https://api.bitfinex.com/v1/trades/btcusd?timestamp=%llu", lastTimestamp);
+  return url;
+}
+
+bool_t BitfinexBtcUsd::handleResponse(const Buffer& data, Callback& callback)
+{
+  Array<Trade> trades;
+  String key;
+  Json::Parser parser(data);
+  if(parser.beginArray())
+    while(parser.nextElement())
     {
-      error = "Could not parse trade data.";
-      open = false;
-      return false;
+      if(!parser.beginObject())
+        break;
+      Trade& trade = trades.append(Trade());
+      while(parser.nextMember(key))
+        if(key == "tid")
+          parser.readUInt64(trade.id);
+        else if(key == "timestamp")
+          parser.readUInt64(trade.time);
+        else if(key == "price")
+          parser.readDouble(trade.price);
+        else if(key == "amount")
+          parser.readDouble(trade.amount);
+        else
+          parser.skipValue();
     }
+  if(parser.hasError())
+  {
+    error = "Could not parse trade data.";
+    open = false;
+    return false;
+  }
 
-    const List<Variant>& tradesList = dataVar.toList();
-    Trade trade;
-    if(!tradesList.isEmpty())
-      for(List<Variant>::Iterator i = --List<Variant>::Iterator(tradesList.end()), begin = tradesList.begin();; --i)
-      {
-        const HashMap<String, Variant>& tradeData = i->toMap();
-        trade.id = tradeData.find("tid")->toInt64();
-        int64_t timestamp = tradeData.find("timestamp")->toInt64();
-        trade.time = timestamp * 1000LL;
-        trade.price = tradeData.find("price")->toDouble();
-        trade.amount = tradeData.find("amount")->toDouble();
-        trade.flags = 0;
-        if(trade.id > lastTradeId)
-        {
-          if(!callback.receivedTrade(trade))
-            return false;
-          lastTradeId = trade.id;
-          lastTimestamp = timestamp;
-        }
-        if(i == begin)
-          break;
-      }
+  for(size_t i = trades.size(); i-- > 0;)
+  {
+    Trade& trade = trades[i];
+    if(trade.id > lastTradeId)
+    {
+      int64_t timestamp = trade.time;
+      trade.time = timestamp * 1000LL;
+      if(!callback.receivedTrade(trade))
+        return false;
+      lastTradeId = trade.id;
+      lastTimestamp = timestamp;
+    }
   }
 
-  return false; // unreachable
+  return callback.flushTrades();
 }
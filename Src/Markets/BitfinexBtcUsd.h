@@ -4,11 +4,12 @@
 #include <nstd/List.h>
 
 #include "Tools/Market.h"
+#include "Tools/PollingRequest.h"
 
 class BitfinexBtcUsd : public Market
 {
 public:
-  BitfinexBtcUsd() : open(false), lastTradeId(0), lastTimestamp(0) {}
+  BitfinexBtcUsd() : open(false), pollingRequest(14000, false), lastTradeId(0), lastTimestamp(0) {}
 
   virtual String getChannelName() const {return String("Bitfinex/BTC/USD");}
   virtual bool_t connect();
@@ -16,12 +17,16 @@ public:
   virtual bool_t isOpen() const {return open;}
   virtual const String& getErrorString() const {return error;}
   virtual bool_t process(Callback& callback);
+  virtual bool_t step(Callback& callback, HttpRequest::Multi& multi, int64_t& timeout);
 
 private:
   String error;
   bool_t open;
+  PollingRequest pollingRequest;
 
   uint64_t lastTradeId;
   int64_t lastTimestamp;
 
+  String getUrl() const;
+  bool_t handleResponse(const Buffer& data, Callback& callback);
 };
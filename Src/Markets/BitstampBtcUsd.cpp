@@ -2,18 +2,30 @@
 #include <nstd/Thread.h>
 #include <nstd/Time.h>
 #include <nstd/Console.h>
-#include <nstd/Variant.h>
+#include <nstd/Array.h>
 
 #include "Tools/Json.h"
 #include "Tools/HttpRequest.h"
 
 #include "BitstampBtcUsd.h"
 
+bool_t BitstampBtcUsd::setServerUrl(const String& url)
+{
+  if(url.startsWith("https://"))
+    streamUrl = String("wss://") + url.substr(8);
+  else if(url.startsWith("http://"))
+    streamUrl = String("ws://") + url.substr(7);
+  else
+    return false;
+  apiUrl = url + "/api";
+  return true;
+}
+
 bool_t BitstampBtcUsd::connect()
 {
   close();
 
-  if(!websocket.connect("ws://ws.pusherapp.com/app/de504dc5763aeef9ff52?protocol=6&client=js&version=2.1.2"))
+  if(!websocket.connect(streamUrl + "/app/de504dc5763aeef9ff52?protocol=6&client=js&version=2.1.2"))
   {
     error = websocket.getErrorString();
     websocket.close();
@@ -27,79 +39,51 @@ bool_t BitstampBtcUsd::connect()
     return false;
   }
   lastPingTime = Time::time();
-
-  HttpRequest httpRequest;
-  Buffer data;
-  for(int i = 0;; ++i)
-  {
-    if(!httpRequest.get("https://www.bitstamp.net/api/ticker/", data))
-    {
-      error = httpRequest.getErrorString();
-      websocket.close();
-      return false;
-    }
-    int64_t localTime = Time::time();
-    //Log::infof("%s", (const byte_t*)data);
-    Variant dataVar;
-    if(!Json::parse(data, dataVar))
-    {
-      error = "Could not parse ticker data.";
-      websocket.close();
-      return false;
-    }
-    const HashMap<String, Variant>& dataMap = dataVar.toMap();
-    int64_t serverTime = dataMap.find("timestamp")->toInt64() * 1000LL;  // + up to 8 seconds
-    if(i == 0 || serverTime - localTime > localToServerTime)
-      localToServerTime = serverTime - localTime;
-    if(i == 12)
-      break;
-    Thread::sleep(2137);
-  }
-
+  state = timeSyncState;
+  timeSyncCount = 0;
+  nextRequestTime = 0;
   return true;
 }
 
+void_t BitstampBtcUsd::close()
+{
+  websocket.close();
+  httpRequest.cancel();
+  requestStarted = false;
+}
+
 bool_t BitstampBtcUsd::process(Callback& callback)
 {
-  HttpRequest httpRequest;
+  Buffer buffer;
+
+  // synchronize with the server time
+  while(timeSyncCount < 13)
   {
-    Buffer data;
-    if(!httpRequest.get("https://www.bitstamp.net/api/transactions/", data))
+    if(timeSyncCount > 0)
+      Thread::sleep(2137);
+    if(!httpRequest.get(apiUrl + "/ticker/", buffer))
     {
       error = httpRequest.getErrorString();
       websocket.close();
       return false;
     }
-
-    //Log::infof("%s", (const byte_t*)data);
-    Variant dataVar;
-    if(!Json::parse(data, dataVar))
-    {
-      error = "Could not parse trade data.";
-      websocket.close();
+    if(!handleServerTime(buffer, Time::time()))
       return false;
-    }
+  }
 
-    const List<Variant>& dataList = dataVar.toList();
-    Market::Trade trade;
-    if(!dataList.isEmpty())
-      for(List<Variant>::Iterator i = --List<Variant>::Iterator(dataList.end()), begin = dataList.begin();; --i)
-      {
-        const HashMap<String, Variant>& tradeMap = i->toMap();
-        trade.amount =  tradeMap.find("amount")->toDouble();
-        trade.price = tradeMap.find("price")->toDouble();
-        trade.time = tradeMap.find("date")->toUInt64() * 1000ULL;
-        trade.flags = 0;
-        trade.id = tradeMap.find("tid")->toUInt64();
-        if(!callback.receivedTrade(trade))
-            return false;
-        if(i == begin)
-          break;
-      }
+  // load recent trades
+  if(!httpRequest.get(apiUrl + "/transactions/", buffer))
+  {
+    error = httpRequest.getErrorString();
+    websocket.close();
+    return false;
   }
+  if(!handleTrades(buffer, callback))
+    return false;
+  state = streamState;
 
-  Buffer buffer;
-  String bufferStr;
+  byte_t* data;
+  size_t size;
   for(;;)
   {
     // send ping?
@@ -115,36 +99,25 @@ bool_t BitstampBtcUsd::process(Callback& callback)
     }
 
     // wait for data
-    if(!websocket.recv(buffer, 1000))
+    if(!websocket.recv(data, size, 1000))
     {
       error = websocket.getErrorString();
       websocket.close();
       return false;
     }
-    if(buffer.isEmpty())
+    if(!data)
       continue; // timeout
     lastPingTime = Time::time();
-    if(!handleStreamData(buffer, callback))
+    if(!handleStreamData(data, size, callback))
       return false;
 
     // request ticker data?
     int64_t now = Time::time();
     if(now - lastTickerTimer >= 30 * 1000)
     {
-      if(httpRequest.get("https://www.bitstamp.net/api/ticker/", buffer))
-      {
-        Variant dataVar;
-        if(Json::parse(buffer, dataVar))
-        {
-          const HashMap<String, Variant>& dataMap = dataVar.toMap();
-          Ticker ticker;
-          ticker.time = dataMap.find("timestamp")->toInt64() * 1000LL;
-          ticker.ask = dataMap.find("ask")->toDouble();
-          ticker.bid = dataMap.find("bid")->toDouble();
-          if(!callback.receivedTicker(ticker))
-              return false;
-        }
-      }
+      if(httpRequest.get(apiUrl + "/ticker/", buffer))
+        if(!handleTicker(buffer, callback))
+          return false;
       lastTickerTimer = now;
     }
   }
@@ -152,41 +125,263 @@ bool_t BitstampBtcUsd::process(Callback& callback)
   return false; // unreachable
 }
 
-bool_t BitstampBtcUsd::handleStreamData(const Buffer& data, Callback& callback)
+bool_t BitstampBtcUsd::step(Callback& callback, HttpRequest::Multi& multi, int64_t& timeout)
+{
+  int64_t now = Time::time();
+
+  // handle completed http request
+  if(requestStarted && !httpRequest.isPending())
+  {
+    requestStarted = false;
+    if(!httpRequest.getResult() && state != streamState)
+    {
+      error = httpRequest.getErrorString();
+      websocket.close();
+      return false;
+    }
+    switch(state)
+    {
+    case timeSyncState:
+      if(!handleServerTime(httpBuffer, now))
+        return false;
+      if(timeSyncCount == 13)
+        state = historyState;
+      nextRequestTime = now + 2137;
+      break;
+    case historyState:
+      if(!handleTrades(httpBuffer, callback))
+        return false;
+      state = streamState;
+      break;
+    case streamState:
+      if(httpRequest.getResult())
+        if(!handleTicker(httpBuffer, callback))
+          return false;
+      break;
+    }
+  }
+
+  // start next http request
+  if(!requestStarted)
+  {
+    String url;
+    switch(state)
+    {
+    case timeSyncState:
+      if(now >= nextRequestTime)
+        url = apiUrl + "/ticker/";
+      break;
+    case historyState:
+      url = apiUrl + "/transactions/";
+      break;
+    case streamState:
+      if(now - lastTickerTimer >= 30 * 1000)
+      {
+        url = apiUrl + "/ticker/";
+        lastTickerTimer = now;
+      }
+      break;
+    }
+    if(!url.isEmpty())
+    {
+      if(!httpRequest.startGet(multi, url, httpBuffer))
+      {
+        error = httpRequest.getErrorString();
+        websocket.close();
+        return false;
+      }
+      requestStarted = true;
+    }
+  }
+
+  if(state != streamState)
+  {
+    timeout = requestStarted ? 60 * 1000 : nextRequestTime - now;
+    return true;
+  }
+
+  // send ping?
+  if(now - lastPingTime > 120 * 1000)
+  {
+    if(!websocket.sendPing())
+    {
+      error = websocket.getErrorString();
+      websocket.close();
+      return false;
+    }
+    lastPingTime = now;
+  }
+
+  // handle received messages
+  byte_t* data;
+  size_t size;
+  for(;;)
+  {
+    if(!websocket.recv(data, size, 0))
+    {
+      error = websocket.getErrorString();
+      websocket.close();
+      return false;
+    }
+    if(!data)
+      break;
+    lastPingTime = now;
+    if(!handleStreamData(data, size, callback))
+      return false;
+  }
+
+  timeout = lastPingTime + 120 * 1000 - now;
+  if(!requestStarted && lastTickerTimer + 30 * 1000 - now < timeout)
+    timeout = lastTickerTimer + 30 * 1000 - now;
+  if(timeout < 0)
+    timeout = 0;
+  return true;
+}
+
+bool_t BitstampBtcUsd::handleServerTime(const Buffer& data, int64_t localTime)
 {
-  int64_t localTime = Time::time();
   //Log::infof("%s", (const byte_t*)data);
+  Json::Parser parser(data);
+  String key;
+  int64_t serverTime = 0;
+  if(parser.beginObject())
+    while(parser.nextMember(key))
+    {
+      if(key == "timestamp")
+        parser.readInt64(serverTime);
+      else
+        parser.skipValue();
+    }
+  if(parser.hasError())
+  {
+    error = "Could not parse ticker data.";
+    websocket.close();
+    return false;
+  }
+  serverTime *= 1000LL; // + up to 8 seconds
+  if(timeSyncCount == 0 || serverTime - localTime > localToServerTime)
+    localToServerTime = serverTime - localTime;
+  ++timeSyncCount;
+  return true;
+}
 
-  Variant dataVar;
-  if(Json::parse(data, dataVar))
+bool_t BitstampBtcUsd::handleTrades(const Buffer& data, Callback& callback)
+{
+  //Log::infof("%s", (const byte_t*)data);
+  Json::Parser parser(data);
+  Array<Trade> trades;
+  String key;
+  if(parser.beginArray())
+    while(parser.nextElement())
+    {
+      if(!parser.beginObject())
+        break;
+      Trade& trade = trades.append(Trade());
+      while(parser.nextMember(key))
+        if(key == "amount")
+          parser.readDouble(trade.amount);
+        else if(key == "price")
+          parser.readDouble(trade.price);
+        else if(key == "date")
+          parser.readUInt64(trade.time);
+        else if(key == "tid")
+          parser.readUInt64(trade.id);
+        else
+          parser.skipValue();
+      trade.time *= 1000ULL;
+    }
+  if(parser.hasError())
   {
-    const HashMap<String, Variant>& dataMap = dataVar.toMap();
-    String event = dataMap.find("event")->toString();
-    String channel = dataMap.find("channel")->toString();
+    error = "Could not parse trade data.";
+    websocket.close();
+    return false;
+  }
+
+  for(size_t i = trades.size(); i-- > 0;)
+    if(!callback.receivedTrade(trades[i]))
+      return false;
+  return callback.flushTrades();
+}
+
+bool_t BitstampBtcUsd::handleTicker(const Buffer& data, Callback& callback)
+{
+  Json::Parser parser(data);
+  String key;
+  Ticker ticker;
+  ticker.time = 0;
+  ticker.ask = ticker.bid = 0.;
+  if(parser.beginObject())
+    while(parser.nextMember(key))
+    {
+      if(key == "timestamp")
+        parser.readUInt64(ticker.time);
+      else if(key == "ask")
+        parser.readDouble(ticker.ask);
+      else if(key == "bid")
+        parser.readDouble(ticker.bid);
+      else
+        parser.skipValue();
+    }
+  if(parser.hasError())
+    return true;
+  ticker.time *= 1000ULL;
+  return callback.receivedTicker(ticker);
+}
+
+bool_t BitstampBtcUsd::handleStreamData(byte_t* data, size_t size, Callback& callback)
+{
+  int64_t localTime = Time::time();
+  //Log::infof("%.*s", (int_t)size, (const char_t*)data);
+
+  Json::Parser parser((const tchar_t*)data, size);
+  tchar_t* tradeData = 0;
+  size_t tradeDataLength = 0;
+  event.clear();
+  channel.clear();
+  if(parser.beginObject())
+    while(parser.nextMember(key))
+    {
+      if(key == "event")
+        parser.readString(event);
+      else if(key == "channel")
+        parser.readString(channel);
+      else if(key == "data")
+        parser.readStringInPlace(tradeData, tradeDataLength);
+      else
+        parser.skipValue();
+    }
+  if(parser.hasError())
+    return true;
 
-    if(channel.isEmpty() && event == "pusher:connection_established")
+  if(channel.isEmpty() && event == "pusher:connection_established")
+    return true;
+  else if(channel == "live_trades")
+  {
+    if(event == "pusher_internal:subscription_succeeded")
       return true;
-    else if(channel == "live_trades")
+    else if(event == "trade")
     {
-      if(event == "pusher_internal:subscription_succeeded")
-        return true;
-      else if(event == "trade")
-      {
-        Variant tradeVar;
-        if(Json::parse(dataMap.find("data")->toString(), tradeVar))
+      Json::Parser tradeParser(tradeData, tradeDataLength);
+      Trade trade;
+      trade.id = 0;
+      trade.time = toServerTime(localTime);
+      trade.price = trade.amount = 0.;
+      trade.flags = 0;
+      if(tradeParser.beginObject())
+        while(tradeParser.nextMember(key))
         {
-          const HashMap<String, Variant>& tradeMap = tradeVar.toMap();
-
-          Trade trade;
-          trade.id = tradeMap.find("id")->toUInt64();
-          trade.time = toServerTime(localTime);
-          trade.price = tradeMap.find("price")->toDouble();
-          trade.amount = tradeMap.find("amount")->toDouble();
-          trade.flags = 0;
-          if(!callback.receivedTrade(trade))
-            return false;
+          if(key == "id")
+            tradeParser.readUInt64(trade.id);
+          else if(key == "price")
+            tradeParser.readDouble(trade.price);
+          else if(key == "amount")
+            tradeParser.readDouble(trade.amount);
+          else
+            tradeParser.skipValue();
         }
-      }
+      if(!tradeParser.hasError())
+        if(!callback.receivedTrade(trade) || !callback.flushTrades())
+          return false;
     }
   }
 
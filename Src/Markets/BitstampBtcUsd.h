@@ -7,22 +7,47 @@
 class BitstampBtcUsd : public Market
 {
 public:
-  BitstampBtcUsd() : lastPingTime(0), lastTickerTimer(0) {}
+  BitstampBtcUsd() : apiUrl("https://www.bitstamp.net/api"), streamUrl("ws://ws.pusherapp.com"), lastPingTime(0), lastTickerTimer(0), state(timeSyncState), timeSyncCount(0), nextRequestTime(0), requestStarted(false) {}
 
   virtual String getChannelName() const {return String("Bitstamp/BTC/USD");}
   virtual bool_t connect();
-  virtual void_t close() {websocket.close();}
+  virtual void_t close();
   virtual bool_t isOpen() const {return websocket.isOpen();}
   virtual const String& getErrorString() const {return error;}
   virtual bool_t process(Callback& callback);
+  virtual bool_t step(Callback& callback, HttpRequest::Multi& multi, int64_t& timeout);
+  virtual int_t getSocket() const {return state == streamState ? websocket.getSocket() : -1;}
+  virtual bool_t setServerUrl(const String& url);
 
 private:
+  enum State
+  {
+    timeSyncState,
+    historyState,
+    streamState
+  };
+
+private:
+  String apiUrl;
+  String streamUrl;
   Websocket websocket;
   String error;
   int64_t localToServerTime;
   int64_t lastPingTime;
   int64_t lastTickerTimer;
+  String key;
+  String event;
+  String channel;
+  State state;
+  int_t timeSyncCount;
+  int64_t nextRequestTime;
+  HttpRequest httpRequest;
+  Buffer httpBuffer;
+  bool_t requestStarted;
 
   int64_t toServerTime(int64_t localTime) const {return localTime + localToServerTime;}
-  bool_t handleStreamData(const Buffer& data, Callback& callback);
+  bool_t handleServerTime(const Buffer& data, int64_t localTime);
+  bool_t handleTrades(const Buffer& data, Callback& callback);
+  bool_t handleTicker(const Buffer& data, Callback& callback);
+  bool_t handleStreamData(byte_t* data, size_t size, Callback& callback);
 };
@@ -2,7 +2,6 @@
 #include <nstd/Thread.h>
 #include <nstd/Time.h>
 #include <nstd/Console.h>
-#include <nstd/Variant.h>
 
 #include "Tools/Json.h"
 #include "Tools/HttpRequest.h"
@@ -19,38 +18,70 @@ bool_t BtcChinaBtcCny::process(Callback& callback)
 {
   HttpRequest httpRequest;
   Buffer data;
-  String dataStr;
   for(;; Thread::sleep(14000))
   {
-    String url("https://data.btcchina.com/data/historydata");
-    if(lastTradeId != 0)
-      url.printf("https://data.btcchina.com/data/historydata?since=%llu", lastTradeId);
-    if(!httpRequest.get(url, data))
+    if(!httpRequest.get(getUrl(), data))
     {
       error = httpRequest.getErrorString();
       open = false;
       return false;
     }
-
-    dataStr.attach((const char_t*)(byte_t*)data, data.size());
-    Variant dataVar;
-    if(!Json::parse(dataStr, dataVar))
-    {
-      error = "Could not parse trade data.";
-      open = false;
+    if(!handleResponse(data, callback))
       return false;
-    }
+  }
+
+  return false; // unreachable
+}
+
+bool_t BtcChinaBtcCny::step(Callback& callback, HttpRequest::Multi& multi, int64_t& timeout)
+{
+  bool_t completed;
+  if(!pollingRequest.step(multi, getUrl(), timeout, completed))
+  {
+    error = pollingRequest.getErrorString();
+    open = false;
+    return false;
+  }
+  if(completed)
+    return handleResponse(pollingRequest.getData(), callback);
+  return true;
+}
+
+String BtcChinaBtcCny::getUrl() const
+{
+  String url("https://data.btcchina.com/data/historydata");
+  if(lastTradeId != 0)
+    url.printf("https://data.btcchina.com/data/historydata?since=%llu", lastTradeId);
+  return url;
+}
 
-    const List<Variant>& tradesList = dataVar.toList();
-    Trade trade;
-    for(List<Variant>::Iterator i = tradesList.begin(), end = tradesList.end(); i != end; ++i)
+bool_t BtcChinaBtcCny::handleResponse(const Buffer& data, Callback& callback)
+{
+  Trade trade;
+  String key;
+  Json::Parser parser(data);
+  if(parser.beginArray())
+    while(parser.nextElement())
     {
-      const HashMap<String, Variant>& tradeData = i->toMap();
-      trade.id = tradeData.find("tid")->toInt64();
-      trade.time = tradeData.find("date")->toInt64() * 1000LL;
-      trade.price = tradeData.find("price")->toDouble();
-      trade.amount = tradeData.find("amount")->toDouble();
+      if(!parser.beginObject())
+        break;
+      trade.id = trade.time = 0;
+      trade.price = trade.amount = 0.;
       trade.flags = 0;
+      while(parser.nextMember(key))
+        if(key == "tid")
+          parser.readUInt64(trade.id);
+        else if(key == "date")
+          parser.readUInt64(trade.time);
+        else if(key == "price")
+          parser.readDouble(trade.price);
+        else if(key == "amount")
+          parser.readDouble(trade.amount);
+        else
+          parser.skipValue();
+      if(parser.hasError())
+        break;
+      trade.time *= 1000LL;
       if(trade.id > lastTradeId)
       {
         if(!callback.receivedTrade(trade))
@@ -58,7 +89,12 @@ bool_t BtcChinaBtcCny::process(Callback& callback)
         lastTradeId = trade.id;
       }
     }
+  if(parser.hasError())
+  {
+    error = "Could not parse trade data.";
+    open = false;
+    return false;
   }
 
-  return false; // unreachable
+  return callback.flushTrades();
 }
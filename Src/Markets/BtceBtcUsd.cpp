@@ -2,7 +2,7 @@
 #include <nstd/Thread.h>
 #include <nstd/Time.h>
 #include <nstd/Console.h>
-#include <nstd/Variant.h>
+#include <nstd/Array.h>
 
 #include "Tools/Json.h"
 #include "Tools/HttpRequest.h"
@@ -19,50 +19,81 @@ bool_t BtceBtcUsd::process(Callback& callback)
 {
   HttpRequest httpRequest;
   Buffer data;
-  String dataStr;
   for(;; Thread::sleep(14000))
   {
-    String url("https://btc-e.com/api/2/btc_usd/trades");
-    if(!httpRequest.get(url, data))
+    if(!httpRequest.get(getUrl(), data))
     {
       error = httpRequest.getErrorString();
       open = false;
       return false;
     }
+    if(!handleResponse(data, callback))
+      return false;
+  }
+
+  return false; // unreachable
+}
+
+bool_t BtceBtcUsd::step(Callback& callback, HttpRequest::Multi& multi, int64_t& timeout)
+{
+  bool_t completed;
+  if(!pollingRequest.step(multi, getUrl(), timeout, completed))
+  {
+    error = pollingRequest.getErrorString();
+    open = false;
+    return false;
+  }
+  if(completed)
+    return handleResponse(pollingRequest.getData(), callback);
+  return true;
+}
 
-    dataStr.attach((const char_t*)(byte_t*)data, data.size());
-    Variant dataVar;
-    if(!Json::parse(dataStr, dataVar))
+String BtceBtcUsd::getUrl() const
+{
+  return String("https://btc-e.com/api/2/btc_usd/trades");
+}
+
+bool_t BtceBtcUsd::handleResponse(const Buffer& data, Callback& callback)
+{
+  Array<Trade> trades;
+  String key;
+  Json::Parser parser(data);
+  if(parser.beginArray())
+    while(parser.nextElement())
     {
-      error = "Could not parse trade data.";
-      open = false;
-      return false;
+      if(!parser.beginObject())
+        break;
+      Trade& trade = trades.append(Trade());
+      while(parser.nextMember(key))
+        if(key == "tid")
+          parser.readUInt64(trade.id);
+        else if(key == "date")
+          parser.readUInt64(trade.time);
+        else if(key == "price")
+          parser.readDouble(trade.price);
+        else if(key == "amount")
+          parser.readDouble(trade.amount);
+        else
+          parser.skipValue();
+      trade.time *= 1000LL;
     }
+  if(parser.hasError())
+  {
+    error = "Could not parse trade data.";
+    open = false;
+    return false;
+  }
 
-    const List<Variant>& tradesList = dataVar.toList();
-    Trade trade;
-    if(!tradesList.isEmpty())
+  for(size_t i = trades.size(); i-- > 0;)
+  {
+    const Trade& trade = trades[i];
+    if(trade.id > lastTradeId)
     {
-      for(List<Variant>::Iterator i = --List<Variant>::Iterator(tradesList.end()), begin = tradesList.begin();; --i)
-      {
-        const HashMap<String, Variant>& tradeData = i->toMap();
-        trade.id = tradeData.find("tid")->toInt64();
-        int64_t timestamp = tradeData.find("date")->toInt64();
-        trade.time = timestamp * 1000LL;
-        trade.price = tradeData.find("price")->toDouble();
-        trade.amount = tradeData.find("amount")->toDouble();
-        trade.flags = 0;
-        if(trade.id > lastTradeId)
-        {
-          if(!callback.receivedTrade(trade))
-            return false;
-          lastTradeId = trade.id;
-        }
-        if(i == begin)
-          break;
-      }
+      if(!callback.receivedTrade(trade))
+        return false;
+      lastTradeId = trade.id;
     }
   }
 
-  return false; // unreachable
+  return callback.flushTrades();
 }
@@ -2,7 +2,6 @@
 #include <nstd/Thread.h>
 #include <nstd/Time.h>
 #include <nstd/Console.h>
-#include <nstd/Variant.h>
 #include <nstd/Math.h>
 
 #include "Tools/Json.h"
@@ -20,111 +19,157 @@ bool_t HuobiBtcCny::process(Callback& callback)
 {
   HttpRequest httpRequest;
   Buffer data;
-  String dataStr;
   for(;; Thread::sleep(2000))
   {
-    
-    if(!httpRequest.get("http://market.huobi.com/staticmarket/detail_btc_json.js", data))
+    if(!httpRequest.get(getUrl(), data))
     {
       error = httpRequest.getErrorString();
       open = false;
       return false;
     }
-
-    dataStr.attach((const char_t*)(byte_t*)data, data.size());
-    //if(dataStr.length() < 13 || !dataStr.startsWith("view_detail("))
-    //{
-    //  error = "Could not parse trade data.";
-    //  open = false;
-    //  return false;
-    //}
-    //dataStr = dataStr.substr(12, dataStr.length() - 12 - 1);
-
-    Variant dataVar;
-    if(!Json::parse(dataStr, dataVar))
-    {
-      error = "Could not parse trade data.";
-      open = false;
+    if(!handleResponse(data, callback))
       return false;
-    }
+  }
+
+  return false; // unreachable
+}
+
+bool_t HuobiBtcCny::step(Callback& callback, HttpRequest::Multi& multi, int64_t& timeout)
+{
+  bool_t completed;
+  if(!pollingRequest.step(multi, getUrl(), timeout, completed))
+  {
+    error = pollingRequest.getErrorString();
+    open = false;
+    return false;
+  }
+  if(completed)
+    return handleResponse(pollingRequest.getData(), callback);
+  return true;
+}
 
-    const List<Variant>& tradesList = dataVar.toMap().find("trades")->toList();
-    int64_t approxServerTimestamp = Time::time() + 8LL * 60LL * 60LL * 1000LL;
-    Time approxServerTime(approxServerTimestamp, true); // Hong Kong time
+String HuobiBtcCny::getUrl() const
+{
+  return String("http://market.huobi.com/staticmarket/detail_btc_json.js");
+}
 
-    Trade trade;
-    List<Variant>::Iterator i = tradesList.begin();
-    for(List<Variant>::Iterator end = tradesList.end(); i != end; ++i)
+bool_t HuobiBtcCny::handleResponse(const Buffer& data, Callback& callback)
+{
+  Array<TradeData> trades;
+  String key, amount, price, type;
+  Json::Parser parser(data);
+  if(parser.beginObject())
+    while(parser.nextMember(key))
     {
-      const HashMap<String, Variant>& tradeData = i->toMap();
-      String tradeStr = tradeData.find("time")->toString() + " " + tradeData.find("amount")->toString() + " " + tradeData.find("price")->toString() + " " + tradeData.find("type")->toString();
-      if(!lastTradeList.isEmpty() && tradeStr == lastTradeList.back())
+      if(key != "trades")
       {
-        List<Variant>::Iterator j = i;
-        ++j;
-        if(lastTradeList.size() > 1)
-          for(List<String>::Iterator x = --List<String>::Iterator(--List<String>::Iterator(lastTradeList.end())), begin = lastTradeList.begin(); j != end; ++j, --x)
-          {
-            const HashMap<String, Variant>& tradeData = j->toMap();
-            String tradeStr = tradeData.find("time")->toString() + " " + tradeData.find("amount")->toString() + " " + tradeData.find("price")->toString() + " " + tradeData.find("type")->toString();
-            if(*x != tradeStr)
-              goto cont;
-            if(x == begin)
-              break;
-          }
-        goto add;
+        parser.skipValue();
+        continue;
       }
-    cont: ;
-    }
-  add:
-    List<Variant>::Iterator begin = tradesList.begin();
-    if(i != begin)
-      for(--i;; --i)
+      if(!parser.beginArray())
+        break;
+      while(parser.nextElement())
       {
-        const HashMap<String, Variant>& tradeData = i->toMap();
-        String tradeStr = tradeData.find("time")->toString() + " " + tradeData.find("amount")->toString() + " " + tradeData.find("price")->toString()+ " " + tradeData.find("type")->toString();
-        lastTradeList.append(tradeStr);
+        if(!parser.beginObject())
+          break;
+        TradeData& tradeData = trades.append(TradeData());
+        amount.clear();
+        price.clear();
+        type.clear();
+        while(parser.nextMember(key))
+          if(key == "time")
+            parser.readString(tradeData.time);
+          else if(key == "amount")
+            parser.readString(amount);
+          else if(key == "price")
+            parser.readString(price);
+          else if(key == "type")
+            parser.readString(type);
+          else
+            parser.skipValue();
+        tradeData.str = tradeData.time + " " + amount + " " + price + " " + type;
+        tradeData.amount = amount.toDouble();
+        tradeData.price = price.toDouble();
+      }
+    }
+  if(parser.hasError())
+  {
+    error = "Could not parse trade data.";
+    open = false;
+    return false;
+  }
 
-        int_t hour, min, sec;
-        if(tradeData.find("time")->toString().scanf("%d:%d:%d", &hour, &min, &sec) != 3)
-        {
-          error = "Could not determine trade timestamp.";
-          open = false;
-          return false;
-        }
-        Time tradeTime(approxServerTime);
-        tradeTime.hour = hour;
-        tradeTime.min = min;
-        tradeTime.sec = sec;
-        int64_t tradeTimestamp = tradeTime.toTimestamp();
-
-        if(Math::abs(tradeTimestamp  - approxServerTimestamp) > 12 * 60 * 60 * 1000LL)
-          tradeTimestamp += tradeTimestamp > approxServerTimestamp ? -24 * 60 * 60 * 1000LL : 24 * 60 * 60 * 1000LL;
-        if(Math::abs(tradeTimestamp  - approxServerTimestamp) > 3 * 60 * 60 * 1000LL)
+  int64_t approxServerTimestamp = Time::time() + 8LL * 60LL * 60LL * 1000LL;
+  Time approxServerTime(approxServerTimestamp, true); // Hong Kong time
+
+  // find the most recent trade we already know about
+  size_t i = 0, count = trades.size();
+  for(; i < count; ++i)
+  {
+    if(lastTradeList.isEmpty() || trades[i].str != lastTradeList.back())
+      continue;
+    if(lastTradeList.size() > 1)
+    {
+      size_t j = i + 1;
+      for(List<String>::Iterator x = --List<String>::Iterator(--List<String>::Iterator(lastTradeList.end())), begin = lastTradeList.begin(); j < count; ++j, --x)
+      {
+        if(*x != trades[j].str)
+          break;
+        if(x == begin)
         {
-          error = "Could not determine trade timestamp.";
-          open = false;
-          return false;
+          j = count;
+          break;
         }
+      }
+      if(j < count)
+        continue;
+    }
+    break;
+  }
 
-        trade.time = tradeTimestamp - 8 * 60 * 60 * 1000LL;
-        trade.id = trade.time;
-        if(trade.id == lastTradeId)
-          ++trade.id;
-        trade.amount = tradeData.find("amount")->toDouble();
-        trade.price = tradeData.find("price")->toDouble();
-        trade.flags = 0;
+  // add trades that are newer
+  Trade trade;
+  for(; i-- > 0;)
+  {
+    const TradeData& tradeData = trades[i];
+    lastTradeList.append(tradeData.str);
 
-        if(!callback.receivedTrade(trade))
-          return false;
-        lastTradeId = trade.id;
+    int_t hour, min, sec;
+    if(tradeData.time.scanf("%d:%d:%d", &hour, &min, &sec) != 3)
+    {
+      error = "Could not determine trade timestamp.";
+      open = false;
+      return false;
+    }
+    Time tradeTime(approxServerTime);
+    tradeTime.hour = hour;
+    tradeTime.min = min;
+    tradeTime.sec = sec;
+    int64_t tradeTimestamp = tradeTime.toTimestamp();
 
-        if(i == begin)
-          break;
-      }
-      while(lastTradeList.size() > 100)
-        lastTradeList.removeFront();
+    if(Math::abs(tradeTimestamp  - approxServerTimestamp) > 12 * 60 * 60 * 1000LL)
+      tradeTimestamp += tradeTimestamp > approxServerTimestamp ? -24 * 60 * 60 * 1000LL : 24 * 60 * 60 * 1000LL;
+    if(Math::abs(tradeTimestamp  - approxServerTimestamp) > 3 * 60 * 60 * 1000LL)
+    {
+      error = "Could not determine trade timestamp.";
+      open = false;
+      return false;
     }
 
-  return false; // unreachable
+    trade.time = tradeTimestamp - 8 * 60 * 60 * 1000LL;
+    trade.id = trade.time;
+    if(trade.id == lastTradeId)
+      ++trade.id;
+    trade.amount = tradeData.amount;
+    trade.price = tradeData.price;
+    trade.flags = 0;
+
+    if(!callback.receivedTrade(trade))
+      return false;
+    lastTradeId = trade.id;
+  }
+  while(lastTradeList.size() > 100)
+    lastTradeList.removeFront();
+
+  return callback.flushTrades();
 }
@@ -2,13 +2,15 @@
 #pragma once
 
 #include <nstd/List.h>
+#include <nstd/Array.h>
 
 #include "Tools/Market.h"
+#include "Tools/PollingRequest.h"
 
 class HuobiBtcCny : public Market
 {
 public:
-  HuobiBtcCny() : open(false), lastTradeId(0) {}
+  HuobiBtcCny() : open(false), pollingRequest(2000), lastTradeId(0) {}
 
   virtual String getChannelName() const {return String("Huobi/BTC/CNY");}
   virtual bool_t connect();
@@ -16,11 +18,26 @@ public:
   virtual bool_t isOpen() const {return open;}
   virtual const String& getErrorString() const {return error;}
   virtual bool_t process(Callback& callback);
+  virtual bool_t step(Callback& callback, HttpRequest::Multi& multi, int64_t& timeout);
+
+private:
+  class TradeData
+  {
+  public:
+    String time;
+    String str;
+    double price;
+    double amount;
+  };
 
 private:
   String error;
   bool_t open;
+  PollingRequest pollingRequest;
 
   List<String> lastTradeList;
   uint64_t lastTradeId;
+
+  String getUrl() const;
+  bool_t handleResponse(const Buffer& data, Callback& callback);
 };
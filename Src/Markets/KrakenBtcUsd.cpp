@@ -2,7 +2,7 @@
 #include <nstd/Thread.h>
 #include <nstd/Time.h>
 #include <nstd/Console.h>
-#include <nstd/Variant.h>
+#include <nstd/Array.h>
 
 #include "Tools/Json.h"
 #include "Tools/HttpRequest.h"
@@ -19,64 +19,138 @@ bool_t KrakenBtcUsd::process(Callback& callback)
 {
   HttpRequest httpRequest;
   Buffer data;
-  String dataStr;
-
-  // receive trades
   for(;; Thread::sleep(14000))
   {
-    String url("https://api.kraken.com/0/public/Trades?pair=XBTUSD");
-    if(lastId != 0)
-      url.printf("https://api.kraken.com/0/public/Trades?pair=XBTUSD&since=%llu", lastId);
-    if(!httpRequest.get(url, data))
+    if(!httpRequest.get(getUrl(), data))
     {
       error = httpRequest.getErrorString();
       open = false;
       return false;
     }
-
-    dataStr.attach((const char_t*)(byte_t*)data, data.size());
-    Variant dataVar;
-    if(!Json::parse(dataStr, dataVar))
-    {
-      error = "Could not parse trade data.";
-      open = false;
+    if(!handleResponse(data, callback))
       return false;
-    }
-    const HashMap<String, Variant>& dataMap = dataVar.toMap();
-    String error = dataMap.find("error")->toString();
-    if(!error.isEmpty())
-    {
-      this->error = error;;
-      open = false;
-      return false;
-    }
+  }
 
-    const HashMap<String, Variant>& result = dataMap.find("result")->toMap();
-    const List<Variant>& tradesList = result.find("XXBTZUSD")->toList();
-    Trade trade;
-    for(List<Variant>::Iterator i = tradesList.begin(), end = tradesList.end(); i != end; ++i)
-    {
-      const List<Variant>& tradeData = i->toList();
-      if(tradeData.size() < 3)
-        continue;
-      List<Variant>::Iterator it = tradeData.begin();
-      trade.price = it->toDouble();
-      ++it;
-      trade.amount = it->toDouble();
-      ++it;
-      trade.id = (uint64_t)(it->toDouble() * 10000.);
-      trade.time = trade.id / 10;
-      trade.flags = 0;
+  return false; // unreachable
+}
 
-      if(trade.id > lastTradeId)
+bool_t KrakenBtcUsd::step(Callback& callback, HttpRequest::Multi& multi, int64_t& timeout)
+{
+  bool_t completed;
+  if(!pollingRequest.step(multi, getUrl(), timeout, completed))
+  {
+    error = pollingRequest.getErrorString();
+    open = false;
+    return false;
+  }
+  if(completed)
+    return handleResponse(pollingRequest.getData(), callback);
+  return true;
+}
+
+String KrakenBtcUsd::getUrl() const
+{
+  String url("https://api.kraken.com/0/public/Trades?pair=XBTUSD");
+  if(lastId != 0)
+    url.printf("https://api.kraken.com/0/public/Trades?pair=XBTUSD&since=%llu", lastId);
+  return url;
+}
+
+bool_t KrakenBtcUsd::handleResponse(const Buffer& data, Callback& callback)
+{
+  Array<Trade> trades;
+  String key, message;
+  Json::Parser parser(data);
+  String error;
+  uint64_t last = lastId;
+  if(parser.beginObject())
+    while(parser.nextMember(key))
+    {
+      if(key == "error")
+      {
+        if(!parser.beginArray())
+          break;
+        while(parser.nextElement())
+        {
+          if(!parser.readString(message))
+            break;
+          if(!error.isEmpty())
+            error.append(", ");
+          error.append(message);
+        }
+      }
+      else if(key == "result")
       {
-        if(!callback.receivedTrade(trade))
-          return false;
-        lastTradeId = trade.id;
+        if(!parser.beginObject())
+          break;
+        while(parser.nextMember(key))
+          if(key == "XXBTZUSD")
+          {
+            if(!parser.beginArray())
+              break;
+            while(parser.nextElement())
+            {
+              if(!parser.beginArray())
+                break;
+              Trade trade;
+              double time = 0.;
+              size_t index = 0;
+              for(; parser.nextElement(); ++index)
+                switch(index)
+                {
+                case 0:
+                  parser.readDouble(trade.price);
+                  break;
+                case 1:
+                  parser.readDouble(trade.amount);
+                  break;
+                case 2:
+                  parser.readDouble(time);
+                  break;
+                default:
+                  parser.skipValue();
+                  break;
+                }
+              if(index < 3)
+                continue;
+              trade.id = (uint64_t)(time * 10000.);
+              trade.time = trade.id / 10;
+              trade.flags = 0;
+              trades.append(trade);
+            }
+          }
+          else if(key == "last")
+            parser.readUInt64(last);
+          else
+            parser.skipValue();
       }
+      else
+        parser.skipValue();
     }
-    lastId = result.find("last")->toUInt64();
+  if(parser.hasError())
+  {
+    this->error = "Could not parse trade data.";
+    open = false;
+    return false;
+  }
+  if(!error.isEmpty())
+  {
+    this->error = error;
+    open = false;
+    return false;
   }
 
-  return false; // unreachable
+  for(Array<Trade>::Iterator i = trades.begin(), end = trades.end(); i != end; ++i)
+  {
+    const Trade& trade = *i;
+    if(trade.id > lastTradeId)
+    {
+      if(!callback.receivedTrade(trade))
+        return false;
+      lastTradeId = trade.id;
+    }
+  }
+  lastId = last;
+
+  return callback.flushTrades();
 }
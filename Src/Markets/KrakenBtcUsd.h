@@ -4,11 +4,12 @@
 #include <nstd/List.h>
 
 #include "Tools/Market.h"
+#include "Tools/PollingRequest.h"
 
 class KrakenBtcUsd : public Market
 {
 public:
-  KrakenBtcUsd() : open(false), lastId(0), lastTradeId(0) {}
+  KrakenBtcUsd() : open(false), pollingRequest(14000), lastId(0), lastTradeId(0) {}
 
   virtual String getChannelName() const {return String("Kraken/BTC/USD");}
   virtual bool_t connect();
@@ -16,11 +17,16 @@ public:
   virtual bool_t isOpen() const {return open;}
   virtual const String& getErrorString() const {return error;}
   virtual bool_t process(Callback& callback);
+  virtual bool_t step(Callback& callback, HttpRequest::Multi& multi, int64_t& timeout);
 
 private:
   String error;
   bool_t open;
+  PollingRequest pollingRequest;
 
   uint64_t lastId;
   uint64_t lastTradeId;
+
+  String getUrl() const;
+  bool_t handleResponse(const Buffer& data, Callback& callback);
 };
@@ -1,17 +1,53 @@
 
 #include <nstd/Log.h>
+#include <nstd/Console.h>
 #include <nstd/Thread.h>
 #include <nstd/Directory.h>
 #include <nstd/Error.h>
 #include <nstd/Process.h>
+#include <nstd/Time.h>
 
 #include "Main.h"
 
 int_t main(int_t argc, char_t* argv[])
 {
+  String serverUrl;
+
+  // parse parameters
+  {
+    Process::Option options[] = {
+        {'s', "server", Process::argumentFlag},
+        {'h', "help", Process::optionFlag},
+    };
+    Process::Arguments arguments(argc, argv, options);
+    int_t character;
+    String argument;
+    while(arguments.read(character, argument))
+      switch(character)
+      {
+      case 's':
+        serverUrl = argument;
+        break;
+      case '?':
+        Console::errorf("Unknown option: %s.\n", (const char_t*)argument);
+        return -1;
+      case ':':
+        Console::errorf("Option %s required an argument.\n", (const char_t*)argument);
+        return -1;
+      default:
+        Console::errorf("Usage: %s [-s <url>]\n\
+  -s, --server=<url>   Connect to the exchange at <url> instead of the public server.\n", argv[0]);
+        return -1;
+      }
+  }
   Log::setFormat("%P> %m");
 
   Main main;
+  if(!serverUrl.isEmpty() && !main.setServerUrl(serverUrl))
+  {
+    Log::errorf("Could not use server url %s.", (const char_t*)serverUrl);
+    return -1;
+  }
   for(;; Thread::sleep(10 * 1000))
   {
     if(!main.connect())
@@ -21,6 +57,16 @@ int_t main(int_t argc, char_t* argv[])
   return 0;
 }
 
+Main::Main() : candleBuilder(zlimdbConnection), tradeSink(zlimdbConnection, &candleBuilder)
+{
+  tradeSink.setStats(stats, String());
+  const ZlimdbConnection::Counters& counters = zlimdbConnection.getCounters();
+  stats.addCounter("zlimdb sent messages", counters.sentMessages);
+  stats.addCounter("zlimdb sent bytes", counters.sentBytes);
+  stats.addCounter("zlimdb received messages", counters.receivedMessages);
+  stats.addCounter("zlimdb received bytes", counters.receivedBytes);
+}
+
 bool_t Main::connect()
 {
   const String& channelName = marketConnection.getChannelName();
@@ -32,8 +78,12 @@ bool_t Main::connect()
       return Log::errorf("Could not connect to zlimdb server: %s", (const char_t*)zlimdbConnection.getErrorString()), false;
     if(!zlimdbConnection.createTable(String("markets/") + channelName + "/trades", tradesTableId))
       return Log::errorf("Could not connect to zlimdb server: %s", (const char_t*)zlimdbConnection.getErrorString()), false;
+    if(!candleBuilder.open(channelName) || !tradeSink.open(tradesTableId))
+      return Log::errorf("Could not connect to zlimdb server: %s", (const char_t*)zlimdbConnection.getErrorString()), false;
     if(!zlimdbConnection.createTable(String("markets/") + channelName + "/ticker", tickerTableId))
       return Log::errorf("Could not connect to zlimdb server: %s", (const char_t*)zlimdbConnection.getErrorString()), false;
+    if(!tradeSink.isRingOpen() && !tradeSink.openRing(channelName))
+      Log::warningf("Could not create trade ring of %s: %s", (const char_t*)channelName, (const char_t*)Error::getErrorString());
 
     Log::infof("Connected to zlimdb server.");
   }
@@ -64,16 +114,14 @@ void_t Main::process()
 
 bool_t Main::receivedTrade(const Market::Trade& trade)
 {
-  meguco_trade_entity tradeEntity;
-  tradeEntity.entity.id = trade.id;
-  tradeEntity.entity.time = trade.time;
-  tradeEntity.entity.size = sizeof(tradeEntity);
-  tradeEntity.amount = trade.amount;
-  tradeEntity.price = trade.price;
-  tradeEntity.flags = trade.flags;
-  uint64_t id;
-  if(!zlimdbConnection.add(tradesTableId, tradeEntity.entity, id, true))
+  return tradeSink.add(trade);
+}
+
+bool_t Main::flushTrades()
+{
+  if(!tradeSink.flush())
     return false;
+  stats.check(Time::time());
   return true;
 }
 
@@ -5,6 +5,9 @@
 
 #include "Tools/ZlimdbConnection.h"
 #include "Tools/Market.h"
+#include "Tools/TradeSink.h"
+#include "Tools/CandleBuilder.h"
+#include "Tools/Stats.h"
 
 #ifdef MARKET_BITSTAMPBTCUSD
 #include "BitstampBtcUsd.h"
@@ -38,6 +41,9 @@ typedef KrakenBtcUsd MarketConnection;
 class Main : public ZlimdbConnection::Callback, public Market::Callback
 {
 public:
+  Main();
+
+  bool_t setServerUrl(const String& url) {return marketConnection.setServerUrl(url);}
   bool_t connect();
   void_t process();
 
@@ -50,9 +56,13 @@ private: // ZlimdbConnection::Callback
 public: // Market::Callback
   virtual bool_t receivedTrade(const Market::Trade& trade);
   virtual bool_t receivedTicker(const Market::Ticker& ticker);
+  virtual bool_t flushTrades();
 
 private:
+  Stats stats;
   ZlimdbConnection zlimdbConnection;
+  CandleBuilder candleBuilder;
+  TradeSink tradeSink;
   MarketConnection marketConnection;
   uint32_t tradesTableId;
   uint32_t tickerTableId;
@@ -0,0 +1,106 @@
+
+#include <nstd/Memory.h>
+
+#include "CandleBuilder.h"
+
+const char_t* CandleBuilder::intervalNames[] = {"1m", "5m", "15m", "1h", "4h", "1d"};
+const uint64_t CandleBuilder::intervals[] = {60 * 1000ULL, 5 * 60 * 1000ULL, 15 * 60 * 1000ULL, 60 * 60 * 1000ULL, 4 * 60 * 60 * 1000ULL, 24 * 60 * 60 * 1000ULL};
+
+bool_t CandleBuilder::open(const String& channelName)
+{
+  byte_t buffer[ZLIMDB_MAX_MESSAGE_SIZE];
+  for(int_t i = 0; i < numOfIntervals; ++i)
+  {
+    Series& series = this->series[i];
+    series.candles.clear();
+    series.changed = false;
+    if(!connection.createTable(String("markets/") + channelName + "/candles/" + intervalNames[i], series.tableId))
+      return false;
+
+    // load the newest candle
+    if(!connection.query(series.tableId, zlimdb_query_type_since_last, 0))
+      return false;
+    while(connection.getResponse(buffer))
+      for(const CandleEntity* candleEntity = (const CandleEntity*)zlimdb_get_first_entity((const zlimdb_header*)buffer, sizeof(CandleEntity));
+          candleEntity;
+          candleEntity = (const CandleEntity*)zlimdb_get_next_entity((const zlimdb_header*)buffer, sizeof(CandleEntity), &candleEntity->entity))
+      {
+        series.candles.clear();
+        Candle& candle = series.candles.append(Candle());
+        candle.entity = *candleEntity;
+        candle.stored = true;
+      }
+    if(connection.getErrno() != 0)
+      return false;
+  }
+  return true;
+}
+
+void_t CandleBuilder::add(const Market::Trade& trade)
+{
+  for(int_t i = 0; i < numOfIntervals; ++i)
+  {
+    Series& series = this->series[i];
+    uint64_t start = trade.time - trade.time % intervals[i];
+    if(series.candles.isEmpty() || series.candles.back().entity.entity.time < start)
+    {
+      Candle& candle = series.candles.append(Candle());
+      Memory::zero(&candle.entity, sizeof(candle.entity));
+      ZlimdbConnection::setEntityHeader(candle.entity.entity, start, start, sizeof(candle.entity));
+      candle.entity.open = candle.entity.high = candle.entity.low = trade.price;
+      candle.stored = false;
+    }
+    CandleEntity& candle = series.candles.back().entity;
+    if(candle.entity.time > start)
+      continue;
+
+    const double x = (double)(trade.time - start) / 1000.;
+    const double& y = trade.price;
+    const double& n = trade.amount;
+    const double nx = n * x;
+    double sumY = candle.vwap * candle.volume + n * y;
+    candle.volume += n;
+    candle.vwap = candle.volume > 0. ? sumY / candle.volume : y;
+    candle.sumX += nx;
+    candle.sumXY += nx * y;
+    candle.sumXX += nx * x;
+    if(y > candle.high)
+      candle.high = y;
+    if(y < candle.low)
+      candle.low = y;
+    candle.close = y;
+    ++candle.trades;
+    series.changed = true;
+  }
+}
+
+bool_t CandleBuilder::flush()
+{
+  for(int_t i = 0; i < numOfIntervals; ++i)
+  {
+    Series& series = this->series[i];
+    if(!series.changed)
+      continue;
+    for(;;)
+    {
+      Candle& candle = series.candles.front();
+      if(candle.stored)
+      {
+        if(!connection.update(series.tableId, candle.entity.entity))
+          return false;
+      }
+      else
+      {
+        uint64_t id;
+        if(!connection.add(series.tableId, candle.entity.entity, id, true))
+          return false;
+        candle.stored = true;
+      }
+      if(series.candles.size() == 1)
+        break;
+      series.candles.removeFront();
+    }
+    series.changed = false;
+  }
+  return true;
+}
@@ -0,0 +1,60 @@
+
+#pragma once
+
+#include <nstd/String.h>
+#include <nstd/List.h>
+
+#include "Tools/ZlimdbConnection.h"
+#include "Tools/Candle.h"
+#include "Tools/Market.h"
+
+/**
+* Aggregates the trades of a market into 1m, 5m, 15m, 1h, 4h and 1d candles with volume weighted price moments.
+* The candles are kept in memory while trades are added and written to the candle tables of the market with flush().
+*/
+class CandleBuilder
+{
+public:
+  CandleBuilder(ZlimdbConnection& connection) : connection(connection) {}
+
+  /**
+  * Creates the candle tables of a market and loads the newest candle of each table so that it is continued.
+  * @param channelName The channel name of the market.
+  */
+  bool_t open(const String& channelName);
+
+  /**
+  * Adds a trade to the open candles. Trades older than the open candle of an interval are ignored for that interval.
+  */
+  void_t add(const Market::Trade& trade);
+
+  /**
+  * Writes the candles that have been changed since the last call.
+  */
+  bool_t flush();
+
+private:
+  class Candle
+  {
+  public:
+    CandleEntity entity;
+    bool_t stored;
+  };
+
+  class Series
+  {
+  public:
+    uint32_t tableId;
+    List<Candle> candles; // the closed candles that are not written yet followed by the open candle
+    bool_t changed;
+  };
+
+private:
+  static const int_t numOfIntervals = 6;
+  static const char_t* intervalNames[numOfIntervals];
+  static const uint64_t intervals[numOfIntervals];
+
+private:
+  ZlimdbConnection& connection;
+  Series series[numOfIntervals];
+};
@@ -3,6 +3,8 @@
 
 #include <nstd/String.h>
 
+#include "Tools/HttpRequest.h"
+
 class Market
 {
 public:
@@ -14,6 +16,12 @@ public:
   public:
     virtual bool_t receivedTrade(const Trade& trade) = 0;
     virtual bool_t receivedTicker(const Ticker& ticker) = 0;
+
+    /**
+    * Called after the trades of a response or stream message have been passed to receivedTrade().
+    * Trades that have been buffered until now should be written.
+    */
+    virtual bool_t flushTrades() {return true;}
   };
 
   class Trade
@@ -42,4 +50,28 @@ public:
   virtual bool_t isOpen() const = 0;
   virtual const String& getErrorString() const = 0;
   virtual bool_t process(Callback& callback) = 0;
+
+  /**
+  * Does whatever can be done without blocking. This is used instead of process() when many markets share an event loop.
+  * It is called again when the socket returned by getSocket() becomes readable, when a request started on the request
+  * group has been completed or when the timeout expired.
+  * @param callback The callback that receives trades and ticker data.
+  * @param multi The request group used to perform http requests.
+  * @param timeout Receives the time in milliseconds until the next call at the latest.
+  * @return \c false when the connection has been lost or the callback failed
+  */
+  virtual bool_t step(Callback& callback, HttpRequest::Multi& multi, int64_t& timeout) = 0;
+
+  /**
+  * Returns the socket that has to be watched for incoming data or -1 if there is none.
+  */
+  virtual int_t getSocket() const {return -1;}
+
+  /**
+  * Replaces the address of the exchange, e.g. to connect to a local mock exchange.
+  * The websocket stream is expected on the same host and port.
+  * @param url The base url of the exchange, e.g. "http://localhost:8080".
+  * @return \c false when the market does not support other servers
+  */
+  virtual bool_t setServerUrl(const String& url) {return false;}
 };
@@ -0,0 +1,40 @@
+
+#include <nstd/Time.h>
+
+#include "PollingRequest.h"
+
+bool_t PollingRequest::step(HttpRequest::Multi& multi, const String& url, int64_t& timeout, bool_t& completed)
+{
+  completed = false;
+  if(httpRequest.isPending())
+  {
+    timeout = 60 * 1000; // the request group reports the completion
+    return true;
+  }
+
+  int64_t now = Time::time();
+  if(started)
+  {
+    started = false;
+    nextRequestTime = now + interval;
+    if(!httpRequest.getResult())
+    {
+      error = httpRequest.getErrorString();
+      return false;
+    }
+    completed = true;
+  }
+  else if(now >= nextRequestTime)
+  {
+    if(!httpRequest.startGet(multi, url, data, checkCertificate))
+    {
+      error = httpRequest.getErrorString();
+      return false;
+    }
+    started = true;
+    timeout = 60 * 1000;
+    return true;
+  }
+  timeout = nextRequestTime - now;
+  return true;
+}
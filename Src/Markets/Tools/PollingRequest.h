@@ -0,0 +1,39 @@
+
+#pragma once
+
+#include <nstd/String.h>
+#include <nstd/Buffer.h>
+
+#include "Tools/HttpRequest.h"
+
+/**
+* Repeats a http get request at a fixed interval on a request group. It implements Market::step() for markets that poll their trade data.
+*/
+class PollingRequest
+{
+public:
+  PollingRequest(int64_t interval, bool checkCertificate = true) : interval(interval), checkCertificate(checkCertificate), started(false), nextRequestTime(0) {}
+
+  const String& getErrorString() const {return error;}
+  const Buffer& getData() const {return data;}
+
+  /**
+  * Starts the request when it is due and checks whether it has been completed.
+  * @param multi The request group.
+  * @param url The url used when a new request is started.
+  * @param timeout Receives the time in milliseconds until the next call at the latest.
+  * @param completed Receives \c true when the response is available with getData().
+  */
+  bool_t step(HttpRequest::Multi& multi, const String& url, int64_t& timeout, bool_t& completed);
+
+  void_t reset() {nextRequestTime = 0;}
+
+private:
+  int64_t interval;
+  bool checkCertificate;
+  HttpRequest httpRequest;
+  Buffer data;
+  String error;
+  bool_t started;
+  int64_t nextRequestTime;
+};
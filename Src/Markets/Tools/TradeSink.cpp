@@ -0,0 +1,91 @@
+
+#include <nstd/Time.h>
+
+#include "TradeSink.h"
+#include "CandleBuilder.h"
+
+void_t TradeSink::setStats(Stats& stats, const String& prefix)
+{
+  receiveLatency = &stats.addHistogram(prefix + "receive");
+  addLatency = &stats.addHistogram(prefix + "zlimdb add");
+}
+
+bool_t TradeSink::open(uint32_t tableId)
+{
+  this->tableId = tableId;
+  lastTradeId = 0;
+  lastTradeTime = 0;
+  trades.clear();
+
+  // load the newest stored trade
+  if(!connection.query(tableId, zlimdb_query_type_since_last, 0))
+    return false;
+  byte_t buffer[ZLIMDB_MAX_MESSAGE_SIZE];
+  while(connection.getResponse(buffer))
+    for(const meguco_trade_entity* tradeEntity = (const meguco_trade_entity*)zlimdb_get_first_entity((const zlimdb_header*)buffer, sizeof(meguco_trade_entity));
+        tradeEntity;
+        tradeEntity = (const meguco_trade_entity*)zlimdb_get_next_entity((const zlimdb_header*)buffer, sizeof(meguco_trade_entity), &tradeEntity->entity))
+    {
+      lastTradeId = tradeEntity->entity.id;
+      lastTradeTime = tradeEntity->entity.time;
+    }
+  if(connection.getErrno() != 0)
+    return false;
+  return true;
+}
+
+bool_t TradeSink::add(const Market::Trade& trade)
+{
+  // trades with an id that is not newer than the last stored one would be rejected by the server,
+  // trades without an id are compared by time
+  if(trade.id != 0 ? trade.id <= lastTradeId : trade.time < lastTradeTime)
+    return true;
+  if(trade.id != 0)
+    lastTradeId = trade.id;
+  if(trade.time > lastTradeTime)
+    lastTradeTime = trade.time;
+  if(receiveLatency)
+    receiveLatency->add((Time::time() - (int64_t)trade.time) * 1000LL);
+  if(candleBuilder)
+    candleBuilder->add(trade);
+
+  meguco_trade_entity& tradeEntity = trades.append(meguco_trade_entity());
+  tradeEntity.entity.id = trade.id;
+  tradeEntity.entity.time = trade.time;
+  tradeEntity.entity.size = sizeof(tradeEntity);
+  tradeEntity.amount = trade.amount;
+  tradeEntity.price = trade.price;
+  tradeEntity.flags = trade.flags;
+  if(trades.size() >= maxBatchSize)
+    return flush();
+  return true;
+}
+
+bool_t TradeSink::flush()
+{
+  // zlimdb add requests carry one entity each and the client waits for the response of each request,
+  // so the batch is written with one round trip per trade
+  int64_t start = addLatency ? Time::microTicks() : 0;
+  while(!trades.isEmpty())
+  {
+    meguco_trade_entity& trade = trades.front();
+    uint64_t id;
+    if(!connection.add(tableId, trade.entity, id, true))
+      return false;
+    if(id != 0 && ring.isOpen()) // a trade that was already in the table has been published before
+    {
+      trade.entity.id = id; // readers match the trades of the ring with the trades of the table by id
+      ring.publish(trade);
+    }
+    trades.removeFront();
+    if(addLatency)
+    {
+      int64_t now = Time::microTicks();
+      addLatency->add(now - start);
+      start = now;
+    }
+  }
+  if(candleBuilder && !candleBuilder->flush())
+    return false;
+  return true;
+}
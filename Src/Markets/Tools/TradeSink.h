@@ -0,0 +1,74 @@
+
+#pragma once
+
+#include <nstd/List.h>
+
+#include <megucoprotocol.h>
+
+#include "Tools/ZlimdbConnection.h"
+#include "Tools/Market.h"
+#include "Tools/Stats.h"
+#include "Tools/TradeRing.h"
+
+class CandleBuilder;
+
+/**
+* Collects the trades received from a market and writes them to its trades table in batches.
+* A batch is written when it is full or when the market has delivered all trades of a response or stream message.
+* zlimdb has no request that adds several entities at once, so a batch is still written with one add request per trade.
+* Trades that are not newer than the newest trade in the table are dropped before they are written.
+* The remaining trades are passed on to an optional candle builder that is flushed along with the trades.
+* Written trades can also be published in the shared memory trade ring of the market for bot processes on the same host.
+*/
+class TradeSink
+{
+public:
+  TradeSink(ZlimdbConnection& connection, CandleBuilder* candleBuilder = 0, size_t maxBatchSize = 1000) : connection(connection), candleBuilder(candleBuilder), maxBatchSize(maxBatchSize), tableId(0), lastTradeId(0), lastTradeTime(0), receiveLatency(0), addLatency(0) {}
+
+  /**
+  * Records the time from a trade on the exchange until it is passed to add() and the duration of the zlimdb add requests.
+  * @param stats The statistics that receive the histograms.
+  * @param prefix A prefix for the names of the histograms, e.g. to tell markets apart.
+  */
+  void_t setStats(Stats& stats, const String& prefix);
+
+  /**
+  * Sets the table the trades are written to, drops all pending trades and loads the id and time of the newest trade in the table.
+  * @return \c false when the table could not be queried
+  */
+  bool_t open(uint32_t tableId);
+
+  /**
+  * Creates or opens the shared memory trade ring of a market. Every trade is published in the ring once it has been written to the trades table.
+  * @param channelName The channel name of the market.
+  * @return \c false when the ring could not be mapped
+  */
+  bool_t openRing(const String& channelName) {return ring.open(channelName, true);}
+  bool_t isRingOpen() const {return ring.isOpen();}
+
+  /**
+  * Adds a trade to the current batch. The batch is written when it reaches its maximum size.
+  * @return \c false when writing the batch failed
+  */
+  bool_t add(const Market::Trade& trade);
+
+  /**
+  * Writes all pending trades and the changed candles.
+  * @return \c false when the connection to the zlimdb server failed
+  */
+  bool_t flush();
+
+  bool_t isEmpty() const {return trades.isEmpty();}
+
+private:
+  ZlimdbConnection& connection;
+  CandleBuilder* candleBuilder;
+  size_t maxBatchSize;
+  uint32_t tableId;
+  uint64_t lastTradeId;
+  uint64_t lastTradeTime;
+  List<meguco_trade_entity> trades;
+  Stats::Histogram* receiveLatency;
+  Stats::Histogram* addLatency;
+  TradeRing ring;
+};
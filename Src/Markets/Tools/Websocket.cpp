@@ -12,6 +12,7 @@
 #include <curl/curl.h>
 
 #include <nstd/Debug.h>
+#include <nstd/Memory.h>
 
 #include "Websocket.h"
 
@@ -36,7 +37,7 @@ public:
   }
 } curl;
 
-Websocket::Websocket(const String& origin, bool useMask) : curl(0), s(0), origin(origin), useMask(useMask) {}
+Websocket::Websocket(const String& origin, bool useMask) : curl(0), s(0), origin(origin), useMask(useMask), recvPos(0), fragmentSize(0), inFragment(false) {}
 
 Websocket::~Websocket()
 {
@@ -185,6 +186,9 @@ void_t Websocket::close()
   }
   s = 0;
   recvBuffer.clear();
+  recvPos = 0;
+  fragmentSize = 0;
+  inFragment = false;
 }
 
 bool_t Websocket::isOpen() const
@@ -193,127 +197,150 @@ bool_t Websocket::isOpen() const
 }
 
 bool_t Websocket::recv(Buffer& buffer, int64_t timeout)
+{
+  byte_t* data;
+  size_t size;
+  if(!recv(data, size, timeout))
+    return false;
+  buffer.clear();
+  if(data)
+    buffer.append(data, size);
+  return true;
+}
+
+bool_t Websocket::recv(byte_t*& data, size_t& size, int64_t timeout)
 {
   if(!curl)
     return false;
 
-  struct wsheader_type {
-      unsigned header_size;
-      bool fin;
-      bool mask;
-      enum opcode_type {
-          CONTINUATION = 0x0,
-          TEXT_FRAME = 0x1,
-          BINARY_FRAME = 0x2,
-          CLOSE = 8,
-          PING = 9,
-          PONG = 0xa,
-      } opcode;
-      int N0;
-      uint64_t N;
-      uint8_t masking_key[4];
+  enum Opcode
+  {
+    continuationFrame = 0x0,
+    textFrame = 0x1,
+    binaryFrame = 0x2,
+    closeFrame = 0x8,
+    pingFrame = 0x9,
+    pongFrame = 0xa
   };
 
-  buffer.clear();
+  const size_t maxMessageSize = 0x10000;
 
   for(;;)
   {
+    // handle frames in the receive buffer
     for(;;)
     {
-      wsheader_type ws;
-      if (recvBuffer.size() < 2) { break; /* Need at least 2 */ }
-      uint8_t* data = (uint8_t*)recvBuffer; // peek, but don't consume
-      ws.fin = (data[0] & 0x80) == 0x80;
-      ws.opcode = (wsheader_type::opcode_type) (data[0] & 0x0f);
-      ws.mask = (data[1] & 0x80) == 0x80;
-      ws.N0 = (data[1] & 0x7f);
-      ws.header_size = 2 + (ws.N0 == 126? 2 : 0) + (ws.N0 == 127? 8 : 0) + (ws.mask? 4 : 0);
-      if (recvBuffer.size() < ws.header_size) { break; /* Need: ws.header_size - rxbuf.size() */ }
-      int i;
-      if (ws.N0 < 126) {
-          ws.N = ws.N0;
-          i = 2;
-      }
-      else if (ws.N0 == 126) {
-          ws.N = 0;
-          ws.N |= ((uint64_t) data[2]) << 8;
-          ws.N |= ((uint64_t) data[3]) << 0;
-          i = 4;
+      // parse frame header
+      size_t framePos = recvPos + fragmentSize;
+      size_t available = recvBuffer.size() - framePos;
+      if(available < 2)
+        break;
+      byte_t* frame = (byte_t*)recvBuffer + framePos;
+      bool_t fin = (frame[0] & 0x80) != 0;
+      uint_t opcode = frame[0] & 0x0f;
+      bool_t mask = (frame[1] & 0x80) != 0;
+      uint_t n0 = frame[1] & 0x7f;
+      size_t headerSize = 2 + (n0 == 126 ? 2 : 0) + (n0 == 127 ? 8 : 0) + (mask ? 4 : 0);
+      if(available < headerSize)
+        break;
+      uint64_t n = n0;
+      size_t i = 2;
+      if(n0 == 126)
+      {
+        n = (uint64_t)frame[2] << 8 | (uint64_t)frame[3];
+        i = 4;
       }
-      else if (ws.N0 == 127) {
-          ws.N = 0;
-          ws.N |= ((uint64_t) data[2]) << 56;
-          ws.N |= ((uint64_t) data[3]) << 48;
-          ws.N |= ((uint64_t) data[4]) << 40;
-          ws.N |= ((uint64_t) data[5]) << 32;
-          ws.N |= ((uint64_t) data[6]) << 24;
-          ws.N |= ((uint64_t) data[7]) << 16;
-          ws.N |= ((uint64_t) data[8]) << 8;
-          ws.N |= ((uint64_t) data[9]) << 0;
-          i = 10;
+      else if(n0 == 127)
+      {
+        n = 0;
+        for(; i < 10; ++i)
+          n = n << 8 | (uint64_t)frame[i];
       }
-      if (ws.mask) {
-          ws.masking_key[0] = ((uint8_t) data[i+0]) << 0;
-          ws.masking_key[1] = ((uint8_t) data[i+1]) << 0;
-          ws.masking_key[2] = ((uint8_t) data[i+2]) << 0;
-          ws.masking_key[3] = ((uint8_t) data[i+3]) << 0;
+      if(n >= maxMessageSize)
+      {
+        error = "Received data frame is too large.";
+        close();
+        return false;
       }
-      else {
-          ws.masking_key[0] = 0;
-          ws.masking_key[1] = 0;
-          ws.masking_key[2] = 0;
-          ws.masking_key[3] = 0;
+      size_t payloadSize = (size_t)n;
+      if(available < headerSize + payloadSize)
+        break;
+      byte_t* payload = frame + headerSize;
+      if(mask)
+      {
+        const byte_t* maskingKey = frame + i;
+        for(size_t j = 0; j < payloadSize; ++j)
+          payload[j] ^= maskingKey[j & 0x3];
       }
-      if (recvBuffer.size() < ws.header_size+ws.N) { break; /* Need: ws.header_size+ws.N - rxbuf.size() */ }
-
-      // We got a whole message, now do something with it:
-      if (false) { }
-//      else if (ws.opcode == wsheader_type::CONTINUATION) {
-//          if (ws.mask) { for (size_t i = 0; i != ws.N; ++i) { data[i+ws.header_size] ^= ws.masking_key[i&0x3]; } }
-//          buffer.append((const byte_t*)recvBuffer + ws.header_size, (size_t)ws.N);
-//          recvBuffer.removeFront(ws.header_size + (size_t)ws.N);
-//      }
-      else if (ws.opcode == wsheader_type::TEXT_FRAME && ws.fin) {
-          if (ws.mask) { for (size_t i = 0; i != ws.N; ++i) { data[i+ws.header_size] ^= ws.masking_key[i&0x3]; } }
-          if(recvBuffer.size() == ws.header_size + (size_t)ws.N /*&& buffer.isEmpty() */)
-          {
-            recvBuffer.removeFront(ws.header_size);
-            buffer.swap(recvBuffer);
-          }
-          else
-          {
-            buffer.append((const byte_t*)recvBuffer + ws.header_size, (size_t)ws.N);
-            recvBuffer.removeFront(ws.header_size + (size_t)ws.N);
-          }
+
+      // handle frame
+      switch(opcode)
+      {
+      case continuationFrame:
+      case textFrame:
+      case binaryFrame:
+        if((opcode == continuationFrame) != inFragment)
+        {
+          error = "Received unexpected data frame.";
+          close();
+          return false;
+        }
+        if(fin && fragmentSize == 0)
+        { // the most common case: hand out the payload right where it is
+          // (this is also reached by the last fragment of a message whose previous fragments were empty)
+          inFragment = false;
+          data = payload;
+          size = payloadSize;
+          recvPos = framePos + headerSize + payloadSize;
           return true;
-      }
-      else if (ws.opcode == wsheader_type::PING) {
-          if (ws.mask) { for (size_t i = 0; i != ws.N; ++i) { data[i+ws.header_size] ^= ws.masking_key[i&0x3]; } }
-          sendFrame(wsheader_type::PONG, data + ws.header_size, (size_t)ws.N);
-          recvBuffer.removeFront(ws.header_size + (size_t)ws.N);
-      }
-      else if (ws.opcode == wsheader_type::PONG) { }
-      else if (ws.opcode == wsheader_type::CLOSE) {
+        }
+        // append the payload to the previous fragments by moving it over the frame header
+        Memory::move(frame, payload, payloadSize);
+        removeFrame(framePos + payloadSize, headerSize);
+        fragmentSize += payloadSize;
+        if(fragmentSize >= maxMessageSize)
+        {
+          error = "Received message is too large.";
+          close();
+          return false;
+        }
+        inFragment = !fin;
+        if(fin)
+        {
+          data = (byte_t*)recvBuffer + recvPos;
+          size = fragmentSize;
+          recvPos += fragmentSize;
+          fragmentSize = 0;
+          return true;
+        }
+        continue;
+      case pingFrame:
+        sendFrame(pongFrame, payload, payloadSize);
+        break;
+      case pongFrame:
+        break;
+      case closeFrame:
         close();
         error = "Connection was closed.";
         return false;
-      }
-      else {
-        error.printf("Got unknown message 0x%02x.", (int_t)ws.opcode);
+      default:
+        error.printf("Got unknown message 0x%02x.", opcode);
         close();
         return false;
       }
-
-      recvBuffer.removeFront(ws.header_size + (size_t)ws.N);
+      removeFrame(framePos, headerSize + payloadSize);
     }
 
-    //
-    if(recvBuffer.size() >= 4500)
+    // release data that was already handed out
+    if(recvPos > 0)
     {
-      error = "Received data frame is too large.";
-      close();
-      return false;
+      size_t remaining = recvBuffer.size() - recvPos;
+      Memory::move((byte_t*)recvBuffer, (const byte_t*)recvBuffer + recvPos, remaining);
+      recvBuffer.resize(remaining);
+      recvPos = 0;
     }
+
+    // receive more data
     size_t received;
     size_t recvBufferSize = recvBuffer.size();
     recvBuffer.resize(recvBufferSize + 4500);
@@ -322,16 +349,29 @@ bool_t Websocket::recv(Buffer& buffer, int64_t timeout)
       close();
       return false;
     }
+    recvBuffer.resize(recvBufferSize + received);
     if(received == 0)
     {
-      recvBuffer.resize(recvBufferSize);
+      data = 0;
+      size = 0;
       return true;
     }
-    recvBufferSize += received;
-    recvBuffer.resize(recvBufferSize);
   }
 }
 
+void_t Websocket::removeFrame(size_t pos, size_t size)
+{
+  if(pos == recvPos)
+  {
+    recvPos += size;
+    return;
+  }
+  byte_t* frame = (byte_t*)recvBuffer + pos;
+  size_t remaining = recvBuffer.size() - pos - size;
+  Memory::move(frame, frame + size, remaining);
+  recvBuffer.resize(pos + remaining);
+}
+
 bool_t Websocket::send(const byte_t* buffer, size_t size)
 {
   return sendFrame(0x1, buffer, size);
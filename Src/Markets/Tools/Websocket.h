@@ -13,7 +13,21 @@ public:
   bool_t connect(const String& url);
   void_t close();
   bool_t isOpen() const;
+
+  /**
+  * Returns the socket of the connection or -1 if it is not open. It can be watched for incoming data with recv() being called with a timeout of 0.
+  */
+  int_t getSocket() const {return s ? (int_t)(intptr_t)s : -1;}
   bool_t recv(Buffer& buffer, int64_t timeout);
+
+  /**
+  * Receives a message without copying it out of the receive buffer.
+  * Masked frames are unmasked and fragmented messages are reassembled in place.
+  * @param data Receives a pointer to the message or \c 0 when the timeout expired. It is valid until the next call of recv() or close().
+  * @param size Receives the size of the message.
+  * @param timeout The maximum time in milliseconds to wait for a message.
+  */
+  bool_t recv(byte_t*& data, size_t& size, int64_t timeout);
   bool_t send(const byte_t* buffer, size_t size);
   bool_t send(const String& data);
   bool_t sendPing();
@@ -27,10 +41,14 @@ private:
   String origin;
   bool useMask;
   Buffer recvBuffer;
+  size_t recvPos;
+  size_t fragmentSize;
+  bool_t inFragment;
 
   bool_t sendAll(const byte_t* data, size_t size);
   bool_t receive(byte_t* data, size_t size, int64_t timeout, size_t& received);
   bool_t sendFrame(uint_t type, const byte_t* data, size_t size);
+  void_t removeFrame(size_t pos, size_t size);
 
   static String getSocketErrorString();
 };
@@ -0,0 +1,588 @@
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <cstdlib>
+
+#include <nstd/Log.h>
+#include <nstd/Console.h>
+#include <nstd/Process.h>
+#include <nstd/Time.h>
+#include <nstd/Math.h>
+#include <nstd/Error.h>
+#include <nstd/Array.h>
+
+#include "Main.h"
+
+static const uint_t maxTradesPerTick = 10000;
+
+int_t main(int_t argc, char_t* argv[])
+{
+  uint16_t port = 8080;
+  double tradeRate = 1.;
+  int64_t latency = 0;
+
+  // parse parameters
+  {
+    Process::Option options[] = {
+        {'p', "port", Process::argumentFlag},
+        {'r', "rate", Process::argumentFlag},
+        {'l', "latency", Process::argumentFlag},
+        {'h', "help", Process::optionFlag},
+    };
+    Process::Arguments arguments(argc, argv, options);
+    int_t character;
+    String argument;
+    while(arguments.read(character, argument))
+      switch(character)
+      {
+      case 'p':
+        port = (uint16_t)argument.toUInt();
+        break;
+      case 'r':
+        tradeRate = argument.toDouble();
+        break;
+      case 'l':
+        latency = argument.toInt64();
+        break;
+      case '?':
+        Console::errorf("Unknown option: %s.\n", (const char_t*)argument);
+        return -1;
+      case ':':
+        Console::errorf("Option %s required an argument.\n", (const char_t*)argument);
+        return -1;
+      default:
+        Console::errorf("Usage: %s [-p <port>] [-r <rate>] [-l <latency>]\n\
+  -p, --port=<port>         Listen on <port>. (Default is 8080)\n\
+  -r, --rate=<rate>         Generate <rate> trades per second. (Default is 1)\n\
+  -l, --latency=<latency>   Delay responses and stream messages by <latency> milliseconds.\n", argv[0]);
+        return -1;
+      }
+  }
+  Log::setFormat("%P> %m");
+
+  Main main(tradeRate, latency);
+  if(!main.listen(port))
+  {
+    Log::errorf("Could not listen on port %hu: %s", port, (const char_t*)main.getErrorString());
+    return -1;
+  }
+  Log::infof("Listening on port %hu.", port);
+  if(!main.process())
+  {
+    Log::errorf("Could not process connections: %s", (const char_t*)main.getErrorString());
+    return -1;
+  }
+  return 0;
+}
+
+Main::Main(double tradeRate, int64_t latency) : tradeRate(tradeRate), latency(latency), listener(-1),
+  price(600.), nextTradeId(1), nextTradeTime(0.), nextOrderId(1), nextTransactionId(1), usdBalance(10000.), btcBalance(10.), fee(0.0025) {}
+
+Main::~Main()
+{
+  for(HashMap<int_t, Client*>::Iterator i = clients.begin(), end = clients.end(); i != end; ++i)
+  {
+    ::close((*i)->s);
+    delete *i;
+  }
+  if(listener >= 0)
+    ::close(listener);
+}
+
+bool_t Main::listen(uint16_t port)
+{
+  listener = socket(AF_INET, SOCK_STREAM, 0);
+  if(listener < 0)
+    return error = Error::getErrorString(), false;
+  int val = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val));
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if(bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(listener, SOMAXCONN) != 0)
+    return error = Error::getErrorString(), false;
+  fcntl(listener, F_SETFL, O_NONBLOCK);
+  return true;
+}
+
+bool_t Main::process()
+{
+  Array<pollfd> pollFds;
+  Array<Client*> pollClients;
+  for(;;)
+  {
+    // generate trades
+    int64_t now = Time::time();
+    if(tradeRate > 0.)
+    {
+      // the schedule is kept as a fractional millisecond time, so rates above 1000 trades per second do not round to a
+      // zero interval, and a tick generates a bounded amount of trades when the process falls behind
+      if(nextTradeTime == 0.)
+        nextTradeTime = (double)now;
+      double interval = 1000. / tradeRate;
+      uint_t count = 0;
+      for(; nextTradeTime <= (double)now && count < maxTradesPerTick; nextTradeTime += interval, ++count)
+        generateTrade((int64_t)nextTradeTime);
+      if(nextTradeTime <= (double)now) // drop the trades that could not be generated in time
+        nextTradeTime = (double)now + interval;
+    }
+
+    // send due data
+    for(HashMap<int_t, Client*>::Iterator i = clients.begin(), end = clients.end(); i != end;)
+    {
+      Client& client = **i;
+      ++i;
+      if(!flush(client))
+        close(client);
+    }
+
+    // wait for events
+    int64_t timeout = tradeRate > 0. ? (int64_t)nextTradeTime - now : 1000;
+    pollFds.clear();
+    pollClients.clear();
+    pollfd& listenerFd = pollFds.append(pollfd());
+    listenerFd.fd = listener;
+    listenerFd.events = POLLIN;
+    pollClients.append(0);
+    for(HashMap<int_t, Client*>::Iterator i = clients.begin(), end = clients.end(); i != end; ++i)
+    {
+      Client& client = **i;
+      pollfd& clientFd = pollFds.append(pollfd());
+      clientFd.fd = client.s;
+      clientFd.events = POLLIN;
+      if(!client.sendQueue.isEmpty())
+      {
+        int64_t due = client.sendQueue.front().time - now;
+        if(due <= 0)
+          clientFd.events |= POLLOUT;
+        else if(due < timeout)
+          timeout = due;
+      }
+      pollClients.append(&client);
+    }
+    if(timeout < 0)
+      timeout = 0;
+    int ret = poll(&pollFds[0], pollFds.size(), (int)timeout);
+    if(ret < 0)
+    {
+      if(errno == EINTR)
+        continue;
+      return error = Error::getErrorString(), false;
+    }
+
+    // handle events
+    for(size_t i = 0, count = pollFds.size(); i < count; ++i)
+    {
+      const pollfd& pollFd = pollFds[i];
+      if(!pollFd.revents)
+        continue;
+      if(pollFd.fd == listener)
+      {
+        accept();
+        continue;
+      }
+      Client& client = *pollClients[i];
+      if(pollFd.revents & (POLLIN | POLLHUP | POLLERR))
+      {
+        if(!receive(client))
+        {
+          close(client);
+          continue;
+        }
+      }
+      if(pollFd.revents & POLLOUT)
+        if(!flush(client))
+          close(client);
+    }
+  }
+}
+
+void_t Main::accept()
+{
+  for(;;)
+  {
+    int_t s = ::accept(listener, 0, 0);
+    if(s < 0)
+      return;
+    fcntl(s, F_SETFL, O_NONBLOCK);
+    int val = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &val, sizeof(val));
+    clients.append(s, new Client(s));
+  }
+}
+
+bool_t Main::receive(Client& client)
+{
+  byte_t buffer[4096];
+  ssize_t received = recv(client.s, buffer, sizeof(buffer), 0);
+  if(received <= 0)
+    return received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+  client.recvBuffer.append(buffer, received);
+  return client.websocket ? handleWebsocketData(client) : handleHttpRequest(client);
+}
+
+bool_t Main::flush(Client& client)
+{
+  int64_t now = Time::time();
+  while(!client.sendQueue.isEmpty())
+  {
+    Output& output = client.sendQueue.front();
+    if(output.time > now)
+      break;
+    ssize_t sent = ::send(client.s, (const byte_t*)output.data + client.sent, output.data.size() - client.sent, MSG_NOSIGNAL);
+    if(sent < 0)
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    client.sent += sent;
+    if(client.sent < output.data.size())
+      break;
+    client.sent = 0;
+    client.sendQueue.removeFront();
+  }
+  return true;
+}
+
+void_t Main::close(Client& client)
+{
+  ::close(client.s);
+  clients.remove(client.s);
+  delete &client;
+}
+
+void_t Main::send(Client& client, const byte_t* data, size_t size)
+{
+  Output& output = client.sendQueue.append(Output());
+  output.time = Time::time() + latency;
+  output.data.assign(data, size);
+}
+
+bool_t Main::handleHttpRequest(Client& client)
+{
+  for(;;)
+  {
+    // parse request header
+    String request((const char_t*)(const byte_t*)client.recvBuffer, client.recvBuffer.size());
+    const char_t* headerEnd = request.find("\r\n\r\n");
+    if(!headerEnd)
+      return client.recvBuffer.size() < 0x10000;
+    size_t headerSize = headerEnd + 4 - (const char_t*)request;
+    String header = request.substr(0, headerSize);
+    size_t contentLength = 0;
+    const char_t* contentLengthPos = header.find("Content-Length: ");
+    if(contentLengthPos)
+      contentLength = (size_t)String::toUInt64(contentLengthPos + 16);
+    if(client.recvBuffer.size() < headerSize + contentLength)
+    {
+      if(header.find("Expect: 100-continue"))
+      {
+        static const char_t continueResponse[] = "HTTP/1.1 100 Continue\r\n\r\n";
+        send(client, (const byte_t*)continueResponse, sizeof(continueResponse) - 1);
+      }
+      return true;
+    }
+    String body = request.substr(headerSize, contentLength);
+    const char_t* methodEnd = header.find(' ');
+    const char_t* pathEnd = methodEnd ? String::find(methodEnd + 1, ' ') : 0;
+    if(!pathEnd)
+      return false;
+    String path = header.substr(methodEnd + 1 - (const char_t*)header, pathEnd - methodEnd - 1);
+    const char_t* query = path.find('?');
+    if(query)
+      path.resize(query - (const char_t*)path);
+    bool_t upgrade = header.find("Upgrade: websocket") != 0;
+    client.recvBuffer.removeFront(headerSize + contentLength);
+
+    // answer websocket handshake with the Pusher connection message
+    if(upgrade && path.startsWith("/app/"))
+    {
+      static const char_t upgradeResponse[] = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n\r\n";
+      send(client, (const byte_t*)upgradeResponse, sizeof(upgradeResponse) - 1);
+      sendWebsocketMessage(client, "{\"event\":\"pusher:connection_established\",\"data\":\"{\\\"socket_id\\\":\\\"1.1\\\"}\"}");
+      client.websocket = true;
+      return handleWebsocketData(client);
+    }
+
+    // answer api request
+    String response;
+    handleApiRequest(path, body, response);
+    String message;
+    if(response.isEmpty())
+      message.printf("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+    else
+      message.printf("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %u\r\n\r\n%s", (uint_t)response.length(), (const char_t*)response);
+    send(client, (const byte_t*)(const char_t*)message, message.length());
+  }
+}
+
+bool_t Main::handleWebsocketData(Client& client)
+{
+  for(;;)
+  {
+    size_t available = client.recvBuffer.size();
+    if(available < 2)
+      return true;
+    const byte_t* frame = client.recvBuffer;
+    uint_t opcode = frame[0] & 0x0f;
+    bool_t mask = (frame[1] & 0x80) != 0;
+    uint64_t n = frame[1] & 0x7f;
+    size_t headerSize = 2 + (n == 126 ? 2 : 0) + (n == 127 ? 8 : 0) + (mask ? 4 : 0);
+    if(available < headerSize)
+      return true;
+    if(n == 126)
+      n = (uint64_t)frame[2] << 8 | (uint64_t)frame[3];
+    else if(n == 127)
+      return false;
+    if(available < headerSize + n)
+      return true;
+    if(mask)
+    {
+      byte_t* data = (byte_t*)frame + headerSize;
+      const byte_t* maskingKey = frame + headerSize - 4;
+      for(size_t i = 0; i < n; ++i)
+        data[i] ^= maskingKey[i & 0x3];
+    }
+    String payload((const char_t*)frame + headerSize, (size_t)n);
+    switch(opcode)
+    {
+    case 0x1: // text frame
+      if(payload.find("pusher:subscribe") && payload.find("live_trades"))
+      {
+        sendWebsocketMessage(client, "{\"event\":\"pusher_internal:subscription_succeeded\",\"data\":\"{}\",\"channel\":\"live_trades\"}");
+        client.subscribed = true;
+      }
+      break;
+    case 0x8: // close frame
+      return false;
+    case 0x9: // ping frame
+      sendWebsocketMessage(client, payload, 0xa);
+      break;
+    default:
+      break;
+    }
+    client.recvBuffer.removeFront(headerSize + (size_t)n);
+  }
+}
+
+void_t Main::sendWebsocketMessage(Client& client, const String& message, uint_t opcode)
+{
+  size_t size = message.length();
+  byte_t header[4];
+  size_t headerSize = 2;
+  header[0] = 0x80 | opcode;
+  if(size < 126)
+    header[1] = (byte_t)size;
+  else
+  {
+    header[1] = 126;
+    header[2] = (byte_t)(size >> 8);
+    header[3] = (byte_t)size;
+    headerSize = 4;
+  }
+  Buffer frame;
+  frame.reserve(headerSize + size);
+  frame.append(header, headerSize);
+  frame.append((const byte_t*)(const char_t*)message, size);
+  send(client, frame, frame.size());
+}
+
+void_t Main::handleApiRequest(const String& path, const String& body, String& response)
+{
+  int64_t now = Time::time();
+  if(path == "/api/ticker/")
+  {
+    double spread = price * 0.001;
+    response.printf("{\"high\": \"%.2f\", \"last\": \"%.2f\", \"timestamp\": \"%lld\", \"bid\": \"%.2f\", \"vwap\": \"%.2f\", \"volume\": \"1000.00000000\", \"low\": \"%.2f\", \"ask\": \"%.2f\"}",
+      price, price, now / 1000, price - spread, price, price, price + spread);
+  }
+  else if(path == "/api/transactions/")
+  {
+    response = "[";
+    String entry;
+    for(List<Trade>::Iterator i = trades.end(), begin = trades.begin(); i != begin;)
+    {
+      const Trade& trade = *--i;
+      entry.printf("{\"date\": \"%lld\", \"tid\": %llu, \"price\": \"%.2f\", \"amount\": \"%.8f\"}", trade.time / 1000, trade.id, trade.price, trade.amount);
+      if(response.length() > 1)
+        response.append(", ");
+      response.append(entry);
+    }
+    response.append("]");
+  }
+  else if(path == "/api/balance/")
+  {
+    double reservedUsd, reservedBtc;
+    getReservedBalance(reservedUsd, reservedBtc);
+    response.printf("{\"btc_reserved\": \"%.8f\", \"fee\": \"%.4f\", \"btc_available\": \"%.8f\", \"usd_reserved\": \"%.2f\", \"btc_balance\": \"%.8f\", \"usd_balance\": \"%.2f\", \"usd_available\": \"%.2f\"}",
+      reservedBtc, fee * 100., btcBalance - reservedBtc, reservedUsd, btcBalance, usdBalance, usdBalance - reservedUsd);
+  }
+  else if(path == "/api/open_orders/")
+  {
+    response = "[";
+    for(HashMap<uint64_t, Order>::Iterator i = orders.begin(), end = orders.end(); i != end; ++i)
+    {
+      if(response.length() > 1)
+        response.append(", ");
+      response.append(getOrderJson(*i));
+    }
+    response.append("]");
+  }
+  else if(path == "/api/buy/" || path == "/api/sell/")
+  {
+    Order order;
+    order.id = nextOrderId++;
+    order.time = now;
+    order.buy = path == "/api/buy/";
+    order.price = getFormValue(body, "price").toDouble();
+    order.amount = getFormValue(body, "amount").toDouble();
+    double reservedUsd, reservedBtc;
+    getReservedBalance(reservedUsd, reservedBtc);
+    if(order.price <= 0. || order.amount <= 0.)
+      response = "{\"error\": {\"__all__\": [\"Invalid order.\"]}}";
+    else if(order.buy ? order.amount * order.price * (1. + fee) > usdBalance - reservedUsd : order.amount > btcBalance - reservedBtc)
+      response = "{\"error\": {\"__all__\": [\"You have only insufficient funds.\"]}}";
+    else
+    {
+      orders.append(order.id, order);
+      response = getOrderJson(order);
+    }
+  }
+  else if(path == "/api/cancel_order/")
+  {
+    HashMap<uint64_t, Order>::Iterator it = orders.find(getFormValue(body, "id").toUInt64());
+    if(it == orders.end())
+      response = "false";
+    else
+    {
+      orders.remove(it);
+      response = "true";
+    }
+  }
+  else if(path == "/api/user_transactions/")
+  {
+    size_t offset = getFormValue(body, "offset").toUInt();
+    String limitStr = getFormValue(body, "limit");
+    size_t limit = limitStr.isEmpty() ? 100 : limitStr.toUInt();
+    response = "[";
+    size_t index = 0;
+    for(List<String>::Iterator i = userTransactions.end(), begin = userTransactions.begin(); i != begin && index < offset + limit; ++index)
+    {
+      const String& transaction = *--i;
+      if(index < offset)
+        continue;
+      if(response.length() > 1)
+        response.append(", ");
+      response.append(transaction);
+    }
+    response.append("]");
+  }
+}
+
+void_t Main::generateTrade(int64_t now)
+{
+  Trade trade;
+  trade.id = nextTradeId++;
+  trade.time = now;
+  price += price * 0.0005 * ((double)rand() / RAND_MAX - 0.5);
+  trade.price = Math::floor(price * 100.) / 100.;
+  trade.amount = Math::floor((double)rand() / RAND_MAX * 200000000.) / 100000000. + 0.00000001;
+  trades.append(trade);
+  if(trades.size() > 100)
+    trades.removeFront();
+
+  String data, message;
+  data.printf("{\"price\": %.2f, \"amount\": %.8f, \"id\": %llu}", trade.price, trade.amount, trade.id);
+  data.replace("\"", "\\\"");
+  message.printf("{\"event\":\"trade\",\"channel\":\"live_trades\",\"data\":\"%s\"}", (const char_t*)data);
+  for(HashMap<int_t, Client*>::Iterator i = clients.begin(), end = clients.end(); i != end; ++i)
+  {
+    Client& client = **i;
+    if(client.subscribed)
+      sendWebsocketMessage(client, message);
+  }
+
+  fillOrders(trade);
+}
+
+void_t Main::fillOrders(const Trade& trade)
+{
+  for(HashMap<uint64_t, Order>::Iterator i = orders.begin(), end = orders.end(); i != end;)
+  {
+    const Order& order = *i;
+    if(order.buy ? trade.price > order.price : trade.price < order.price)
+    {
+      ++i;
+      continue;
+    }
+    double usd = order.amount * order.price;
+    double orderFee = Math::ceil(usd * fee * 100.) / 100.;
+    if(order.buy)
+    {
+      usdBalance -= usd + orderFee;
+      btcBalance += order.amount;
+    }
+    else
+    {
+      usdBalance += usd - orderFee;
+      btcBalance -= order.amount;
+    }
+    String transaction;
+    transaction.printf("{\"fee\": \"%.2f\", \"btc\": \"%.8f\", \"datetime\": \"%s\", \"usd\": \"%.2f\", \"id\": %llu, \"type\": 2, \"order_id\": %llu}",
+      orderFee, order.buy ? order.amount : -order.amount, (const char_t*)formatTime(trade.time), order.buy ? -usd : usd, nextTransactionId++, order.id);
+    userTransactions.append(transaction);
+    if(userTransactions.size() > 10000)
+      userTransactions.removeFront();
+    i = orders.remove(i);
+  }
+}
+
+void_t Main::getReservedBalance(double& usd, double& btc) const
+{
+  usd = btc = 0.;
+  for(HashMap<uint64_t, Order>::Iterator i = orders.begin(), end = orders.end(); i != end; ++i)
+  {
+    const Order& order = *i;
+    if(order.buy)
+      usd += Math::ceil(order.amount * order.price * (1. + fee) * 100.) / 100.;
+    else
+      btc += order.amount;
+  }
+}
+
+String Main::getOrderJson(const Order& order) const
+{
+  String json;
+  json.printf("{\"price\": \"%.2f\", \"amount\": \"%.8f\", \"type\": %d, \"id\": %llu, \"datetime\": \"%s\"}",
+    order.price, order.amount, order.buy ? 0 : 1, order.id, (const char_t*)formatTime(order.time));
+  return json;
+}
+
+String Main::getFormValue(const String& body, const char_t* name)
+{
+  // the values are sent as multipart/form-data
+  String key;
+  key.printf("name=\"%s\"", name);
+  const char_t* pos = body.find(key);
+  if(!pos)
+    return String();
+  const char_t* start = String::find(pos, "\r\n\r\n");
+  if(!start)
+    return String();
+  start += 4;
+  const char_t* end = String::find(start, "\r\n");
+  if(!end)
+    return String();
+  return body.substr(start - (const char_t*)body, end - start);
+}
+
+String Main::formatTime(int64_t time)
+{
+  Time utcTime(time, true);
+  String result;
+  result.printf("%04d-%02d-%02d %02d:%02d:%02d", utcTime.year, utcTime.month, utcTime.day, utcTime.hour, utcTime.min, utcTime.sec);
+  return result;
+}
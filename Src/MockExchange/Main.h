@@ -0,0 +1,102 @@
+
+#pragma once
+
+#include <nstd/String.h>
+#include <nstd/Buffer.h>
+#include <nstd/HashMap.h>
+#include <nstd/List.h>
+
+/**
+* A local stand-in for the Bitstamp exchange. It serves the REST api and the Pusher websocket
+* stream that are used by the Bitstamp market and broker and it generates trades at a given rate.
+*/
+class Main
+{
+public:
+  Main(double tradeRate, int64_t latency);
+  ~Main();
+
+  const String& getErrorString() const {return error;}
+
+  bool_t listen(uint16_t port);
+  bool_t process();
+
+private:
+  class Output
+  {
+  public:
+    int64_t time;
+    Buffer data;
+  };
+
+  class Client
+  {
+  public:
+    int_t s;
+    Buffer recvBuffer;
+    List<Output> sendQueue;
+    size_t sent;
+    bool_t websocket;
+    bool_t subscribed;
+
+    Client(int_t s) : s(s), sent(0), websocket(false), subscribed(false) {}
+  };
+
+  class Trade
+  {
+  public:
+    uint64_t id;
+    int64_t time;
+    double price;
+    double amount;
+  };
+
+  class Order
+  {
+  public:
+    uint64_t id;
+    int64_t time;
+    bool_t buy;
+    double price;
+    double amount;
+  };
+
+private:
+  double tradeRate;
+  int64_t latency;
+  int_t listener;
+  HashMap<int_t, Client*> clients;
+  String error;
+
+  double price;
+  uint64_t nextTradeId;
+  double nextTradeTime;
+  List<Trade> trades;
+  HashMap<uint64_t, Order> orders;
+  uint64_t nextOrderId;
+  List<String> userTransactions;
+  uint64_t nextTransactionId;
+  double usdBalance;
+  double btcBalance;
+  double fee;
+
+private:
+  void_t accept();
+  bool_t receive(Client& client);
+  bool_t flush(Client& client);
+  void_t close(Client& client);
+
+  bool_t handleHttpRequest(Client& client);
+  bool_t handleWebsocketData(Client& client);
+  void_t handleApiRequest(const String& path, const String& body, String& response);
+  void_t send(Client& client, const byte_t* data, size_t size);
+  void_t sendWebsocketMessage(Client& client, const String& message, uint_t opcode = 0x1);
+
+  void_t generateTrade(int64_t now);
+  void_t fillOrders(const Trade& trade);
+  void_t getReservedBalance(double& usd, double& btc) const;
+  String getOrderJson(const Order& order) const;
+
+  static String getFormValue(const String& body, const char_t* name);
+  static String formatTime(int64_t time);
+};
@@ -1,5 +1,7 @@
 
 #include <nstd/Log.h>
+#include <nstd/Console.h>
+#include <nstd/Process.h>
 #include <nstd/File.h>
 #include <nstd/Directory.h>
 #include <nstd/Thread.h>
@@ -9,13 +11,45 @@
 int_t main(int_t argc, char_t* argv[])
 {
   String binaryDir = File::dirname(File::dirname(String(argv[0], String::length(argv[0]))));
+  bool_t useMarketHost = false;
 
+  // parse parameters
+  {
+    Process::Option options[] = {
+        {'s', "market-host", Process::optionFlag},
+        {'h', "help", Process::optionFlag},
+    };
+    Process::Arguments arguments(argc, argv, options);
+    int_t character;
+    String argument;
+    while(arguments.read(character, argument))
+      switch(character)
+      {
+      case 's':
+        useMarketHost = true;
+        break;
+      case '?':
+        Console::errorf("Unknown option: %s.\n", (const char_t*)argument);
+        return -1;
+      case ':':
+        Console::errorf("Option %s required an argument.\n", (const char_t*)argument);
+        return -1;
+      default:
+        Console::errorf("Usage: %s [-s]\n\
+  -s, --market-host   Run all markets in one MarketHost process instead of one\n\
+                      process per market.\n", argv[0]);
+        return -1;
+      }
+  }
   Log::setFormat("%P> %m");
 
   // initialize connection handler
   Main main;
 
   // find market engines
+  if(useMarketHost && File::isExecutable(binaryDir + "/MarketHost"))
+    main.addMarket("MarketHost"); // runs all markets in one process, a crash of one market stops all of them
+  else
   {
     Directory dir;
     if(dir.open(binaryDir + "/Markets", String(), false))
@@ -140,7 +174,7 @@ void_t Main::removedEntity(uint32_t tableId, uint64_t entityId)
 
 void_t Main::addedProcess(uint64_t entityId, const String& command)
 {
-  if(command.startsWith("Markets/"))
+  if(command.startsWith("Markets/") || command == "MarketHost")
   {
     HashMap<String, Market>::Iterator it = markets.find(command);
     if(it == markets.end())
@@ -164,6 +198,6 @@ void_t Main::removedProcess(uint64_t entityId)
     Market* market = *it;
     market->running = false;
     processes.remove(it);
-    // todo: restart process?
+    // crashed market processes are restarted by the server, a removed process was stopped or given up after crashing repeatedly
   }
 }
@@ -3,6 +3,11 @@
 #include <nstd/File.h>
 #include <nstd/Thread.h>
 #include <nstd/Directory.h>
+#include <nstd/Console.h>
+#include <nstd/Process.h>
+#include <nstd/Array.h>
+#include <nstd/HashSet.h>
+#include <nstd/Buffer.h>
 
 #include "Main.h"
 #include "User.h"
@@ -12,14 +17,49 @@
 int_t main(int_t argc, char_t* argv[])
 {
   String binaryDir = File::dirname(File::dirname(String(argv[0], String::length(argv[0]))));
+  uint_t shards = 1;
+
+  // parse parameters
+  {
+    Process::Option options[] = {
+        {'w', "workers", Process::argumentFlag},
+        {'h', "help", Process::optionFlag},
+    };
+    Process::Arguments arguments(argc, argv, options);
+    int_t character;
+    String argument;
+    while(arguments.read(character, argument))
+      switch(character)
+      {
+      case 'w':
+        shards = argument.toUInt();
+        if(shards < 1)
+          shards = 1;
+        break;
+      case '?':
+        Console::errorf("Unknown option: %s.\n", (const char_t*)argument);
+        return -1;
+      case ':':
+        Console::errorf("Option %s required an argument.\n", (const char_t*)argument);
+        return -1;
+      default:
+        Console::errorf("Usage: %s [-w <count>]\n\
+  -w, --workers=<count>   Split the users among <count> worker threads. (default is 1)\n", argv[0]);
+        return -1;
+      }
+  }
 
   //bool stop = true;
   //while(stop);
 
   Log::setFormat("%P> %m");
 
-  // initialize connection handler
-  Main main;
+  // initialize connection handlers
+  Array<Main*> mains;
+  mains.resize(shards);
+  for(uint_t i = 0; i < shards; ++i)
+    mains[i] = new Main(i, shards);
+  Main& main = *mains[0];
 
   // find broker types
   {
@@ -44,7 +84,8 @@ int_t main(int_t argc, char_t* argv[])
             String name = basename.substr(0, prevUpper - (const char_t*)basename);
             String comm = basename.substr(name.length(), lastUpper - prevUpper).toUpperCase();
             String base = basename.substr(name.length() + comm.length()).toUpperCase();
-            main.addBrokerType(name + "/" + comm + "/" + base, String("Brokers/") + path);
+            for(uint_t i = 0; i < shards; ++i)
+              mains[i]->addBrokerType(name + "/" + comm + "/" + base, String("Brokers/") + path);
           }
         }
     }
@@ -59,11 +100,13 @@ int_t main(int_t argc, char_t* argv[])
       bool_t isDir;
       while(dir.read(path, isDir))
         if(File::isExecutable(binaryDir + "/Bots/" + path))
-          main.addBotType(File::basename(path, "exe"), String("Bots/") + path);
+          for(uint_t i = 0; i < shards; ++i)
+            mains[i]->addBotType(File::basename(path, "exe"), String("Bots/") + path);
     }
   }
 
   // main loop
+  bool_t workersStarted = false;
   for(;; Thread::sleep(10 * 1000))
   {
     // connect to zlimdb server
@@ -74,6 +117,15 @@ int_t main(int_t argc, char_t* argv[])
     }
     Log::infof("Connected to zlimdb server.");
 
+    // start the other shards after the first shard has updated the broker and bot type tables
+    if(!workersStarted)
+    {
+      for(uint_t i = 1; i < shards; ++i)
+        if(!mains[i]->start())
+          Log::errorf("Could not start worker thread %u.", i);
+      workersStarted = true;
+    }
+
     // run connection handler loop
     main.process();
 
@@ -82,11 +134,59 @@ int_t main(int_t argc, char_t* argv[])
   return 0;
 }
 
+Main::Main(uint_t shard, uint_t shards) : shard(shard), shards(shards), loadingTables(false)
+{
+  brokerTables.append("broker", brokerTable);
+  brokerTables.append("balance", brokerBalanceTable);
+  brokerTables.append("orders", brokerOrdersTable);
+  brokerTables.append("transactions", brokerTransactionsTable);
+  brokerTables.append("log", brokerLogTable);
+  sessionTables.append("session", sessionTable);
+  sessionTables.append("orders", sessionOrdersTable);
+  sessionTables.append("transactions", sessionTransactionsTable);
+  sessionTables.append("assets", sessionAssetsTable);
+  sessionTables.append("log", sessionLogTable);
+  sessionTables.append("properties", sessionPropertiesTable);
+  sessionTables.append("markers", sessionMarkersTable);
+}
+
 Main::~Main()
 {
   disconnect();
 }
 
+bool_t Main::start()
+{
+  if(!thread.start(proc, this))
+    return false;
+  return true;
+}
+
+uint_t Main::proc()
+{
+  for(;; Thread::sleep(10 * 1000))
+  {
+    if(!connect())
+    {
+      Log::errorf("Worker %u could not connect to zlimdb server: %s", shard, (const char_t*)error);
+      continue;
+    }
+    process();
+    Log::errorf("Worker %u lost connection to zlimdb server: %s", shard, (const char_t*)error);
+  }
+  return 0;
+}
+
+bool_t Main::isLocalUser(const char_t* name, size_t length) const
+{
+  if(shards <= 1)
+    return true;
+  uint32_t hash = 2166136261U;
+  for(const char_t* end = name + length; name < end; ++name)
+    hash = (hash ^ (uint8_t)*name) * 16777619U;
+  return hash % shards == shard;
+}
+
 void_t Main::addBrokerType(const String& name, const String& executable)
 {
   BrokerType brokerType = {name, executable};
@@ -148,6 +248,8 @@ bool_t Main::connect()
       HashMap<String, uint64_t>::Iterator it = knownBotMarkets.find(marketName);
       if(it == knownBotMarkets.end())
       {
+        if(shard != 0)
+          continue;
         meguco_broker_type_entity* brokerType = (meguco_broker_type_entity*)buffer;
         ZlimdbConnection::setEntityHeader(brokerType->entity, 0, 0, sizeof(meguco_broker_type_entity));
         if(!ZlimdbConnection::copyString(marketName, brokerType->entity, brokerType->name_size, ZLIMDB_MAX_ENTITY_SIZE))
@@ -163,8 +265,9 @@ bool_t Main::connect()
         brokerTypes.append(*it, &*i);
       }
     }
-    for(HashMap<String, uint64_t>::Iterator i = knownBotMarkets.begin(), end = knownBotMarkets.end(); i != end; ++i)
-      connection.remove(botMarketsTableId, *i);
+    if(shard == 0)
+      for(HashMap<String, uint64_t>::Iterator i = knownBotMarkets.begin(), end = knownBotMarkets.end(); i != end; ++i)
+        connection.remove(botMarketsTableId, *i);
   }
 
   // update bot types table
@@ -195,6 +298,8 @@ bool_t Main::connect()
       HashMap<String, uint64_t>::Iterator it = knownBotEngines.find(botEngineName);
       if(it == knownBotEngines.end())
       {
+        if(shard != 0)
+          continue;
         meguco_bot_type_entity* botType = (meguco_bot_type_entity*)buffer;
         ZlimdbConnection::setEntityHeader(botType->entity, 0, 0, sizeof(meguco_bot_type_entity));
         if(!ZlimdbConnection::copyString(botEngineName, botType->entity, botType->name_size, ZLIMDB_MAX_ENTITY_SIZE))
@@ -210,8 +315,9 @@ bool_t Main::connect()
         botTypes.append(*it, &*i);
       }
     }
-    for(HashMap<String, uint64_t>::Iterator i = knownBotEngines.begin(), end = knownBotEngines.end(); i != end; ++i)
-      connection.remove(botEnginesTableId, *i);
+    if(shard == 0)
+      for(HashMap<String, uint64_t>::Iterator i = knownBotEngines.begin(), end = knownBotEngines.end(); i != end; ++i)
+        connection.remove(botEnginesTableId, *i);
   }
 
   // get processes
@@ -240,6 +346,8 @@ bool_t Main::connect()
   if(!connection.subscribe(zlimdb_table_tables, zlimdb_subscribe_flag_none))
     return error = connection.getErrorString(), false;
   {
+    // only sort the tables into the catalog while the list is received, the brokers and sessions are loaded afterwards
+    loadingTables = true;
     String tableName;
     while(connection.getResponse(buffer))
     {
@@ -252,10 +360,25 @@ bool_t Main::connect()
         addedTable((uint32_t)entity->entity.id, tableName);
       }
     }
+    loadingTables = false;
     if(connection.getErrno() != 0)
       return error = connection.getErrorString(), false;
   }
 
+  // load brokers and sessions
+  for(HashMap<String, User*>::Iterator i = users.begin(), end = users.end(); i != end; ++i)
+  {
+    User* user = *i;
+    const HashMap<uint64_t, Broker*>& brokers = user->getBrokers();
+    for(HashMap<uint64_t, Broker*>::Iterator i = brokers.begin(), end = brokers.end(); i != end; ++i)
+      if((*i)->getBrokerTableId() != 0 && !loadBroker(**i))
+        return error = connection.getErrorString(), false;
+    const HashMap<uint64_t, Session*>& sessions = user->getSessions();
+    for(HashMap<uint64_t, Session*>::Iterator i = sessions.begin(), end = sessions.end(); i != end; ++i)
+      if((*i)->getSessionTableId() != 0 && !loadSession(**i))
+        return error = connection.getErrorString(), false;
+  }
+
   // create offline responders for sessions
   for(HashMap<String, User*>::Iterator i = users.begin(), end = users.end(); i != end; ++i)
   {
@@ -349,153 +472,24 @@ void_t Main::controlEntity(uint32_t tableId, uint32_t requestId, uint64_t entity
 
 void_t Main::addedTable(uint32_t tableId, const String& tableName)
 {
-  if(tableName.startsWith("users/"))
+  // split "users/<name>/{brokers,sessions}/<id>/<table>" or "users/<name>/user"
+  if(!tableName.startsWith("users/"))
+    return;
+  const char_t* userNameStart = (const char_t*)tableName + 6;
+  const char_t* userNameEnd = String::find(userNameStart, '/');
+  if(!userNameEnd)
+    return;
+  if(!isLocalUser(userNameStart, userNameEnd - userNameStart))
+    return;
+  String userName = tableName.substr(6, userNameEnd - userNameStart);
+  User * user = findUser(userName);
+  if(!user)
+    user = createUser(userName);
+  const char_t* typeNameStart = userNameEnd + 1;
+  const char_t* typeNameEnd = String::find(typeNameStart, '/');
+  if(!typeNameEnd)
   {
-    const char_t* start = (const char_t*)tableName + 6;
-    const char_t* end = String::find(start, '/');
-    if(!end)
-      return;
-    String userName = tableName.substr(6, end - start);
-    User * user = findUser(userName);
-    if(!user)
-      user = createUser(userName);
-    const char_t* typeNameStart = end + 1;
-
-    if(String::startsWith(typeNameStart, "brokers/"))
-    {
-      uint64_t brokerId = String::toUInt64(typeNameStart + 8);
-      Broker* broker = user->findBroker(brokerId);
-      if(!broker)
-        broker = user->createBroker(brokerId);
-
-      if(tableName.endsWith("/balance"))
-        broker->setBalanceTableId(tableId);
-      else if(tableName.endsWith("/orders"))
-        broker->setOrdersTableId(tableId);
-      else if(tableName.endsWith("/transactions"))
-        broker->setTransactionsTableId(tableId);
-      else if(tableName.endsWith("/log"))
-        broker->setLogTableId(tableId);
-      else if(tableName.endsWith("/broker"))
-      {
-        broker->setBrokerTableId(tableId);
-
-        // get broker
-        if(!connection.query(tableId))
-          return;
-        TableInfo tableInfoData = {Main::userBroker};
-        TableInfo& tableInfo = this->tableInfo.append(tableId, tableInfoData);
-        tableInfo.object = broker;
-        byte_t buffer[ZLIMDB_MAX_MESSAGE_SIZE];
-        while(connection.getResponse(buffer))
-        {
-          for(const meguco_user_broker_entity* entity = (const meguco_user_broker_entity*)zlimdb_get_first_entity((const zlimdb_header*)buffer, sizeof(meguco_user_broker_entity));
-              entity;
-              entity = (const meguco_user_broker_entity*)zlimdb_get_next_entity((const zlimdb_header*)buffer, sizeof(meguco_user_broker_entity), &entity->entity))
-          {
-            if(entity->entity.id != 1)
-              continue;
-            BrokerType* brokerType = *brokerTypes.find(entity->broker_type_id);
-            if(!brokerType)
-              continue;
-
-            broker->setEntity(*entity);
-
-            // update user broker state
-            String command = brokerType->executable + " " + user->getName() + " " + String::fromUInt64(brokerId);
-            broker->setCommand(command);
-            HashMap<String, Process*>::Iterator it = processesByCommand.find(command);
-            meguco_user_broker_state state = meguco_user_broker_stopped;
-            if(it != processesByCommand.end() && (*it)->type == Main::userBroker)
-              state = meguco_user_broker_running;
-            if (state != broker->getState())
-            {
-              broker->setState(state);
-              connection.update(tableId, broker->getEntity());
-            }
-
-            // start broker process
-            if(state != meguco_user_broker_running)
-            {
-              // start process
-              if(!connection.startProcess(processesTableId, broker->getCommand()))
-                return;
-
-              // set state to starting
-              broker->setState(meguco_user_broker_starting);
-              if(!connection.update(tableId, broker->getEntity()))
-                return;
-            }
-          }
-        }
-        if(connection.getErrno() != 0)
-          return;
-      }
-    }
-
-    else if(String::startsWith(typeNameStart, "sessions/"))
-    {
-      uint64_t sessionId = String::toUInt64(typeNameStart + 9);
-      Session* session = user->findSession(sessionId);
-      if(!session)
-        session = user->createSession(sessionId);
-
-      if(tableName.endsWith("/orders"))
-        session->setOrdersTableId(tableId);
-      else if(tableName.endsWith("/transactions"))
-        session->setTransactionsTableId(tableId);
-      else if(tableName.endsWith("/assets"))
-        session->setAssetsTableId(tableId);
-      else if(tableName.endsWith("/log"))
-        session->setLogTableId(tableId);
-      else if(tableName.endsWith("/properties"))
-        session->setPropertiesTableId(tableId);
-      else if(tableName.endsWith("/markers"))
-        session->setMarkersTableId(tableId);
-      else if(tableName.endsWith("/session"))
-      {
-        session->setSessionTableId(tableId);
-
-        // get session
-        if(!connection.query(tableId))
-          return;
-        TableInfo tableInfoData = {Main::userSession};
-        TableInfo& tableInfo = this->tableInfo.append(tableId, tableInfoData);
-        tableInfo.object = session;
-        byte_t buffer[ZLIMDB_MAX_MESSAGE_SIZE];
-        while(connection.getResponse(buffer))
-        {
-          for(const meguco_user_session_entity* entity = (const meguco_user_session_entity*)zlimdb_get_first_entity((const zlimdb_header*)buffer, sizeof(meguco_user_session_entity));
-              entity;
-              entity = (const meguco_user_session_entity*)zlimdb_get_next_entity((const zlimdb_header*)buffer, sizeof(meguco_user_session_entity), &entity->entity))
-          {
-            if(entity->entity.id != 1)
-              continue;
-            BotType* botType = *botTypes.find(entity->bot_type_id);
-            if(!botType)
-              continue;
-
-            session->setEntity(*entity);
-
-            // update user session state
-            String command = botType->executable + " " + user->getName() + " " + String::fromUInt64(sessionId);
-            session->setCommand(command);
-            HashMap<String, Process*>::Iterator it = processesByCommand.find(command);
-            meguco_user_session_state state = meguco_user_session_stopped;
-            if(it != processesByCommand.end() && (*it)->type == Main::userSession)
-              state = meguco_user_session_running;
-            if(state != session->getState())
-            {
-              session->setState(state);
-              connection.update(tableId, session->getEntity());
-            }
-          }
-        }
-        if(connection.getErrno() != 0)
-          return;
-      }
-    }
-    else if(tableName.endsWith("/user"))
+    if(tableName.endsWith("/user"))
     {
       if(!connection.listen(tableId))
         return;
@@ -503,7 +497,160 @@ void_t Main::addedTable(uint32_t tableId, const String& tableName)
       TableInfo& tableInfo = this->tableInfo.append(tableId, tableInfoData);
       tableInfo.object = user;
     }
+    return;
+  }
+  const char_t* idEnd = String::find(typeNameEnd + 1, '/');
+  if(!idEnd)
+    return;
+  uint64_t id = String::toUInt64(typeNameEnd + 1);
+  String typeName = tableName.substr(typeNameStart - (const char_t*)tableName, typeNameEnd - typeNameStart);
+  String leafName = tableName.substr(idEnd + 1 - (const char_t*)tableName);
+
+  if(typeName == "brokers")
+  {
+    HashMap<String, CatalogTable>::Iterator it = brokerTables.find(leafName);
+    if(it == brokerTables.end())
+      return;
+    Broker* broker = user->findBroker(id);
+    if(!broker)
+      broker = user->createBroker(id);
+    switch(*it)
+    {
+    case brokerBalanceTable:
+      broker->setBalanceTableId(tableId);
+      break;
+    case brokerOrdersTable:
+      broker->setOrdersTableId(tableId);
+      break;
+    case brokerTransactionsTable:
+      broker->setTransactionsTableId(tableId);
+      break;
+    case brokerLogTable:
+      broker->setLogTableId(tableId);
+      break;
+    default:
+      broker->setBrokerTableId(tableId);
+      if(!loadingTables)
+        loadBroker(*broker);
+      break;
+    }
+  }
+  else if(typeName == "sessions")
+  {
+    HashMap<String, CatalogTable>::Iterator it = sessionTables.find(leafName);
+    if(it == sessionTables.end())
+      return;
+    Session* session = user->findSession(id);
+    if(!session)
+      session = user->createSession(id);
+    switch(*it)
+    {
+    case sessionOrdersTable:
+      session->setOrdersTableId(tableId);
+      break;
+    case sessionTransactionsTable:
+      session->setTransactionsTableId(tableId);
+      break;
+    case sessionAssetsTable:
+      session->setAssetsTableId(tableId);
+      break;
+    case sessionLogTable:
+      session->setLogTableId(tableId);
+      break;
+    case sessionPropertiesTable:
+      session->setPropertiesTableId(tableId);
+      break;
+    case sessionMarkersTable:
+      session->setMarkersTableId(tableId);
+      break;
+    default:
+      session->setSessionTableId(tableId);
+      if(!loadingTables)
+        loadSession(*session);
+      break;
+    }
+  }
+}
+
+bool_t Main::loadBroker(Broker& broker)
+{
+  uint32_t tableId = broker.getBrokerTableId();
+  TableInfo tableInfoData = {Main::userBroker};
+  TableInfo& tableInfo = this->tableInfo.append(tableId, tableInfoData);
+  tableInfo.object = &broker;
+
+  // get broker
+  byte_t buffer[ZLIMDB_MAX_ENTITY_SIZE];
+  const meguco_user_broker_entity* entity = (const meguco_user_broker_entity*)buffer;
+  if(!connection.queryEntity(tableId, 1, *(zlimdb_entity*)buffer, sizeof(meguco_user_broker_entity), ZLIMDB_MAX_ENTITY_SIZE))
+    return connection.getErrno() == zlimdb_error_entity_not_found;
+  BrokerType* brokerType = *brokerTypes.find(entity->broker_type_id);
+  if(!brokerType)
+    return true;
+
+  broker.setEntity(*entity);
+
+  // update user broker state
+  User& user = broker.getUser();
+  String command = brokerType->executable + " " + user.getName() + " " + String::fromUInt64(broker.getBrokerId());
+  broker.setCommand(command);
+  HashMap<String, Process*>::Iterator it = processesByCommand.find(command);
+  meguco_user_broker_state state = meguco_user_broker_stopped;
+  if(it != processesByCommand.end() && (*it)->type == Main::userBroker)
+    state = meguco_user_broker_running;
+  if (state != broker.getState())
+  {
+    broker.setState(state);
+    connection.update(tableId, broker.getEntity());
   }
+
+  // start broker process
+  if(state != meguco_user_broker_running)
+  {
+    // start process
+    if(!connection.startProcess(processesTableId, broker.getCommand()))
+      return false;
+
+    // set state to starting
+    broker.setState(meguco_user_broker_starting);
+    if(!connection.update(tableId, broker.getEntity()))
+      return false;
+  }
+  return true;
+}
+
+bool_t Main::loadSession(Session& session)
+{
+  uint32_t tableId = session.getSessionTableId();
+  TableInfo tableInfoData = {Main::userSession};
+  TableInfo& tableInfo = this->tableInfo.append(tableId, tableInfoData);
+  tableInfo.object = &session;
+
+  // get session
+  byte_t buffer[ZLIMDB_MAX_ENTITY_SIZE];
+  const meguco_user_session_entity* entity = (const meguco_user_session_entity*)buffer;
+  if(!connection.queryEntity(tableId, 1, *(zlimdb_entity*)buffer, sizeof(meguco_user_session_entity), ZLIMDB_MAX_ENTITY_SIZE))
+    return connection.getErrno() == zlimdb_error_entity_not_found;
+  BotType* botType = *botTypes.find(entity->bot_type_id);
+  if(!botType)
+    return true;
+
+  session.setEntity(*entity);
+
+  // update user session state
+  User& user = session.getUser();
+  String command = botType->executable + " " + user.getName() + " " + String::fromUInt64(session.getSessionId());
+  session.setCommand(command);
+  HashMap<String, Process*>::Iterator it = processesByCommand.find(session.getCommand());
+  meguco_user_session_state state = meguco_user_session_stopped;
+  if(it != processesByCommand.end() && (*it)->type == Main::userSession)
+    state = meguco_user_session_running;
+  if(state != session.getState())
+  {
+    session.setState(state);
+    connection.update(tableId, session.getEntity());
+  }
+  return true;
 }
 
 void_t Main::addedProcess(uint64_t entityId, const String& command)
@@ -513,6 +660,8 @@ void_t Main::addedProcess(uint64_t entityId, const String& command)
     size_t pos = 0;
     command.token(' ', pos);
     String userName = command.token(' ', pos);
+    if(!isLocalUser(userName, userName.length()))
+      return;
     uint64_t brokerId = command.token(' ', pos).toUInt64();
 
     Process processData = {userBroker, command, entityId};
@@ -533,24 +682,42 @@ void_t Main::addedProcess(uint64_t entityId, const String& command)
   }
   if(command.startsWith("Bots/"))
   {
+    // a bot process runs one session or several simulation sessions of the same user
     size_t pos = 0;
-    command.token(' ', pos);
-    String userName = command.token(' ', pos);
-    uint64_t sessionId = command.token(' ', pos).toUInt64();
+    String executable = command.token(' ', pos);
+    String userName;
+    List<uint64_t> sessionIds;
+    while(pos < command.length())
+    {
+      String arg = command.token(' ', pos);
+      if(arg.isEmpty() || arg.startsWith("-"))
+        continue;
+      userName = arg;
+      sessionIds.append(command.token(' ', pos).toUInt64());
+    }
+    if(sessionIds.isEmpty() || !isLocalUser(userName, userName.length()))
+      return;
+    const char_t* modeArg = command.endsWith(" --simulation") ? " --simulation" : "";
 
     Process processData = {userSession, command, entityId};
     Process& process = processes.append(entityId, processData);
-    processesByCommand.append(command, &process);
+    process.userName = userName;
     User * user = findUser(userName);
-    if(user)
+    for(List<uint64_t>::Iterator i = sessionIds.begin(), end = sessionIds.end(); i != end; ++i)
     {
-      Session* session = user->findSession(sessionId);
-      if(session && session->hasEntity())
+      String sessionCommand = executable + " " + userName + " " + String::fromUInt64(*i) + modeArg;
+      process.sessionIds.append(*i);
+      process.sessionCommands.append(sessionCommand);
+      processesByCommand.append(sessionCommand, &process);
+      if(user)
       {
-        process.object = session;
-        session->setState(meguco_user_session_running);
-        if(!connection.update(session->getSessionTableId(), session->getEntity()))
-          return;
+        Session* session = user->findSession(*i);
+        if(session && session->hasEntity())
+        {
+          session->setState(meguco_user_session_running);
+          if(!connection.update(session->getSessionTableId(), session->getEntity()))
+            return;
+        }
       }
     }
   }
@@ -576,34 +743,15 @@ void_t Main::removedProcess(uint64_t entityId)
       break;
     case userSession:
       {
-        Session* session = (Session*)process.object;
-        if(session && session->getState() != meguco_user_session_stopped)
+        User* user = findUser(process.userName);
+        for(List<uint64_t>::Iterator i = process.sessionIds.begin(), end = process.sessionIds.end(); i != end; ++i)
         {
-          session->setState(meguco_user_session_stopped);
-          meguco_user_session_mode stoppedMode = session->getMode();
-          session->setMode(meguco_user_session_none);
-          connection.update(session->getSessionTableId(), session->getEntity());
-
-          if(stoppedMode == meguco_user_session_simulation)
-          {
-            const String& userName = session->getUser().getName();
-            String sessionIdStr = String::fromUInt64(session->getSessionId());
-
-            String tablePrefix = String("users/") + userName + "/sessions/" + sessionIdStr;
-            connection.moveTable(tablePrefix + "/transactions.backup", session->getTransactionsTableId(), true);
-            connection.moveTable(tablePrefix + "/assets.backup", session->getAssetsTableId(), true);
-            connection.moveTable(tablePrefix + "/orders.backup", session->getOrdersTableId(), true);
-            connection.moveTable(tablePrefix + "/log.backup", session->getLogTableId(), true);
-            connection.moveTable(tablePrefix + "/markers.backup", session->getMarkersTableId(), true);
-            connection.moveTable(tablePrefix + "/properties.backup", session->getPropertiesTableId(), true);
-          }
-
-          // create offline responder
-          connection.subscribe(session->getSessionTableId(), zlimdb_query_type_since_next, 0, zlimdb_subscribe_flag_responder);
-          TableInfo tableInfoData = {Main::userSession};
-          TableInfo& tableInfo = this->tableInfo.append(session->getSessionTableId(), tableInfoData);
-          tableInfo.object = session;
+          Session* session = user ? user->findSession(*i) : 0;
+          if(session && session->getState() != meguco_user_session_stopped)
+            setSessionStopped(*session);
         }
+        for(List<String>::Iterator i = process.sessionCommands.begin(), end = process.sessionCommands.end(); i != end; ++i)
+          processesByCommand.remove(*i);
       }
       break;
     default:
@@ -614,6 +762,66 @@ void_t Main::removedProcess(uint64_t entityId)
   }
 }
 
+void_t Main::setSessionStopped(Session& session)
+{
+  session.setState(meguco_user_session_stopped);
+  meguco_user_session_mode stoppedMode = session.getMode();
+  session.setMode(meguco_user_session_none);
+  connection.update(session.getSessionTableId(), session.getEntity());
+
+  if(stoppedMode == meguco_user_session_simulation)
+  {
+    const String& userName = session.getUser().getName();
+    String sessionIdStr = String::fromUInt64(session.getSessionId());
+
+    String tablePrefix = String("users/") + userName + "/sessions/" + sessionIdStr;
+    connection.moveTable(tablePrefix + "/transactions.backup", session.getTransactionsTableId(), true);
+    connection.moveTable(tablePrefix + "/assets.backup", session.getAssetsTableId(), true);
+    connection.moveTable(tablePrefix + "/orders.backup", session.getOrdersTableId(), true);
+    connection.moveTable(tablePrefix + "/log.backup", session.getLogTableId(), true);
+    connection.moveTable(tablePrefix + "/markers.backup", session.getMarkersTableId(), true);
+    connection.moveTable(tablePrefix + "/properties.backup", session.getPropertiesTableId(), true);
+  }
+
+  // create offline responder
+  connection.subscribe(session.getSessionTableId(), zlimdb_query_type_since_next, 0, zlimdb_subscribe_flag_responder);
+  TableInfo tableInfoData = {Main::userSession};
+  TableInfo& tableInfo = this->tableInfo.append(session.getSessionTableId(), tableInfoData);
+  tableInfo.object = &session;
+}
+
+bool_t Main::prepareSessionStart(Session& session, meguco_user_session_mode mode)
+{
+  // remove offline responder
+  if(!connection.unsubscribe(session.getSessionTableId()))
+    return false;
+  tableInfo.remove(session.getSessionTableId());
+
+  // prepare tables
+  if(mode != meguco_user_session_live)
+  { // create table backups
+    String tablePrefix = String("users/") + session.getUser().getName() + "/sessions/" + String::fromUInt64(session.getSessionId());
+    uint32_t newTableId;
+    if(!connection.copyTable(session.getOrdersTableId(), tablePrefix + "/orders.backup", newTableId) ||
+       !connection.copyTable(session.getTransactionsTableId(), tablePrefix + "/transactions.backup", newTableId) ||
+       !connection.copyTable(session.getAssetsTableId(), tablePrefix + "/assets.backup", newTableId) ||
+       !connection.copyTable(session.getLogTableId(), tablePrefix + "/log.backup", newTableId) ||
+       !connection.copyTable(session.getPropertiesTableId(), tablePrefix + "/properties.backup", newTableId) ||
+       !connection.copyTable(session.getMarkersTableId(), tablePrefix + "/markers.backup", newTableId))
+      return false;
+  }
+
+  // update mode (it is stored along with the starting state)
+  session.setMode(mode);
+  return true;
+}
+
+bool_t Main::setSessionStarting(Session& session)
+{
+  session.setState(meguco_user_session_starting);
+  return connection.update(session.getSessionTableId(), session.getEntity());
+}
+
 void_t Main::controlUser(User & user, uint32_t requestId, uint64_t entityId, uint32_t controlCode, const byte_t* data, size_t size)
 {
   switch(controlCode)
@@ -841,40 +1049,15 @@ void_t Main::controlUser(User & user, uint32_t requestId, uint64_t entityId, uin
       // start session?
       if(session->getState() == meguco_user_session_stopped)
       {
-        // update mode
-        if(session->getMode() != mode)
-        {
-          session->setMode(mode);
-          if(!connection.update(session->getSessionTableId(), session->getEntity()))
-            return (void_t)connection.sendControlResponse(requestId, (uint16_t)connection.getErrno());
-        }
-
-        // remove offline responder
-        if(!connection.unsubscribe(session->getSessionTableId()))
-            return (void_t)connection.sendControlResponse(requestId, (uint16_t)connection.getErrno());
-        tableInfo.remove(session->getSessionTableId());
-
-        // prepare tables
-        String tablePrefix = String("users/") + session->getUser().getName() + "/sessions/" + String::fromUInt64(session->getSessionId());
-        if(session->getMode() != meguco_user_session_live)
-        { // create table backups
-          uint32_t newTableId;
-          if(!connection.copyTable(session->getOrdersTableId(), tablePrefix + "/orders.backup", newTableId) ||
-             !connection.copyTable(session->getTransactionsTableId(), tablePrefix + "/transactions.backup", newTableId) ||
-             !connection.copyTable(session->getAssetsTableId(), tablePrefix + "/assets.backup", newTableId) ||
-             !connection.copyTable(session->getLogTableId(), tablePrefix + "/log.backup", newTableId) ||
-             !connection.copyTable(session->getPropertiesTableId(), tablePrefix + "/properties.backup", newTableId) ||
-             !connection.copyTable(session->getMarkersTableId(), tablePrefix + "/markers.backup", newTableId))
-            return (void_t)connection.sendControlResponse(requestId, (uint16_t)connection.getErrno());
-        }
+        if(!prepareSessionStart(*session, mode))
+          return (void_t)connection.sendControlResponse(requestId, (uint16_t)connection.getErrno());
 
         // start process
         if(!connection.startProcess(processesTableId, session->getCommand()))
           return (void_t)connection.sendControlResponse(requestId, (uint16_t)connection.getErrno());
 
         // set state to starting
-        session->setState(meguco_user_session_starting);
-        if(!connection.update(session->getSessionTableId(), session->getEntity()))
+        if(!setSessionStarting(*session))
           return (void_t)connection.sendControlResponse(requestId, (uint16_t)connection.getErrno());
       }
 
@@ -910,11 +1093,149 @@ void_t Main::controlUser(User & user, uint32_t requestId, uint64_t entityId, uin
       return (void_t)connection.sendControlResponse(requestId, 0, 0);
     }
 
+  case meguco_user_control_start_sessions:
+    return startSessions(user, requestId, data, size);
+
+  case meguco_user_control_stop_sessions:
+    return stopSessions(user, requestId, data, size);
+
   default:
     return (void_t)connection.sendControlResponse(requestId, zlimdb_error_invalid_request);
   }
 }
 
+void_t Main::startSessions(User& user, uint32_t requestId, const byte_t* data, size_t size)
+{
+  // get args
+  if(size < sizeof(meguco_user_sessions_control))
+    return (void_t)connection.sendControlResponse(requestId, zlimdb_error_invalid_request);
+  const meguco_user_sessions_control* args = (const meguco_user_sessions_control*)data;
+  if(size < sizeof(meguco_user_sessions_control) + args->count * sizeof(uint64_t))
+    return (void_t)connection.sendControlResponse(requestId, zlimdb_error_invalid_request);
+  const uint64_t* sessionIds = (const uint64_t*)(args + 1);
+  meguco_user_session_mode mode = (meguco_user_session_mode)args->mode;
+  bool_t sharedProcess = mode == meguco_user_session_simulation && (args->flags & meguco_user_sessions_flag_shared_process);
+
+  // prepare the tables of all sessions and start the processes of sessions that run on their own
+  Buffer response;
+  response.resize(args->count * sizeof(uint16_t));
+  uint16_t* results = (uint16_t*)(byte_t*)response;
+  HashMap<String, List<size_t> > sessionsByExecutable;
+  for(size_t i = 0; i < args->count; ++i)
+  {
+    results[i] = 0;
+    Session* session = user.findSession(sessionIds[i]);
+    if(!session)
+    {
+      results[i] = zlimdb_error_entity_not_found;
+      continue;
+    }
+    if(session->getState() != meguco_user_session_stopped)
+      continue;
+    if(!prepareSessionStart(*session, mode))
+    {
+      results[i] = (uint16_t)connection.getErrno();
+      continue;
+    }
+    if(sharedProcess)
+    {
+      size_t pos = 0;
+      String executable = session->getCommand().token(' ', pos);
+      HashMap<String, List<size_t> >::Iterator it = sessionsByExecutable.find(executable);
+      List<size_t>& sessions = it == sessionsByExecutable.end() ? sessionsByExecutable.append(executable, List<size_t>()) : *it;
+      sessions.append(i);
+      continue;
+    }
+    if(!connection.startProcess(processesTableId, session->getCommand()) || !setSessionStarting(*session))
+      results[i] = (uint16_t)connection.getErrno();
+  }
+
+  // start the shared processes with up to maxSessionsPerProcess sessions each
+  static const size_t maxSessionsPerProcess = 32;
+  static const size_t sessionsPerThread = 8;
+  for(HashMap<String, List<size_t> >::Iterator i = sessionsByExecutable.begin(), end = sessionsByExecutable.end(); i != end; ++i)
+  {
+    const List<size_t>& sessions = *i;
+    for(List<size_t>::Iterator j = sessions.begin(), end = sessions.end(); j != end;)
+    {
+      List<size_t>::Iterator processStart = j;
+      size_t count = 0;
+      String sessionArgs;
+      for(; j != end && count < maxSessionsPerProcess; ++j, ++count)
+      {
+        sessionArgs.append(' ');
+        sessionArgs.append(user.getName());
+        sessionArgs.append(' ');
+        sessionArgs.append(String::fromUInt64(sessionIds[*j]));
+      }
+      String command = i.key() + " --threads=" + String::fromUInt64((count + sessionsPerThread - 1) / sessionsPerThread) + sessionArgs + " --simulation";
+      bool_t started = connection.startProcess(processesTableId, command);
+      uint16_t startError = started ? 0 : (uint16_t)connection.getErrno();
+      for(List<size_t>::Iterator k = processStart; k != j; ++k)
+      {
+        if(started && !setSessionStarting(*user.findSession(sessionIds[*k])))
+          results[*k] = (uint16_t)connection.getErrno();
+        else
+          results[*k] = startError;
+      }
+    }
+  }
+
+  // send answer
+  return (void_t)connection.sendControlResponse(requestId, response, response.size());
+}
+
+void_t Main::stopSessions(User& user, uint32_t requestId, const byte_t* data, size_t size)
+{
+  // get args
+  if(size < sizeof(meguco_user_sessions_control))
+    return (void_t)connection.sendControlResponse(requestId, zlimdb_error_invalid_request);
+  const meguco_user_sessions_control* args = (const meguco_user_sessions_control*)data;
+  if(size < sizeof(meguco_user_sessions_control) + args->count * sizeof(uint64_t))
+    return (void_t)connection.sendControlResponse(requestId, zlimdb_error_invalid_request);
+  const uint64_t* sessionIds = (const uint64_t*)(args + 1);
+
+  // stop every process once, even when it runs several of the sessions
+  Buffer response;
+  response.resize(args->count * sizeof(uint16_t));
+  uint16_t* results = (uint16_t*)(byte_t*)response;
+  HashSet<uint64_t> stoppedProcesses;
+  for(size_t i = 0; i < args->count; ++i)
+  {
+    results[i] = 0;
+    Session* session = user.findSession(sessionIds[i]);
+    if(!session)
+    {
+      results[i] = zlimdb_error_entity_not_found;
+      continue;
+    }
+    if(session->getState() == meguco_user_session_stopped)
+      continue;
+    HashMap<String, Process*>::Iterator it = processesByCommand.find(session->getCommand());
+    if(it != processesByCommand.end())
+    {
+      Process* process = *it;
+      if(!stoppedProcesses.contains(process->entityId))
+      {
+        if(!connection.stopProcess(processesTableId, process->entityId))
+        {
+          results[i] = (uint16_t)connection.getErrno();
+          continue;
+        }
+        stoppedProcesses.append(process->entityId);
+      }
+    }
+
+    // set state to stopping
+    session->setState(meguco_user_session_stopping);
+    if(!connection.update(session->getSessionTableId(), session->getEntity()))
+      results[i] = (uint16_t)connection.getErrno();
+  }
+
+  // send answer
+  return (void_t)connection.sendControlResponse(requestId, response, response.size());
+}
+
 void_t Main::controlUserSession(Session& session, uint32_t requestId, uint64_t entityId, uint32_t controlCode, const byte_t* data, size_t size)
 {
   switch(controlCode)
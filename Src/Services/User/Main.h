@@ -2,20 +2,40 @@
 #pragma once
 
 #include <nstd/HashMap.h>
+#include <nstd/List.h>
+#include <nstd/Thread.h>
 
 #include <megucoprotocol.h>
 
 #include "Tools/ZlimdbConnection.h"
+#include "Tools/Protocol.h"
 
 class User;
+class Broker;
 class Session;
 
+/**
+* Serves the users of one shard of the user service. A user belongs to the shard given by the hash of its name,
+* so each shard has its own zlimdb connection and handles the control requests and processes of its users only.
+* The shared "processes" and tables tables are subscribed by every shard and filtered by user name.
+*/
 class Main : public ZlimdbConnection::Callback
 {
 public:
+  /**
+  * @param shard The index of the shard.
+  * @param shards The amount of shards. Shard 0 also maintains the broker and bot type tables.
+  */
+  Main(uint_t shard = 0, uint_t shards = 1);
   ~Main();
 
   const String& getErrorString() const {return error;}
+  uint_t getShard() const {return shard;}
+
+  /**
+  * Runs the connection loop of the shard in a worker thread.
+  */
+  bool_t start();
 
   void_t addBrokerType(const String& name, const String& executable);
   void_t addBotType(const String& name, const String& executable);
@@ -50,6 +70,9 @@ private:
     String command;
     uint64_t entityId;
     void_t* object;
+    String userName;
+    List<uint64_t> sessionIds; // the sessions of a bot process
+    List<String> sessionCommands; // the command of each session as if it was run by a process of its own
   };
 
   struct TableInfo
@@ -58,7 +81,26 @@ private:
     void_t* object;
   };
 
+  enum CatalogTable
+  {
+    brokerTable,
+    brokerBalanceTable,
+    brokerOrdersTable,
+    brokerTransactionsTable,
+    brokerLogTable,
+    sessionTable,
+    sessionOrdersTable,
+    sessionTransactionsTable,
+    sessionAssetsTable,
+    sessionLogTable,
+    sessionPropertiesTable,
+    sessionMarkersTable,
+  };
+
 private:
+  uint_t shard;
+  uint_t shards;
+  Thread thread;
   ZlimdbConnection connection;
   String error;
   HashMap<String, BrokerType> brokerTypesByName;
@@ -70,16 +112,31 @@ private:
   HashMap<uint64_t, Process> processes;
   HashMap<String, Process*> processesByCommand;
   HashMap<uint32_t, TableInfo> tableInfo; // todo: remove this
+  HashMap<String, CatalogTable> brokerTables;
+  HashMap<String, CatalogTable> sessionTables;
+  bool_t loadingTables;
 
 private:
+  static uint_t proc(void_t* param) {return ((Main*)param)->proc();}
+  uint_t proc();
+
+  bool_t isLocalUser(const char_t* name, size_t length) const;
   User * findUser(const String& name) {return *users.find(name);}
   User * createUser(const String& name);
 
   void_t addedTable(uint32_t tableId, const String& tableName);
+  bool_t loadBroker(Broker& broker);
+  bool_t loadSession(Session& session);
   void_t addedProcess(uint64_t entityId, const String& command);
   void_t removedProcess(uint64_t entityId);
 
+  void_t setSessionStopped(Session& session);
+  bool_t prepareSessionStart(Session& session, meguco_user_session_mode mode);
+  bool_t setSessionStarting(Session& session);
+
   void_t controlUser(User& user, uint32_t requestId, uint64_t entityId, uint32_t controlCode, const byte_t* data, size_t size);
+  void_t startSessions(User& user, uint32_t requestId, const byte_t* data, size_t size);
+  void_t stopSessions(User& user, uint32_t requestId, const byte_t* data, size_t size);
   void_t controlUserSession(Session& session, uint32_t requestId, uint64_t entityId, uint32_t controlCode, const byte_t* data, size_t size);
 
 private: // ZlimdbConnection::Callback
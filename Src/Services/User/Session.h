@@ -42,7 +42,10 @@ public:
   void_t setEntity(const meguco_user_session_entity& entity) {sessionEntity.assign((const byte_t*)&entity, entity.entity.size);}
   const zlimdb_entity& getEntity() const {return ((const meguco_user_session_entity*)(const byte_t*)sessionEntity)->entity;}
 
-  const String& getCommand() const {return command;}
+  /**
+  * @return The command line of the bot process. Simulations are marked so that the server schedules them with a low priority.
+  */
+  String getCommand() const {return getMode() == meguco_user_session_simulation ? command + " --simulation" : command;}
   void_t setCommand(const String& command) {this->command = command;}
 
 private:
@@ -23,6 +23,7 @@ public:
   Broker* findBroker(uint64_t brokerId) {return *brokers.find(brokerId);}
   Broker* createBroker(uint64_t brokerId);
   void_t deleteBroker(Broker& market);
+  const HashMap<uint64_t, Broker*>& getBrokers() const {return brokers;}
 
   Session* findSession(uint64_t sessionId) {return *sessions.find(sessionId);}
   Session* createSession(uint64_t sessionId);
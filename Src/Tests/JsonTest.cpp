@@ -0,0 +1,187 @@
+
+#include <nstd/String.h>
+#include <nstd/Variant.h>
+
+#include <cstdlib>
+
+#include "Tools/Json.h"
+
+#include "Test.h"
+
+static bool_t readString(const String& data, String& result)
+{
+  Json::Parser parser(data);
+  return parser.readString(result) && !parser.hasError();
+}
+
+static bool_t readDouble(const String& data, double& result)
+{
+  Json::Parser parser(data);
+  return parser.readDouble(result) && !parser.hasError();
+}
+
+static bool_t readInt64(const String& data, int64_t& result)
+{
+  Json::Parser parser(data);
+  return parser.readInt64(result) && !parser.hasError();
+}
+
+static bool_t readUInt64(const String& data, uint64_t& result)
+{
+  Json::Parser parser(data);
+  return parser.readUInt64(result) && !parser.hasError();
+}
+
+static bool_t parseArenaString(const String& data, String& result)
+{
+  Json::Arena arena;
+  const Json::Value* value;
+  if(!Json::parse((const tchar_t*)data, data.length(), arena, value) || value->getType() != Json::Value::stringType)
+    return false;
+  result = value->toString();
+  return true;
+}
+
+static void_t testEscapes()
+{
+  String data("\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\\u0041\\u00e9\\u20ac\"");
+  String expected("a\"b\\c/d\b\f\n\r\tA\xc3\xa9\xe2\x82\xac");
+  String result;
+  CHECK(readString(data, result) && result == expected);
+  CHECK(parseArenaString(data, result) && result == expected);
+  Variant variant;
+  CHECK(Json::parse(data, variant) && variant.toString() == expected);
+
+  // unknown escape sequences are kept as they are
+  CHECK(readString("\"\\q\"", result) && result == "\\q");
+
+  // unterminated strings and truncated escape sequences
+  CHECK(!readString("\"abc", result));
+  CHECK(!readString("\"abc\\", result));
+  CHECK(!readString("\"\\u12\"", result));
+  CHECK(!readString("\"\\u12g4\"", result));
+}
+
+static void_t testSurrogates()
+{
+  String result;
+  CHECK(readString("\"\\ud83d\\ude00\"", result) && result == "\xf0\x9f\x98\x80");
+  CHECK(readString("\"x\\uD834\\uDD1Ey\"", result) && result == "x\xf0\x9d\x84\x9ey");
+  CHECK(parseArenaString("\"\\ud83d\\ude00\"", result) && result == "\xf0\x9f\x98\x80");
+
+  // a high surrogate that is not followed by a low surrogate is decoded on its own
+  CHECK(readString("\"\\ud83d\"", result) && result == "\xed\xa0\xbd");
+  CHECK(readString("\"\\ud83dx\"", result) && result == "\xed\xa0\xbdx");
+  CHECK(readString("\"\\ud83d\\u0041\"", result) && result == "\xed\xa0\xbd" "A");
+}
+
+static void_t testDoubles()
+{
+  // values around the limits of the exact conversion path and values that need the slow path
+  static const char_t* numbers[] = {
+    "0", "-0", "0.1", "-1.5", "1e22", "1e23", "1e-22", "1e-23", "9007199254740992", "9007199254740993",
+    "9007199254740992e22", "9007199254740993e-22", "4503599627370496.5", "1234567890123456789",
+    "12345678901234567890123456789", "0.000000000000000000000000000001", "2.2250738585072014e-308",
+    "4.9406564584124654e-324", "1.7976931348623157e308", "8.98846567431158e307", "123.456e-5",
+    "1E+2", "1e0", "6.02214076e23"
+  };
+  for(size_t i = 0; i < sizeof(numbers) / sizeof(*numbers); ++i)
+  {
+    double expected = strtod(numbers[i], 0);
+    double result;
+    CHECK(readDouble(numbers[i], result) && result == expected);
+    CHECK(readDouble(String("\"") + numbers[i] + "\"", result) && result == expected);
+    Json::Arena arena;
+    const Json::Value* value;
+    CHECK(Json::parse(numbers[i], String::length(numbers[i]), arena, value) && value->toDouble() == expected);
+  }
+
+  double result;
+  CHECK(!readDouble("-", result));
+  CHECK(!readDouble("1.", result));
+  CHECK(!readDouble("1e", result));
+  CHECK(!readDouble(".5", result));
+}
+
+static void_t testIntegers()
+{
+  int64_t int64;
+  CHECK(readInt64("9223372036854775807", int64) && int64 == 0x7fffffffffffffffLL);
+  CHECK(readInt64("-9223372036854775808", int64) && int64 == (int64_t)0x8000000000000000ULL);
+  CHECK(readInt64("-1.5", int64) && int64 == -1);
+  CHECK(readInt64("-0.5", int64) && int64 == 0);
+  CHECK(readInt64("2.5e3", int64) && int64 == 2500);
+
+  // out of range values are saturated
+  CHECK(readInt64("9223372036854775808", int64) && int64 == 0x7fffffffffffffffLL);
+  CHECK(readInt64("-9223372036854775809", int64) && int64 == (int64_t)0x8000000000000000ULL);
+  CHECK(readInt64("18446744073709551616", int64) && int64 == 0x7fffffffffffffffLL);
+  CHECK(readInt64("-1e30", int64) && int64 == (int64_t)0x8000000000000000ULL);
+
+  uint64_t uint64;
+  CHECK(readUInt64("18446744073709551615", uint64) && uint64 == 0xffffffffffffffffULL);
+  CHECK(readUInt64("1.9", uint64) && uint64 == 1);
+  CHECK(readUInt64("\"42\"", uint64) && uint64 == 42);
+  CHECK(!readUInt64("18446744073709551616", uint64));
+  CHECK(!readUInt64("1e20", uint64));
+
+  // a failed read fails all further reads
+  String data("[18446744073709551616, 1]");
+  Json::Parser parser(data);
+  CHECK(parser.beginArray() && parser.nextElement());
+  CHECK(!parser.readUInt64(uint64) && parser.hasError());
+  CHECK(!parser.nextElement());
+
+  Json::Arena arena;
+  const Json::Value* value;
+  CHECK(Json::parse("[-1.5, 18446744073709551615, -7]", 32, arena, value));
+  const Json::Value* element = value->getFirst();
+  CHECK(element->toInt64() == -1);
+  element = element->getNext();
+  CHECK(element->toUInt64() == 0xffffffffffffffffULL);
+  element = element->getNext();
+  CHECK(element->toInt64() == -7);
+}
+
+static void_t testStringLengths()
+{
+  // strings of every length around the 16 byte blocks of the vectorized scan with a quote or an escape
+  // sequence at every position
+  for(size_t length = 0; length < 50; ++length)
+    for(size_t position = 0; position <= length; ++position)
+    {
+      String expected, data("\"");
+      for(size_t i = 0; i < length; ++i)
+      {
+        tchar_t ch = (tchar_t)('a' + i % 26);
+        if(i == position)
+        {
+          expected.append(position % 2 ? '"' : '\\');
+          data.append(position % 2 ? "\\\"" : "\\\\");
+        }
+        else
+        {
+          expected.append(ch);
+          data.append(ch);
+        }
+      }
+      data.append("\"");
+
+      String result;
+      CHECK(readString(data, result) && result == expected);
+      CHECK(parseArenaString(data, result) && result == expected);
+
+      // without the closing quote
+      CHECK(!readString(data.substr(0, data.length() - 1), result));
+    }
+}
+
+int_t main(int_t argc, char_t* argv[])
+{
+  testEscapes();
+  testSurrogates();
+  testDoubles();
+  testIntegers();
+  testStringLengths();
+  return reportChecks();
+}
@@ -0,0 +1,100 @@
+
+#include <nstd/Array.h>
+
+#include "Tools/RateLimiter.h"
+
+#include "Test.h"
+
+static const int64_t window = 10 * 60 * 1000;
+
+/**
+* Creates a limiter with the configuration of the Bitstamp broker: 600 requests per 10 minutes, bursts of 8 requests
+* and a reserve of 2 tokens and 50 requests for each higher priority class.
+*/
+static RateLimiter createLimiter()
+{
+  return RateLimiter(8, 1000, 600, window, 2, 50);
+}
+
+static void_t testBurst()
+{
+  RateLimiter limiter = createLimiter();
+  int64_t now = 1, wait;
+
+  // each priority class leaves the reserve of the higher classes untouched
+  uint_t low = 0, normal = 0, high = 0;
+  while(limiter.tryAcquire(RateLimiter::lowPriority, now, wait))
+    ++low;
+  CHECK(wait > 0);
+  while(limiter.tryAcquire(RateLimiter::normalPriority, now, wait))
+    ++normal;
+  while(limiter.tryAcquire(RateLimiter::highPriority, now, wait))
+    ++high;
+  CHECK(low == 4);
+  CHECK(normal == 2);
+  CHECK(high == 2);
+  CHECK(wait == 1000);
+
+  // the bucket gains a token per second
+  now += 1000;
+  CHECK(limiter.tryAcquire(RateLimiter::highPriority, now, wait));
+  CHECK(!limiter.tryAcquire(RateLimiter::highPriority, now, wait));
+}
+
+static void_t testWindow()
+{
+  // low priority requests are made whenever they are allowed while a high priority request is made every 5 seconds
+  RateLimiter limiter = createLimiter();
+  Array<int64_t> lowTimes, allTimes;
+  int64_t wait, maxHighWait = 0;
+  for(int64_t now = 1; now < 3 * window; now += 100)
+  {
+    if(now % 5000 == 1)
+    {
+      if(limiter.tryAcquire(RateLimiter::highPriority, now, wait))
+        allTimes.append(now);
+      else if(wait > maxHighWait)
+        maxHighWait = wait;
+    }
+    while(limiter.tryAcquire(RateLimiter::lowPriority, now, wait))
+    {
+      lowTimes.append(now);
+      allTimes.append(now);
+    }
+    CHECK(wait > 0);
+  }
+
+  // the high priority requests never had to wait
+  CHECK(maxHighWait == 0);
+
+  // no sliding window contains more than 600 requests and the low priority requests leave a reserve of 100
+  // requests of the higher priority classes untouched
+  size_t maxAll = 0, maxLow = 0;
+  for(size_t i = 0, j = 0; i < allTimes.size(); ++i)
+  {
+    while(allTimes[j] <= allTimes[i] - window)
+      ++j;
+    if(i - j + 1 > maxAll)
+      maxAll = i - j + 1;
+  }
+  for(size_t i = 0, j = 0; i < lowTimes.size(); ++i)
+  {
+    while(lowTimes[j] <= lowTimes[i] - window)
+      ++j;
+    if(i - j + 1 > maxLow)
+      maxLow = i - j + 1;
+  }
+  CHECK(maxAll <= 600);
+  CHECK(maxLow <= 500);
+
+  // the low priority requests used their share of the budget
+  CHECK(maxAll >= 500);
+  CHECK(lowTimes.size() >= 3 * (500 - 120));
+}
+
+int_t main(int_t argc, char_t* argv[])
+{
+  testBurst();
+  testWindow();
+  return reportChecks();
+}
@@ -0,0 +1,99 @@
+
+#include <nstd/Console.h>
+#include <nstd/String.h>
+#include <nstd/Buffer.h>
+
+#include "Tools/Sha256.h"
+#include "Tools/Hex.h"
+
+#include "Test.h"
+
+static String repeat(byte_t value, size_t count)
+{
+  String result;
+  for(size_t i = 0; i < count; ++i)
+    result.append((tchar_t)value);
+  return result;
+}
+
+/**
+* Hashes a message in chunks of \c chunkSize bytes so that buffered and unbuffered blocks are mixed.
+*/
+static String hash(const String& message, size_t chunkSize)
+{
+  Sha256 sha256;
+  const byte_t* data = (const byte_t*)(const tchar_t*)message;
+  for(size_t pos = 0, size = message.length(); pos < size; pos += chunkSize)
+    sha256.update(data + pos, (unsigned int)(size - pos < chunkSize ? size - pos : chunkSize));
+  byte_t digest[Sha256::digestSize];
+  sha256.finalize(digest);
+  return Hex::toString(digest, sizeof(digest));
+}
+
+static String hmac(const String& key, const String& message)
+{
+  byte_t digest[Sha256::digestSize];
+  Sha256::hmac((const byte_t*)(const tchar_t*)key, key.length(), (const byte_t*)(const tchar_t*)message, message.length(), digest);
+  return Hex::toString(digest, sizeof(digest));
+}
+
+static void_t testHash()
+{
+  // FIPS 180-2 and a few messages that end at or around the padding boundaries
+  struct TestVector
+  {
+    String message;
+    const char_t* digest;
+  } vectors[] = {
+    {"", "E3B0C44298FC1C149AFBF4C8996FB92427AE41E4649B934CA495991B7852B855"},
+    {"abc", "BA7816BF8F01CFEA414140DE5DAE2223B00361A396177A9CB410FF61F20015AD"},
+    {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", "248D6A61D20638B8E5C026930C3E6039A33CE45964FF2167F6ECEDD419DB06C1"},
+    {"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", "CF5B16A778AF8380036CE59E7B0492370B249B11E8F07A51AFAC45037AFEE9D1"},
+    {repeat('a', 1000000), "CDC76E5C9914FB9281A1C7E284D73E67F1809A48A497200E046D39CCC7112CD0"},
+  };
+  static const size_t chunkSizes[] = {1, 3, 55, 56, 63, 64, 65, 1000, 1000000};
+  for(size_t i = 0; i < sizeof(vectors) / sizeof(*vectors); ++i)
+    for(size_t j = 0; j < sizeof(chunkSizes) / sizeof(*chunkSizes); ++j)
+      CHECK(hash(vectors[i].message, chunkSizes[j]) == vectors[i].digest);
+}
+
+static void_t testHmac()
+{
+  // RFC 4231 test cases 1 to 7
+  byte_t key4[25];
+  for(size_t i = 0; i < sizeof(key4); ++i)
+    key4[i] = (byte_t)(i + 1);
+  CHECK(hmac(repeat(0x0b, 20), "Hi There") == "B0344C61D8DB38535CA8AFCEAF0BF12B881DC200C9833DA726E9376C2E32CFF7");
+  CHECK(hmac("Jefe", "what do ya want for nothing?") == "5BDCC146BF60754E6A042426089575C75A003F089D2739839DEC58B964EC3843");
+  CHECK(hmac(repeat(0xaa, 20), repeat(0xdd, 50)) == "773EA91E36800E46854DB8EBD09181A72959098B3EF8C122D9635514CED565FE");
+  CHECK(hmac(String((const tchar_t*)key4, sizeof(key4)), repeat(0xcd, 50)) == "82558A389A443C0EA4CC819899F2083A85F0FAA3E578F8077A2E3FF46729665B");
+  CHECK(hmac(repeat(0x0c, 20), "Test With Truncation").substr(0, 32) == "A3B6167473100EE06E0C796C2955552B");
+  CHECK(hmac(repeat(0xaa, 131), "Test Using Larger Than Block-Size Key - Hash Key First") == "60E431591EE0B67F0D8A26AACBF5B77F8E0BC6213728C5140546040F0EE37F54");
+  CHECK(hmac(repeat(0xaa, 131), "This is a test using a larger than block-size key and a larger than block-size data. The key needs to be hashed before being used by the HMAC algorithm.") == "9B09FFA71B942FCB27635FBCD5B0E944BFDC63644F0713938A7F51535C3A35E2");
+
+  // a prepared context signs several messages
+  String key = repeat(0xaa, 131);
+  Sha256::Hmac context((const byte_t*)(const tchar_t*)key, key.length());
+  for(int_t i = 0; i < 2; ++i)
+  {
+    byte_t digest[Sha256::digestSize];
+    context.sign((const byte_t*)"Test Using Larger Than Block-Size Key - Hash Key First", 54, digest);
+    CHECK(Hex::toString(digest, sizeof(digest)) == "60E431591EE0B67F0D8A26AACBF5B77F8E0BC6213728C5140546040F0EE37F54");
+  }
+}
+
+int_t main(int_t argc, char_t* argv[])
+{
+  // run the vectors with the portable transform and with the hardware accelerated one if there is one
+  Sha256::setAcceleration(false);
+  testHash();
+  testHmac();
+  if(Sha256::setAcceleration(true))
+  {
+    testHash();
+    testHmac();
+  }
+  else
+    Console::printf("No hardware accelerated transform available.\n");
+  return reportChecks();
+}
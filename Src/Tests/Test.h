@@ -0,0 +1,31 @@
+
+#pragma once
+
+#include <nstd/Console.h>
+
+static int_t failures = 0;
+
+#define CHECK(e) check(e, #e, __FILE__, __LINE__)
+
+static void_t check(bool_t result, const char_t* expression, const char_t* file, int_t line)
+{
+  if(result)
+    return;
+  Console::errorf("%s:%d: Check failed: %s\n", file, line, expression);
+  ++failures;
+}
+
+/**
+* Prints the result of the checks.
+* @return The exit code of the test.
+*/
+static int_t reportChecks()
+{
+  if(failures)
+  {
+    Console::errorf("%d checks failed.\n", failures);
+    return 1;
+  }
+  Console::printf("All checks passed.\n");
+  return 0;
+}
@@ -0,0 +1,26 @@
+
+#pragma once
+
+#include <zlimdbclient.h>
+
+/**
+* The entity of the candle tables of a market ("markets/<market>/candles/<interval>").
+* The id and the time of a candle are the start of its interval in milliseconds.
+* The moment sums weight each trade with its amount n, using the seconds since the start of the interval as x and the price as y.
+*/
+#pragma pack(push, 4)
+struct CandleEntity
+{
+  zlimdb_entity entity;
+  double open;
+  double high;
+  double low;
+  double close;
+  double volume; // sum of n
+  double vwap; // sum of n * y divided by the volume
+  double sumX; // sum of n * x
+  double sumXY; // sum of n * x * y
+  double sumXX; // sum of n * x * x
+  uint32_t trades;
+};
+#pragma pack(pop)
@@ -1,6 +1,8 @@
 
 #include <curl/curl.h>
 
+#include <nstd/Time.h>
+
 #include "HttpRequest.h"
 
 static class Curl
@@ -17,14 +19,163 @@ public:
 
 } curl;
 
-HttpRequest::HttpRequest() : curl(0) {}
+HttpRequest::Multi::Multi(Callback& callback) : callback(callback), timeoutTime(-1)
+{
+  multi = curl_multi_init();
+  curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, socketCallback);
+  curl_multi_setopt(multi, CURLMOPT_SOCKETDATA, this);
+  curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, timerCallback);
+  curl_multi_setopt(multi, CURLMOPT_TIMERDATA, this);
+}
+
+HttpRequest::Multi::~Multi()
+{
+  curl_multi_cleanup(multi);
+}
+
+int64_t HttpRequest::Multi::getTimeout() const
+{
+  if(timeoutTime < 0)
+    return -1;
+  int64_t timeout = timeoutTime - Time::time();
+  return timeout < 0 ? 0 : timeout;
+}
+
+bool_t HttpRequest::Multi::process(int_t fd, bool_t read, bool_t write)
+{
+  int running;
+  if(fd < 0)
+  {
+    timeoutTime = -1;
+    curl_multi_socket_action(multi, CURL_SOCKET_TIMEOUT, 0, &running);
+  }
+  else
+    curl_multi_socket_action(multi, fd, (read ? CURL_CSELECT_IN : 0) | (write ? CURL_CSELECT_OUT : 0), &running);
+
+  bool_t completed = false;
+  int queued;
+  for(CURLMsg* msg; (msg = curl_multi_info_read(multi, &queued));)
+    if(msg->msg == CURLMSG_DONE)
+    {
+      HttpRequest* request;
+      curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&request);
+      CURLcode status = msg->data.result;
+      curl_multi_remove_handle(multi, msg->easy_handle);
+      request->complete(status);
+      completed = true;
+    }
+  return completed;
+}
+
+int HttpRequest::Multi::socketCallback(void* easy, int fd, int what, void* userData, void* socketData)
+{
+  Multi* multi = (Multi*)userData;
+  if(what == CURL_POLL_REMOVE)
+    multi->callback.removedSocket(fd);
+  else
+    multi->callback.updatedSocket(fd, what == CURL_POLL_IN || what == CURL_POLL_INOUT, what == CURL_POLL_OUT || what == CURL_POLL_INOUT);
+  return 0;
+}
+
+int HttpRequest::Multi::timerCallback(void* multi, long timeout, void* userData)
+{
+  ((Multi*)userData)->timeoutTime = timeout < 0 ? -1 : Time::time() + timeout;
+  return 0;
+}
+
+HttpRequest::HttpRequest() : curl(0), multi(0), response(0) {}
 
 HttpRequest::~HttpRequest()
 {
+  if(multi)
+    curl_multi_remove_handle(multi->multi, curl);
   if(curl)
     curl_easy_cleanup(curl);
 }
 
+bool_t HttpRequest::startGet(Multi& multi, const String& url, Buffer& data, bool checkCertificate)
+{
+  if(this->multi)
+  {
+    error = "Request is still in progress.";
+    return false;
+  }
+  if(!curl)
+  {
+    curl = curl_easy_init();
+    if(!curl)
+    {
+      error = "Could not initialize curl.";
+      return false;
+    }
+  }
+  else
+    curl_easy_reset(curl);
+
+  response = &data;
+  curl_easy_setopt(curl, CURLOPT_URL, (const char_t*)url);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeResponse);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+  curl_easy_setopt(curl, CURLOPT_PRIVATE, this);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 40);
+  if(!checkCertificate)
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0);
+
+  data.clear();
+  data.reserve(1500);
+
+  CURLMcode status = curl_multi_add_handle(multi.multi, curl);
+  if(status != CURLM_OK)
+  {
+    error.printf("%s.", curl_multi_strerror(status));
+    return false;
+  }
+  this->multi = &multi;
+  error.clear();
+  return true;
+}
+
+void_t HttpRequest::cancel()
+{
+  if(!multi)
+    return;
+  curl_multi_remove_handle(multi->multi, curl);
+  multi = 0;
+  response = 0;
+  error = "Request was canceled.";
+}
+
+void_t HttpRequest::complete(int_t status)
+{
+  multi = 0;
+  response = 0;
+  if(status != CURLE_OK)
+  {
+    error.printf("%s.", curl_easy_strerror((CURLcode)status));
+    return;
+  }
+
+  long code;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+  if(code != 200)
+  {
+    error.printf("Server responded with code %u.", (uint_t)code);
+    return;
+  }
+  error.clear();
+}
+
+size_t HttpRequest::writeResponse(void *ptr, size_t size, size_t nmemb, void *stream)
+{
+  Buffer* buffer = (Buffer*)stream;
+  size_t newBytes = size * nmemb;
+  size_t totalSize = buffer->size() + newBytes;
+  if(totalSize > (size_t)buffer->capacity())
+    buffer->reserve(totalSize * 2);
+  buffer->append((const byte_t*)ptr, newBytes);
+  return newBytes;
+}
+
 bool_t HttpRequest::get(const String& url, Buffer& data, bool checkCertificate)
 {
   if(!curl)
@@ -8,6 +8,47 @@
 
 class HttpRequest
 {
+public:
+  /**
+  * A group of requests that are performed concurrently without blocking.
+  * The sockets of the requests are reported through a callback so that they can be watched with epoll or select.
+  */
+  class Multi
+  {
+  public:
+    class Callback
+    {
+    public:
+      virtual void_t updatedSocket(int_t fd, bool_t read, bool_t write) = 0;
+      virtual void_t removedSocket(int_t fd) = 0;
+    };
+
+  public:
+    Multi(Callback& callback);
+    ~Multi();
+
+    /**
+    * Returns the time in milliseconds until process() has to be called without a socket or -1 if there is no timeout.
+    */
+    int64_t getTimeout() const;
+
+    /**
+    * Performs pending work on a socket or on the expired timeout when called with -1.
+    * @return \c true when at least one request has been completed
+    */
+    bool_t process(int_t fd = -1, bool_t read = false, bool_t write = false);
+
+  private:
+    void_t* multi;
+    Callback& callback;
+    int64_t timeoutTime;
+
+    static int socketCallback(void* easy, int fd, int what, void* userData, void* socketData);
+    static int timerCallback(void* multi, long timeout, void* userData);
+
+    friend class HttpRequest;
+  };
+
 public:
   HttpRequest();
   ~HttpRequest();
@@ -17,7 +58,34 @@ public:
   bool_t get(const String& url, Buffer& data, bool checkCertificate = true);
   bool_t post(const String& url, const HashMap<String, String>& formData, Buffer& data);
 
+  /**
+  * Starts a get request that is performed by a request group.
+  * @param data The buffer that receives the response. It has to remain valid until the request has been completed.
+  */
+  bool_t startGet(Multi& multi, const String& url, Buffer& data, bool checkCertificate = true);
+
+  /**
+  * Checks whether a request started with startGet() is still in progress.
+  */
+  bool_t isPending() const {return multi != 0;}
+
+  /**
+  * Aborts a request started with startGet().
+  */
+  void_t cancel();
+
+  /**
+  * Returns the result of the last request started with startGet().
+  */
+  bool_t getResult() const {return error.isEmpty();}
+
 private:
   void* curl;
   String error;
+  Multi* multi;
+  Buffer* response;
+
+  void_t complete(int_t status);
+
+  static size_t writeResponse(void *ptr, size_t size, size_t nmemb, void *stream);
 };
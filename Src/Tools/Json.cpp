@@ -1,5 +1,20 @@
 
+#include <cstdlib>
+#include <new>
+
 #include <nstd/Buffer.h>
+#include <nstd/Memory.h>
+
+#if !defined(_UNICODE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define JSON_SSE2
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif !defined(_UNICODE) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define JSON_NEON
+#endif
 
 #include "Json.h"
 
@@ -10,7 +25,36 @@ public:
   Variant value;
 };
 
-static bool_t appendAsUtf8(String& str, uint_t ch)
+class Json::Parser::Number
+{
+public:
+  const tchar_t* start;
+  size_t length;
+  uint64_t mantissa;
+  int_t exponent;
+  bool_t negative;
+  bool_t integer;
+  bool_t exact;
+};
+
+class StringWriter
+{
+public:
+  tchar_t* start;
+  tchar_t* pos;
+
+  StringWriter(tchar_t* start) : start(start), pos(start) {}
+
+  void_t clear() {pos = start;}
+  void_t append(tchar_t c) {*(pos++) = c;}
+  void_t append(const tchar_t* str, size_t length)
+  {
+    Memory::move(pos, str, length * sizeof(tchar_t));
+    pos += length;
+  }
+};
+
+template<class T> static bool_t appendAsUtf8(T& str, uint_t ch)
 {
   if (ch < 0x80)
   {
@@ -41,11 +85,255 @@ static bool_t appendAsUtf8(String& str, uint_t ch)
   return false;
 }
 
-static bool nextToken(const tchar_t*& data, Token& token)
+static const tchar_t* findQuoteOrEscape(const tchar_t* data, const tchar_t* end)
+{
+#if defined(JSON_SSE2)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i escape = _mm_set1_epi8('\\');
+  for(; end - data >= 16; data += 16)
+  {
+    __m128i chunk = _mm_loadu_si128((const __m128i*)data);
+    uint_t mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, escape)));
+    if(mask)
+    {
+#ifdef _MSC_VER
+      unsigned long index;
+      _BitScanForward(&index, mask);
+      return data + index;
+#else
+      return data + __builtin_ctz(mask);
+#endif
+    }
+  }
+#elif defined(JSON_NEON)
+  const uint8x16_t quote = vdupq_n_u8('"');
+  const uint8x16_t escape = vdupq_n_u8('\\');
+  for(; end - data >= 16; data += 16)
+  {
+    uint8x16_t chunk = vld1q_u8((const uint8_t*)data);
+    uint64x2_t match = vreinterpretq_u64_u8(vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, escape)));
+    if(vgetq_lane_u64(match, 0) | vgetq_lane_u64(match, 1))
+      break; // the scalar loop finds the exact position within this chunk
+  }
+#endif
+  while(data < end && *data != '"' && *data != '\\')
+    ++data;
+  return data;
+}
+
+static bool_t readHex4(const tchar_t* data, const tchar_t* end, uint_t& result)
+{
+  if(end - data < 4)
+    return false;
+  result = 0;
+  for(const tchar_t* i = data, * iend = data + 4; i < iend; ++i)
+  {
+    result <<= 4;
+    if(*i >= '0' && *i <= '9')
+      result |= *i - '0';
+    else if(*i >= 'a' && *i <= 'f')
+      result |= *i - 'a' + 10;
+    else if(*i >= 'A' && *i <= 'F')
+      result |= *i - 'A' + 10;
+    else
+      return false;
+  }
+  return true;
+}
+
+/**
+* Decodes a string starting behind its opening quote and advances \c data behind its closing quote.
+*/
+template<class T> static bool_t decodeString(const tchar_t*& data, const tchar_t* end, T& value)
+{
+  value.clear();
+  for(;;)
+  {
+    const tchar_t* start = data;
+    data = findQuoteOrEscape(data, end);
+    if(data > start)
+      value.append(start, data - start);
+    if(data == end)
+      return false;
+    if(*data == '"')
+    {
+      ++data;
+      return true;
+    }
+    if(++data == end)
+      return false;
+    switch(*data)
+    {
+    case '"':
+    case '\\':
+    case '/':
+      value.append(*data);
+      break;
+    case 'b':
+      value.append('\b');
+      break;
+    case 'f':
+      value.append('\f');
+      break;
+    case 'n':
+      value.append('\n');
+      break;
+    case 'r':
+      value.append('\r');
+      break;
+    case 't':
+      value.append('\t');
+      break;
+    case 'u':
+      {
+        uint_t ch;
+        if(!readHex4(data + 1, end, ch))
+          return false;
+        data += 4;
+        if(ch >= 0xd800 && ch < 0xdc00)
+        { // UTF-16 surrogate pair encoded as 12-character sequence
+          uint_t low;
+          if(end - data >= 3 && data[1] == '\\' && data[2] == 'u' && readHex4(data + 3, end, low) && low >= 0xdc00 && low < 0xe000)
+          {
+            ch = 0x10000 + ((ch - 0xd800) << 10) + (low - 0xdc00);
+            data += 6;
+          }
+        }
+        appendAsUtf8(value, ch);
+      }
+      break;
+    default:
+      value.append('\\');
+      value.append(*data);
+      break;
+    }
+    ++data;
+  }
+}
+
+static bool_t scanNumber(const tchar_t*& data, const tchar_t* end, Json::Parser::Number& number)
+{
+  const tchar_t* p = data;
+  number.start = p;
+  number.negative = p < end && *p == '-';
+  if(number.negative)
+    ++p;
+  if(p == end || !String::isDigit(*p))
+    return false;
+  uint64_t mantissa = 0;
+  int_t digits = 0, exponent = 0;
+  bool_t exact = true;
+  for(; p < end && String::isDigit(*p); ++p)
+    if(digits < 19)
+    {
+      mantissa = mantissa * 10 + (*p - '0');
+      if(mantissa)
+        ++digits;
+    }
+    else
+    {
+      ++exponent;
+      if(*p != '0')
+        exact = false;
+    }
+  number.integer = true;
+  if(p < end && *p == '.')
+  {
+    number.integer = false;
+    if(++p == end || !String::isDigit(*p))
+      return false;
+    for(; p < end && String::isDigit(*p); ++p)
+      if(digits < 19)
+      {
+        mantissa = mantissa * 10 + (*p - '0');
+        if(mantissa)
+          ++digits;
+        --exponent;
+      }
+      else if(*p != '0')
+        exact = false;
+  }
+  if(p < end && (*p == 'e' || *p == 'E'))
+  {
+    number.integer = false;
+    bool_t negativeExponent = false;
+    if(++p < end && (*p == '-' || *p == '+'))
+    {
+      negativeExponent = *p == '-';
+      ++p;
+    }
+    if(p == end || !String::isDigit(*p))
+      return false;
+    int_t e = 0;
+    for(; p < end && String::isDigit(*p); ++p)
+      if(e < 100000)
+        e = e * 10 + (*p - '0');
+    exponent += negativeExponent ? -e : e;
+  }
+  number.length = p - number.start;
+  number.mantissa = mantissa;
+  number.exponent = exponent;
+  number.exact = exact;
+  data = p;
+  return true;
+}
+
+static double toDouble(const Json::Parser::Number& number)
+{
+  static const double powersOf10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+  // the mantissa and the power of ten are both exactly representable, so a single
+  // multiplication or division yields a correctly rounded result
+  if(number.exact && number.mantissa <= (1ULL << 53) && number.exponent >= -22 && number.exponent <= 22)
+  {
+    double result = (double)number.mantissa;
+    if(number.exponent < 0)
+      result /= powersOf10[-number.exponent];
+    else
+      result *= powersOf10[number.exponent];
+    return number.negative ? -result : result;
+  }
+
+  tchar_t buffer[128];
+  if(number.length < sizeof(buffer) / sizeof(tchar_t))
+  {
+    Memory::copy(buffer, number.start, number.length * sizeof(tchar_t));
+    buffer[number.length] = 0;
+    return strtod(buffer, 0);
+  }
+  return String(number.start, number.length).toDouble();
+}
+
+static bool_t toUInt64(const Json::Parser::Number& number, uint64_t& result)
+{
+  if(number.integer)
+  {
+    result = 0;
+    for(const tchar_t* i = number.start + (number.negative ? 1 : 0), * end = number.start + number.length; i < end; ++i)
+    {
+      uint64_t next = result * 10 + (*i - '0');
+      if(result > 1844674407370955161ULL || next < result)
+        return false;
+      result = next;
+    }
+    return true;
+  }
+  // the magnitude is returned, the caller applies the sign
+  double value = toDouble(number);
+  if(number.negative)
+    value = -value;
+  if(!(value >= 0.) || value >= 18446744073709551616.)
+    return false;
+  result = (uint64_t)value;
+  return true;
+}
+
+static bool nextToken(const tchar_t*& data, const tchar_t* end, Token& token, String& value)
 {
-  while(String::isSpace(*data))
+  while(data < end && String::isSpace(*data))
     ++data;
-  token.token = *data;
+  token.token = data < end ? *data : '\0';
   switch(token.token)
   {
   case '\0':
@@ -59,86 +347,13 @@ static bool nextToken(const tchar_t*& data, Token& token)
     ++data;
     return true;
   case '"':
-    {
-      ++data;
-      String value;
-      for(;;)
-        switch(*data)
-        {
-        case 0:
-          return false;
-        case '\\':
-          {
-            ++data;
-            switch(*data)
-            {
-            case '"':
-            case '\\':
-            case '/':
-              value.append(*data);
-              ++data;
-              break;
-            case 'b':
-              value.append('\b');
-              ++data;
-              break;
-            case 'f':
-              value.append('\f');
-              ++data;
-              break;
-            case 'n':
-              value.append('\n');
-              ++data;
-              break;
-            case 'r':
-              value.append('\r');
-              ++data;
-              break;
-            case 't':
-              value.append('\t');
-              ++data;
-              break;
-            case 'u':
-              {
-                ++data;
-                String k(4);
-                for(int i = 0; i < 4; ++i)
-                  if(*data)
-                  {
-                    k.append(*data);
-                    ++data;
-                  }
-                  else
-                    break; // todo: return false?
-                int_t i;
-                if(k.scanf("%x", &i) == 1)
-                  appendAsUtf8(value, i);
-                // todo: else return false?
-                // todo: support UTF-16 surrogate pairs encoded as 12-character sequence
-                break;
-              }
-              break;
-            default:
-              value.append('\\');
-              value.append(*data);
-              ++data;
-              break;
-            }
-          }
-          break;
-        case '"':
-          ++data;
-          token.value = value;
-          return true;
-        default:
-          value.append(*data);
-          ++data;
-          break;
-        }
-    }
-    return false;
+    ++data;
+    if(!decodeString(data, end, value))
+      return false;
+    token.value = value;
+    return true;
   case 't':
-    if(String::compare(data, "true", 4) == 0)
+    if(end - data >= 4 && String::compare(data, "true", 4) == 0)
     {
       data += 4;
       token.value = true;
@@ -146,7 +361,7 @@ static bool nextToken(const tchar_t*& data, Token& token)
     }
     return false;
   case 'f':
-    if(String::compare(data, "false", 5) == 0)
+    if(end - data >= 5 && String::compare(data, "false", 5) == 0)
     {
       data += 5;
       token.value = false;
@@ -154,7 +369,7 @@ static bool nextToken(const tchar_t*& data, Token& token)
     }
     return false;
   case 'n':
-    if(String::compare(data, "null", 4) == 0)
+    if(end - data >= 4 && String::compare(data, "null", 4) == 0)
     {
       data += 4;
       token.value.clear(); // creates a null variant
@@ -162,65 +377,64 @@ static bool nextToken(const tchar_t*& data, Token& token)
     }
     return false;
   default:
-    token.token = '#';
-    if(*data == '-' || String::isDigit(*data))
     {
-      String n;
-      bool isDouble = false;
-      for(;;)
-        switch(*data)
-        {
-        case 'E':
-        case 'e':
-        case '-':
-        case '+':
-          n.append(*data);
-          ++data;
-          break;
-        case '.':
-          isDouble = true;
-          n.append(*data);
-          ++data;
-          break;
-        default:
-          if(String::isDigit(*data))
-          {
-            n.append(*data);
-            ++data;
-            break;
-          }
-          goto scanNumber;
-        }
-    scanNumber:
-      if(isDouble)
+      token.token = '#';
+      Json::Parser::Number number;
+      if(!scanNumber(data, end, number))
+        return false;
+      if(!number.integer)
       {
-        token.value = n.toDouble();
+        token.value = toDouble(number);
         return true;
       }
-      else
+      uint64_t result;
+      if(!toUInt64(number, result))
+      {
+        token.value = toDouble(number);
+        return true;
+      }
+      if(number.negative ? result > 0x8000000000000000ULL : result > 0x7fffffffffffffffULL)
       {
-        int64_t result = n.toInt64();
-        int_t resultInt = (int_t)result;
-        if((int64_t)resultInt == result)
-          token.value = resultInt;
+        if(number.negative)
+          token.value = toDouble(number);
         else
           token.value = result;
         return true;
       }
+      int64_t resultInt64 = number.negative ? (int64_t)(0 - result) : (int64_t)result;
+      int_t resultInt = (int_t)resultInt64;
+      if((int64_t)resultInt == resultInt64)
+        token.value = resultInt;
+      else
+        token.value = resultInt64;
+      return true;
     }
-    return false;
   }
 }
 
-static bool_t parseObject(const tchar_t*& data, Token& token, Variant& result);
-static bool_t parseValue(const tchar_t*& data, Token& token, Variant& result);
-static bool_t parseArray(const tchar_t*& data, Token& token, Variant& result);
+class Tokenizer
+{
+public:
+  const tchar_t* data;
+  const tchar_t* end;
+  Token token;
+  String value;
+
+  Tokenizer(const tchar_t* data, const tchar_t* end) : data(data), end(end) {}
+
+  bool_t next() {return nextToken(data, end, token, value);}
+};
+
+static bool_t parseObject(Tokenizer& tokenizer, Variant& result);
+static bool_t parseValue(Tokenizer& tokenizer, Variant& result);
+static bool_t parseArray(Tokenizer& tokenizer, Variant& result);
 
-static bool_t parseObject(const tchar_t*& data, Token& token, Variant& result)
+static bool_t parseObject(Tokenizer& tokenizer, Variant& result)
 {
+  Token& token = tokenizer.token;
   if(token.token != '{')
     return false;
-  if(!nextToken(data, token))
+  if(!tokenizer.next())
     return false;
   HashMap<String, Variant>& object = result.toMap();
   String key;
@@ -229,51 +443,53 @@ static bool_t parseObject(const tchar_t*& data, Token& token, Variant& result)
     if(token.token != '"')
       return false;
     key = token.value.toString();
-    if(!nextToken(data, token))
+    if(!tokenizer.next())
       return false;
     if(token.token != ':')
       return false;
-    if(!nextToken(data, token))
+    if(!tokenizer.next())
       return false;
-    if(!parseValue(data, token, object.append(key, Variant())))
+    if(!parseValue(tokenizer, object.append(key, Variant())))
       return false;
     if(token.token == '}')
       break;
     if(token.token != ',')
       return false;
-    if(!nextToken(data, token))
+    if(!tokenizer.next())
       return false;
   } 
-  if(!nextToken(data, token)) // skip }
+  if(!tokenizer.next()) // skip }
     return false;
   return true;
 }
 
-static bool_t parseArray(const tchar_t*& data, Token& token, Variant& result)
+static bool_t parseArray(Tokenizer& tokenizer, Variant& result)
 {
+  Token& token = tokenizer.token;
   if(token.token != '[')
     return false;
-  if(!nextToken(data, token))
+  if(!tokenizer.next())
     return false;
   List<Variant>& list = result.toList();
   while(token.token != ']')
   {
-    if(!parseValue(data, token, list.append(Variant())))
+    if(!parseValue(tokenizer, list.append(Variant())))
       return false;
     if(token.token == ']')
       break;
     if(token.token != ',')
       return false;
-    if(!nextToken(data, token))
+    if(!tokenizer.next())
       return false;
   }
-  if(!nextToken(data, token)) // skip ]
+  if(!tokenizer.next()) // skip ]
     return false;
   return true;
 }
 
-static bool_t parseValue(const tchar_t*& data, Token& token, Variant& result)
+static bool_t parseValue(Tokenizer& tokenizer, Variant& result)
 {
+  Token& token = tokenizer.token;
   switch(token.token)
   {
   case '"':
@@ -283,36 +499,545 @@ static bool_t parseValue(const tchar_t*& data, Token& token, Variant& result)
   case 'n':
     {
       result.swap(token.value);
-      if(!nextToken(data, token))
+      if(!tokenizer.next())
         return false;
       return true;
     }
   case '[':
-    return parseArray(data, token, result);
+    return parseArray(tokenizer, result);
   case '{':
-    return parseObject(data, token, result);
+    return parseObject(tokenizer, result);
   }
   return false;
 }
 
-bool_t Json::parse(const tchar_t* data, Variant& result)
+static bool_t parse(const tchar_t* data, const tchar_t* end, Variant& result)
 {
-  Token token;
-  if(!nextToken(data, token))
+  Tokenizer tokenizer(data, end);
+  if(!tokenizer.next())
     return false;
-  if(!parseValue(data, token, result))
+  if(!parseValue(tokenizer, result))
     return false;
   return true;
 }
 
+bool_t Json::parse(const tchar_t* data, Variant& result)
+{
+  return ::parse(data, data + String::length(data), result);
+}
+
 bool_t Json::parse(const String& data, Variant& result)
 {
-  return parse((const tchar_t*)data, result);
+  return ::parse((const tchar_t*)data, (const tchar_t*)data + data.length(), result);
 }
 
 bool_t Json::parse(const Buffer& data, Variant& result)
 {
-  return parse((const tchar_t*)(const byte_t*)data, result);
+  const tchar_t* start = (const tchar_t*)(const byte_t*)data;
+  return ::parse(start, start + data.size() / sizeof(tchar_t), result);
+}
+
+const Json::Value Json::Value::nullValue;
+
+Json::Arena::~Arena()
+{
+  for(Block* i = first, * next; i; i = next)
+  {
+    next = i->next;
+    delete[] (byte_t*)i;
+  }
+}
+
+void_t* Json::Arena::alloc(size_t size)
+{
+  size = (size + 7) & ~(size_t)7;
+  if((size_t)(end - pos) < size)
+  {
+    Block* next = current ? current->next : first;
+    if(!next || next->size < size)
+    {
+      size_t newBlockSize = size > blockSize ? size : blockSize;
+      Block* block = (Block*)new byte_t[sizeof(Block) + newBlockSize];
+      block->size = newBlockSize;
+      block->next = next;
+      if(current)
+        current->next = block;
+      else
+        first = block;
+      next = block;
+    }
+    current = next;
+    pos = (byte_t*)(current + 1);
+    end = pos + current->size;
+  }
+  void_t* result = pos;
+  pos += size;
+  return result;
+}
+
+void_t Json::Arena::reset()
+{
+  current = first;
+  if(current)
+  {
+    pos = (byte_t*)(current + 1);
+    end = pos + current->size;
+  }
+}
+
+const Json::Value* Json::Value::find(const tchar_t* key) const
+{
+  if(type != objectType)
+    return &nullValue;
+  size_t keyLength = String::length(key);
+  for(const Value* i = first; i; i = i->next)
+    if(i->keyLength == keyLength && Memory::compare(i->key, key, keyLength * sizeof(tchar_t)) == 0)
+      return i;
+  return &nullValue;
+}
+
+bool_t Json::Value::toBool() const
+{
+  switch(type)
+  {
+  case boolType:
+    return length != 0;
+  case numberType:
+    return toDouble() != 0.;
+  case stringType:
+    return length == 4 && String::compare(str, "true", 4) == 0;
+  default:
+    return false;
+  }
+}
+
+double Json::Value::toDouble() const
+{
+  if(type == boolType)
+    return length != 0 ? 1. : 0.;
+  Parser::Number number;
+  const tchar_t* data = str;
+  if((type != numberType && type != stringType) || !scanNumber(data, str + length, number))
+    return 0.;
+  return ::toDouble(number);
+}
+
+int64_t Json::Value::toInt64() const
+{
+  return (int64_t)toUInt64();
+}
+
+uint64_t Json::Value::toUInt64() const
+{
+  if(type == boolType)
+    return length != 0 ? 1 : 0;
+  Parser::Number number;
+  const tchar_t* data = str;
+  uint64_t result;
+  if((type != numberType && type != stringType) || !scanNumber(data, str + length, number) || !::toUInt64(number, result))
+    return 0;
+  return number.negative ? 0 - result : result;
+}
+
+String Json::Value::toString() const
+{
+  switch(type)
+  {
+  case boolType:
+    return length != 0 ? String("true") : String("false");
+  case numberType:
+  case stringType:
+    return String(str, length);
+  default:
+    return String();
+  }
+}
+
+static bool_t parseString(const tchar_t*& data, const tchar_t* end, Json::Arena& arena, const tchar_t*& str, size_t& length)
+{
+  const tchar_t* stringEnd = ++data;
+  for(;;)
+  {
+    stringEnd = findQuoteOrEscape(stringEnd, end);
+    if(stringEnd >= end)
+      return false;
+    if(*stringEnd == '"')
+      break;
+    stringEnd += 2;
+  }
+  // the decoded string is never longer than its encoded form
+  tchar_t* buffer = (tchar_t*)arena.alloc((stringEnd - data + 1) * sizeof(tchar_t));
+  StringWriter writer(buffer);
+  if(!decodeString(data, end, writer))
+    return false;
+  *writer.pos = 0;
+  str = buffer;
+  length = writer.pos - buffer;
+  return true;
+}
+
+bool_t Json::parseValue(const tchar_t*& data, const tchar_t* end, Arena& arena, Value& value)
+{
+  while(data < end && String::isSpace(*data))
+    ++data;
+  if(data == end)
+    return false;
+  switch(*data)
+  {
+  case '"':
+    value.type = Value::stringType;
+    return parseString(data, end, arena, value.str, value.length);
+  case '{':
+  case '[':
+    {
+      bool_t isObject = *data == '{';
+      tchar_t closing = isObject ? '}' : ']';
+      value.type = isObject ? Value::objectType : Value::arrayType;
+      ++data;
+      for(Value* last = 0;;)
+      {
+        while(data < end && String::isSpace(*data))
+          ++data;
+        if(data == end)
+          return false;
+        if(*data == closing)
+        {
+          ++data;
+          return true;
+        }
+        if(last)
+        {
+          if(*data != ',')
+            return false;
+          ++data;
+          while(data < end && String::isSpace(*data))
+            ++data;
+          if(data == end)
+            return false;
+        }
+        Value* child = new(arena.alloc(sizeof(Value))) Value;
+        if(isObject)
+        {
+          if(*data != '"' || !parseString(data, end, arena, child->key, child->keyLength))
+            return false;
+          while(data < end && String::isSpace(*data))
+            ++data;
+          if(data == end || *data != ':')
+            return false;
+          ++data;
+        }
+        if(!parseValue(data, end, arena, *child))
+          return false;
+        if(last)
+          last->next = child;
+        else
+          value.first = child;
+        last = child;
+      }
+    }
+  case 't':
+    if(end - data >= 4 && String::compare(data, "true", 4) == 0)
+    {
+      data += 4;
+      value.type = Value::boolType;
+      value.length = 1;
+      return true;
+    }
+    return false;
+  case 'f':
+    if(end - data >= 5 && String::compare(data, "false", 5) == 0)
+    {
+      data += 5;
+      value.type = Value::boolType;
+      value.length = 0;
+      return true;
+    }
+    return false;
+  case 'n':
+    if(end - data >= 4 && String::compare(data, "null", 4) == 0)
+    {
+      data += 4;
+      value.type = Value::nullType;
+      return true;
+    }
+    return false;
+  default:
+    {
+      Parser::Number number;
+      if(!scanNumber(data, end, number))
+        return false;
+      tchar_t* buffer = (tchar_t*)arena.alloc((number.length + 1) * sizeof(tchar_t));
+      Memory::copy(buffer, number.start, number.length * sizeof(tchar_t));
+      buffer[number.length] = 0;
+      value.type = Value::numberType;
+      value.str = buffer;
+      value.length = number.length;
+      return true;
+    }
+  }
+}
+
+bool_t Json::parse(const tchar_t* data, size_t length, Arena& arena, const Value*& result)
+{
+  Value* value = new(arena.alloc(sizeof(Value))) Value;
+  if(!parseValue(data, data + length, arena, *value))
+    return false;
+  result = value;
+  return true;
+}
+
+bool_t Json::parse(const Buffer& data, Arena& arena, const Value*& result)
+{
+  return parse((const tchar_t*)(const byte_t*)data, data.size() / sizeof(tchar_t), arena, result);
+}
+
+Json::Parser::Parser(const String& data) : pos(data), end((const tchar_t*)data + data.length()), error(false) {}
+
+Json::Parser::Parser(const Buffer& data) : pos((const tchar_t*)(const byte_t*)data), end((const tchar_t*)(const byte_t*)data + data.size() / sizeof(tchar_t)), error(false) {}
+
+tchar_t Json::Parser::peek()
+{
+  while(pos < end && String::isSpace(*pos))
+    ++pos;
+  return pos < end ? *pos : 0;
+}
+
+bool_t Json::Parser::beginObject()
+{
+  if(error || peek() != '{')
+    return fail();
+  ++pos;
+  return true;
+}
+
+bool_t Json::Parser::nextMember(String& key)
+{
+  if(error)
+    return false;
+  tchar_t c = peek();
+  if(c == '}')
+  {
+    ++pos;
+    return false;
+  }
+  if(c == ',')
+  {
+    ++pos;
+    c = peek();
+  }
+  if(c != '"' || !readString(key))
+    return fail();
+  if(peek() != ':')
+    return fail();
+  ++pos;
+  return true;
+}
+
+bool_t Json::Parser::beginArray()
+{
+  if(error || peek() != '[')
+    return fail();
+  ++pos;
+  return true;
+}
+
+bool_t Json::Parser::nextElement()
+{
+  if(error)
+    return false;
+  tchar_t c = peek();
+  if(c == ']')
+  {
+    ++pos;
+    return false;
+  }
+  if(c == ',')
+  {
+    ++pos;
+    c = peek();
+  }
+  if(c == 0)
+    return fail();
+  return true;
+}
+
+bool_t Json::Parser::readString(String& value)
+{
+  if(error)
+    return false;
+  tchar_t c = peek();
+  if(c != '"')
+  {
+    if(c == '{' || c == '[' || c == 0)
+      return fail();
+    const tchar_t* start = pos;
+    while(pos < end && !String::isSpace(*pos) && *pos != ',' && *pos != '}' && *pos != ']')
+      ++pos;
+    value.clear();
+    if(pos - start != 4 || String::compare(start, "null", 4) != 0)
+      value.append(start, pos - start);
+    return true;
+  }
+  ++pos;
+  if(!decodeString(pos, end, value))
+    return fail();
+  return true;
+}
+
+bool_t Json::Parser::readStringInPlace(tchar_t*& value, size_t& length)
+{
+  if(error)
+    return false;
+  if(peek() != '"')
+    return fail();
+  // the decoded string is never longer than its encoded form, so it can be written over it
+  tchar_t* start = (tchar_t*)++pos;
+  StringWriter writer(start);
+  if(!decodeString(pos, end, writer))
+    return fail();
+  value = start;
+  length = writer.pos - start;
+  return true;
+}
+
+bool_t Json::Parser::readNumber(Number& number)
+{
+  if(error)
+    return false;
+  tchar_t c = peek();
+  if(c == 'n')
+  {
+    if(end - pos < 4 || String::compare(pos, "null", 4) != 0)
+      return fail();
+    pos += 4;
+    number.start = pos;
+    number.length = 0;
+    number.mantissa = 0;
+    number.exponent = 0;
+    number.negative = false;
+    number.integer = true;
+    number.exact = true;
+    return true;
+  }
+  bool_t quoted = c == '"';
+  if(quoted)
+  {
+    if(++pos < end && *pos == '"')
+    {
+      ++pos;
+      number.start = pos;
+      number.length = 0;
+      number.mantissa = 0;
+      number.exponent = 0;
+      number.negative = false;
+      number.integer = true;
+      number.exact = true;
+      return true;
+    }
+  }
+  if(!scanNumber(pos, end, number))
+    return fail();
+  if(quoted)
+  {
+    if(pos == end || *pos != '"')
+      return fail();
+    ++pos;
+  }
+  return true;
+}
+
+bool_t Json::Parser::readDouble(double& value)
+{
+  Number number;
+  if(!readNumber(number))
+    return false;
+  value = toDouble(number);
+  return true;
+}
+
+bool_t Json::Parser::readInt64(int64_t& value)
+{
+  Number number;
+  if(!readNumber(number))
+    return false;
+  uint64_t result;
+  if(!toUInt64(number, result) || result > (number.negative ? 0x8000000000000000ULL : 0x7fffffffffffffffULL))
+  {
+    // out of range values are saturated instead of failing the whole parse
+    value = number.negative ? (int64_t)0x8000000000000000ULL : (int64_t)0x7fffffffffffffffULL;
+    return true;
+  }
+  value = number.negative ? (int64_t)(0 - result) : (int64_t)result;
+  return true;
+}
+
+bool_t Json::Parser::readUInt64(uint64_t& value)
+{
+  Number number;
+  if(!readNumber(number))
+    return false;
+  uint64_t result;
+  if(!toUInt64(number, result))
+    return fail();
+  value = number.negative ? 0 - result : result;
+  return true;
+}
+
+bool_t Json::Parser::readValue(Variant& value)
+{
+  if(error)
+    return false;
+  peek();
+  const tchar_t* start = pos;
+  if(!skipValue())
+    return false;
+  if(!::parse(start, pos, value))
+    return fail();
+  return true;
+}
+
+bool_t Json::Parser::skipValue()
+{
+  if(error)
+    return false;
+  tchar_t c = peek();
+  if(c == 0)
+    return fail();
+  if(c != '{' && c != '[' && c != '"')
+  {
+    while(pos < end && !String::isSpace(*pos) && *pos != ',' && *pos != '}' && *pos != ']')
+      ++pos;
+    return true;
+  }
+  size_t depth = 0;
+  while(pos < end)
+    switch(*(pos++))
+    {
+    case '"':
+      for(;;)
+      {
+        pos = findQuoteOrEscape(pos, end);
+        if(pos >= end)
+          return fail();
+        if(*pos == '"')
+          break;
+        pos += 2;
+      }
+      ++pos;
+      if(depth == 0)
+        return true;
+      break;
+    case '{':
+    case '[':
+      ++depth;
+      break;
+    case '}':
+    case ']':
+      if(--depth == 0)
+        return true;
+      break;
+    }
+  return fail();
 }
 
 bool_t generateString(const String& str, String& result)
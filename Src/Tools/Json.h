@@ -7,10 +7,193 @@ class Buffer;
 
 class Json
 {
+public:
+  /**
+  * A pull parser that reads JSON data token by token without building a Variant tree.
+  * Read errors are sticky: Once a read fails, all further reads fail and hasError() returns true.
+  */
+  class Parser
+  {
+  public:
+    class Number;
+
+  public:
+    Parser(const tchar_t* data, size_t length) : pos(data), end(data + length), error(false) {}
+    Parser(const String& data);
+    Parser(const Buffer& data);
+
+    bool_t hasError() const {return error;}
+
+    /**
+    * Reads the beginning of an object.
+    * @return \c true when the next value is an object
+    */
+    bool_t beginObject();
+
+    /**
+    * Reads the key of the next member of the current object.
+    * The value of the member has to be read (or skipped) before the next call.
+    * @param key The key of the member.
+    * @return \c true when a member was read or \c false when the end of the object was reached or an error occured
+    */
+    bool_t nextMember(String& key);
+
+    /**
+    * Reads the beginning of an array.
+    * @return \c true when the next value is an array
+    */
+    bool_t beginArray();
+
+    /**
+    * Advances to the next element of the current array.
+    * The element has to be read (or skipped) before the next call.
+    * @return \c true when there is another element or \c false when the end of the array was reached or an error occured
+    */
+    bool_t nextElement();
+
+    /**
+    * Reads a string value. Numbers and literals are returned as they appear in the data.
+    */
+    bool_t readString(String& value);
+
+    /**
+    * Reads a string value and decodes it within the parsed data, which therefore has to be writable.
+    * @param value Receives a pointer to the decoded string. It is not terminated.
+    * @param length Receives the length of the decoded string.
+    */
+    bool_t readStringInPlace(tchar_t*& value, size_t& length);
+
+    /**
+    * Reads a number value. Numbers enclosed in quotes and \c null are accepted as well.
+    */
+    bool_t readDouble(double& value);
+    bool_t readInt64(int64_t& value);
+    bool_t readUInt64(uint64_t& value);
+
+    /**
+    * Reads any value into a Variant.
+    */
+    bool_t readValue(Variant& value);
+
+    /**
+    * Skips the next value including all of its members or elements.
+    */
+    bool_t skipValue();
+
+  private:
+    const tchar_t* pos;
+    const tchar_t* end;
+    bool_t error;
+
+    tchar_t peek();
+    bool_t fail() {error = true; return false;}
+    bool_t readNumber(Number& number);
+  };
+
+  /**
+  * A monotonic allocator for the values created by the arena parse mode.
+  * All memory is released at once with reset() and reused by the next parse.
+  */
+  class Arena
+  {
+  public:
+    Arena(size_t blockSize = 16384) : blockSize(blockSize), first(0), current(0), pos(0), end(0) {}
+    ~Arena();
+
+    void_t* alloc(size_t size);
+    void_t reset();
+
+  private:
+    class Block
+    {
+    public:
+      Block* next;
+      size_t size;
+    };
+
+  private:
+    size_t blockSize;
+    Block* first;
+    Block* current;
+    byte_t* pos;
+    byte_t* end;
+
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+  };
+
+  /**
+  * A value created by the arena parse mode. It is valid until its arena is reset.
+  */
+  class Value
+  {
+  public:
+    enum Type
+    {
+      nullType,
+      boolType,
+      numberType,
+      stringType,
+      objectType,
+      arrayType
+    };
+
+  public:
+    Type getType() const {return type;}
+    bool_t isNull() const {return type == nullType;}
+
+    /**
+    * Looks up a member of an object.
+    * @return The value of the member or a null value if there is no such member
+    */
+    const Value* find(const tchar_t* key) const;
+    bool_t contains(const tchar_t* key) const {return find(key) != &nullValue;}
+
+    /**
+    * Returns the first member of an object or the first element of an array.
+    */
+    const Value* getFirst() const {return first;}
+    const Value* getNext() const {return next;}
+    String getKey() const {return String(key, keyLength);}
+
+    bool_t toBool() const;
+    double toDouble() const;
+    int64_t toInt64() const;
+    uint64_t toUInt64() const;
+    String toString() const;
+
+  private:
+    Type type;
+    const tchar_t* key;
+    size_t keyLength;
+    const tchar_t* str;
+    size_t length;
+    Value* first;
+    Value* next;
+
+    static const Value nullValue;
+
+    Value() : type(nullType), key(0), keyLength(0), str(0), length(0), first(0), next(0) {}
+
+    friend class Json;
+  };
+
 public:
   static bool_t parse(const tchar_t* data, Variant& result);
   static bool_t parse(const String& data, Variant& result);
   static bool_t parse(const Buffer& data, Variant& result);
 
+  /**
+  * Parses JSON data into values allocated from an arena.
+  * @param data The data. It does not have to remain valid after the call.
+  * @param arena The arena the values are allocated from.
+  * @param result The root value.
+  */
+  static bool_t parse(const tchar_t* data, size_t length, Arena& arena, const Value*& result);
+  static bool_t parse(const Buffer& data, Arena& arena, const Value*& result);
+
   static bool_t generate(const Variant& data, String& result);
+
+private:
+  static bool_t parseValue(const tchar_t*& data, const tchar_t* end, Arena& arena, Value& value);
 };
@@ -0,0 +1,81 @@
+
+#pragma once
+
+#include <nstd/Base.h>
+
+/**
+* A bounded lock-free queue with any number of producers and one consumer. Every slot of the queue carries a sequence
+* number that tells the producers and the consumer whether the slot is free or filled, so pushing and popping an
+* element is a few atomic operations without locks or allocations.
+* @tparam T The type of the elements. It has to be default constructible and assignable.
+* @tparam capacity The maximum number of elements in the queue. It has to be a power of two.
+*/
+template <typename T, size_t capacity> class MpscQueue
+{
+public:
+  MpscQueue() : head(0), tail(0)
+  {
+    for(size_t i = 0; i < capacity; ++i)
+      slots[i].sequence = i;
+  }
+
+  /**
+  * Appends an element to the queue. This can be called from any thread.
+  * @param value The element.
+  * @return \c false when the queue is full
+  */
+  bool_t push(const T& value)
+  {
+    size_t position = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    Slot* slot;
+    for(;;)
+    {
+      slot = &slots[position & (capacity - 1)];
+      size_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+      intptr_t diff = (intptr_t)(sequence - position);
+      if(diff == 0)
+      {
+        if(__atomic_compare_exchange_n(&head, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+          break;
+      }
+      else if(diff < 0)
+        return false;
+      else
+        position = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    }
+    slot->value = value;
+    __atomic_store_n(&slot->sequence, position + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  /**
+  * Removes the oldest element from the queue. This must only be called from the consumer thread.
+  * @param value Receives the element.
+  * @return \c false when the queue is empty
+  */
+  bool_t pop(T& value)
+  {
+    Slot& slot = slots[tail & (capacity - 1)];
+    if(__atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE) != tail + 1)
+      return false;
+    value = slot.value;
+    slot.value = T();
+    __atomic_store_n(&slot.sequence, tail + capacity, __ATOMIC_RELEASE);
+    ++tail;
+    return true;
+  }
+
+private:
+  struct Slot
+  {
+    size_t sequence;
+    T value;
+  };
+
+private:
+  Slot slots[capacity];
+  char_t padding1[64];
+  size_t head;
+  char_t padding2[64];
+  size_t tail;
+};
@@ -1,155 +1,666 @@
 
+#ifndef _WIN32
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <dirent.h>
+#include <signal.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_CLASS_SHIFT 13
+#endif
+
 #include <nstd/Array.h>
 #include <nstd/Process.h>
 #include <nstd/HashMap.h>
 #include <nstd/Log.h>
+#include <nstd/Time.h>
+#include <nstd/Error.h>
 
 #include "ProcessManager.h"
 
-bool_t ProcessManager::start(Callback& callback)
+static const int64_t initialRestartDelay = 100;
+
+ProcessManager::ProcessManager() : callback(0), usageInterval(0), nextUsageTime(0), wakeUpPending(0)
+#ifndef _WIN32
+  , epollFd(-1), eventFd(-1), signalFd(-1), checkTerminations(false)
+#endif
+{}
+
+ProcessManager::~ProcessManager()
+{
+  for(HashMap<uint64_t, Child*>::Iterator i = children.begin(), end = children.end(); i != end; ++i)
+  {
+    Child* child = *i;
+#ifndef _WIN32
+    if(child->pidFd >= 0)
+      ::close(child->pidFd);
+#endif
+    delete child->process;
+    delete child;
+  }
+  deleteRemovedChildren();
+#ifndef _WIN32
+  if(signalFd >= 0)
+    ::close(signalFd);
+  if(eventFd >= 0)
+    ::close(eventFd);
+  if(epollFd >= 0)
+    ::close(epollFd);
+#endif
+}
+
+bool_t ProcessManager::start(Callback& callback, int64_t usageInterval)
 {
   this->callback = &callback;
+  this->usageInterval = usageInterval;
+  nextUsageTime = Time::ticks() + usageInterval;
+#ifndef _WIN32
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+  eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if(epollFd < 0 || eventFd < 0)
+    return error = Error::getErrorString(), false;
+  epoll_event event;
+  event.events = EPOLLIN;
+  event.data.ptr = &eventFd;
+  if(epoll_ctl(epollFd, EPOLL_CTL_ADD, eventFd, &event) != 0)
+    return error = Error::getErrorString(), false;
+
+  // use a signalfd for SIGCHLD when the kernel does not support pidfds, the signal is blocked before the thread is started so that it inherits the mask
+  // (launch() unblocks it while a child is started, since the child would inherit the mask as well)
+  int_t pidFd = (int_t)syscall(SYS_pidfd_open, getpid(), 0);
+  if(pidFd >= 0)
+    ::close(pidFd);
+  else
+  {
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    pthread_sigmask(SIG_BLOCK, &mask, 0);
+    signalFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if(signalFd < 0)
+      return error = Error::getErrorString(), false;
+    event.data.ptr = &signalFd;
+    if(epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &event) != 0)
+      return error = Error::getErrorString(), false;
+  }
+#endif
   if(!thread.start(proc, this))
-    return false;
+    return error = Error::getErrorString(), false;
   return true;
 }
 
 void_t ProcessManager::stop()
 {
-  mutex.lock();
-  Action& action = actions.append(Action());
+  Action action;
   action.type = Action::quitType;
-  mutex.unlock();
-  Process::interrupt();
+  pushAction(action);
   thread.join();
 }
 
-void_t ProcessManager::startProcess(uint64_t id, const String& commandLine)
+void_t ProcessManager::startProcess(uint64_t id, const String& commandLine, const RestartPolicy& restartPolicy,
+  const ResourceLimits& resourceLimits, const SchedulingProfile& schedulingProfile)
 {
-  mutex.lock();
-  Action& action = actions.append(Action());
+  Action action;
   action.type = Action::startType;
   action.commandLine = commandLine;
   action.id = id;
-  mutex.unlock();
-  Process::interrupt();
+  action.restartPolicy = restartPolicy;
+  action.resourceLimits = resourceLimits;
+  action.schedulingProfile = schedulingProfile;
+  pushAction(action);
 }
 
 void_t ProcessManager::setProcessId(uint64_t id, uint64_t newId)
 {
   if(id == newId)
     return;
-  mutex.lock();
-  HashMap<uint64_t, Process*>::Iterator it = processesByIdMap.find(id);
-  if(it == processesByIdMap.end())
-  {
-    mutex.unlock();
-    return;
-  }
-  Process* process = *it;
-  idsByProcessMap.append(process, newId);
-  processesByIdMap.append(newId, process);
-  processesByIdMap.remove(it);
-  mutex.unlock();
+  Action action;
+  action.type = Action::setIdType;
+  action.id = id;
+  action.newId = newId;
+  pushAction(action);
 }
 
 void_t ProcessManager::killProcess(uint64_t id)
 {
-  mutex.lock();
-  Action& action = actions.append(Action());
+  Action action;
   action.type = Action::killType;
   action.id = id;
-  mutex.unlock();
+  pushAction(action);
+}
+
+void_t ProcessManager::pushAction(const Action& action)
+{
+  // the thread of the process manager never waits for its callback, so the queue is drained eventually
+  while(!actions.push(action))
+  {
+    wakeUp();
+    Thread::yield();
+  }
+  wakeUp();
+}
+
+void_t ProcessManager::wakeUp()
+{
+  if(__atomic_exchange_n(&wakeUpPending, 1, __ATOMIC_SEQ_CST) != 0)
+    return;
+#ifdef _WIN32
   Process::interrupt();
+#else
+  uint64_t value = 1;
+  if(::write(eventFd, &value, sizeof(value)) < 0) {}
+#endif
 }
 
 uint_t ProcessManager::proc()
 {
+#ifdef _WIN32
+  // Process::wait cannot time out, so restarts are not delayed here
   for(;;)
   {
     Process* process = Process::wait(processes, processes.size());
     if(process)
     {
-      HashMap<Process*, uint64_t>::Iterator it = idsByProcessMap.find(process);
-      if(it != idsByProcessMap.end())
+      HashMap<Process*, Child*>::Iterator it = childrenByProcess.find(process);
+      if(it != childrenByProcess.end())
+        handleTermination(**it);
+    }
+    else if(!handleActions())
+      return 0;
+    deleteRemovedChildren();
+    restartChildren();
+    reportTerminations();
+  }
+#else
+  epoll_event events[64];
+  for(;;)
+  {
+    int64_t timeout = restartChildren();
+    int64_t usageTimeout = sampleUsage();
+    if(timeout < 0 || usageTimeout < timeout)
+      timeout = usageTimeout;
+    if(!reportTerminations() && (timeout < 0 || timeout > 10))
+      timeout = 10;
+    if(checkTerminations)
+    {
+      // a SIGCHLD may have been lost while it was unblocked by launch()
+      checkTerminations = false;
+      handleTerminations();
+      continue;
+    }
+    int_t count = epoll_wait(epollFd, events, sizeof(events) / sizeof(*events), (int_t)timeout);
+    if(count < 0)
+    {
+      if(errno == EINTR)
+        continue;
+      Log::errorf("Could not wait for processes: %s", (const char_t*)Error::getErrorString());
+      Thread::sleep(1000);
+      continue;
+    }
+    for(int_t i = 0; i < count; ++i)
+    {
+      void_t* ptr = events[i].data.ptr;
+      if(ptr == &eventFd)
+      {
+        uint64_t value;
+        if(::read(eventFd, &value, sizeof(value)) < 0) {}
+        if(!handleActions())
+          return 0;
+      }
+      else if(ptr == &signalFd)
       {
-        Log::infof("reaped process %d", process->getProcessId());
-        uint64_t processEntityId = *it;
-        callback->terminatedProcess(processEntityId);
-        idsByProcessMap.remove(it);
-        processesByIdMap.remove(processEntityId);
-        Array<Process*>::Iterator it2 = processes.find(process);
-        if(it2 != processes.end())
-          processes.remove(it2);
-        delete process;
+        signalfd_siginfo info;
+        while(::read(signalFd, &info, sizeof(info)) == sizeof(info));
+        handleTerminations();
       }
+      else
+        handleTermination(*(Child*)ptr); // the child is still allocated, since removed children are deleted after the batch
     }
-    else
+    deleteRemovedChildren();
+  }
+#endif
+  return 0;
+}
+
+#ifndef _WIN32
+void_t ProcessManager::closePidFd(Child& child)
+{
+  if(child.pidFd < 0)
+    return;
+  // closing the pidfd does not remove it from the epoll set while a process that is being started holds a copy of it
+  epoll_ctl(epollFd, EPOLL_CTL_DEL, child.pidFd, 0);
+  ::close(child.pidFd);
+  child.pidFd = -1;
+}
+
+void_t ProcessManager::handleTerminations()
+{
+  // find the children that have terminated without reaping them, they are reaped when their process objects are joined
+  Array<Child*> terminatedChildren;
+  for(HashMap<uint64_t, Child*>::Iterator i = children.begin(), end = children.end(); i != end; ++i)
+  {
+    Child* child = *i;
+    if(!child->process)
+      continue;
+    siginfo_t childInfo;
+    childInfo.si_pid = 0;
+    if(waitid(P_PID, child->process->getProcessId(), &childInfo, WEXITED | WNOHANG | WNOWAIT) == 0 && childInfo.si_pid != 0)
+      terminatedChildren.append(child);
+  }
+  for(Array<Child*>::Iterator i = terminatedChildren.begin(), end = terminatedChildren.end(); i != end; ++i)
+    handleTermination(**i);
+}
+#endif
+
+bool_t ProcessManager::handleActions()
+{
+  __atomic_store_n(&wakeUpPending, 0, __ATOMIC_SEQ_CST);
+  Action action;
+  while(actions.pop(action))
+  {
+    switch(action.type)
     {
-      for(;;)
+    case Action::quitType:
+      return false;
+    case Action::startType:
       {
-        mutex.lock();
-        if(actions.isEmpty())
+        Child* child = new Child;
+        child->id = action.id;
+        child->commandLine = action.commandLine;
+        child->restartPolicy = action.restartPolicy;
+        child->resourceLimits = action.resourceLimits;
+        child->schedulingProfile = action.schedulingProfile;
+        child->process = 0;
+        child->pidFd = -1;
+        child->restartTime = 0;
+        child->restartDelay = 0;
+        child->crashLoopStart = 0;
+        child->crashLoopRestarts = 0;
+        children.append(action.id, child);
+        if(!launch(*child))
         {
-          mutex.unlock();
-          break;
+          Log::infof("could not launch: %s", (const char_t*)action.commandLine);
+          removeChild(*child);
         }
-        Action& action = actions.front();
-        switch(action.type)
-        {
-        case Action::quitType:
-          actions.removeFront();
-          mutex.unlock();
-          return 0;
-        case Action::startType:
-          {
-            Process* process = new Process();
-            if(!process->start(action.commandLine))
-            {
-              Log::infof("could not launch: %s", (const char_t*)action.commandLine);
-              callback->terminatedProcess(action.id);
-              delete process;
-            }
-            else
-            {
-              Log::infof("started process %u: %s", process->getProcessId(), (const char_t*)action.commandLine);
-              processes.append(process);
-              idsByProcessMap.append(process, action.id);
-              processesByIdMap.append(action.id, process);
-            }
-          }
+      }
+      break;
+    case Action::killType:
+      {
+        HashMap<uint64_t, Child*>::Iterator it = children.find(action.id);
+        if(it == children.end())
           break;
-        case Action::killType:
+        Child* child = *it;
+        if(child->process)
+        {
+          uint32_t pid = child->process->getProcessId();
+#ifdef _WIN32
+          Process* process = child->process;
+#else
+          closePidFd(*child);
+#endif
+          if(!child->process->kill())
           {
-            HashMap<uint64_t, Process*>::Iterator it = processesByIdMap.find(action.id);
-            if(it == processesByIdMap.end())
-              break;
-            process = *it;
-            Array<Process*>::Iterator it2 = processes.find(process);
-            if(it2 != processes.end())
-            {
-              uint32_t pid = process->getProcessId();
-              if(process->kill())
-              {
-                Log::infof("killed process %u", pid);
-                callback->terminatedProcess(action.id);
-                processes.remove(it2);
-                processesByIdMap.remove(it);
-                idsByProcessMap.remove(process);
-                delete process;
-              }
-              else
-              {
-                Log::infof("could not kill process %u", pid);
-              }
-            }
+            Log::infof("could not kill process %u", pid);
             break;
           }
+          Log::infof("killed process %u", pid);
+#ifdef _WIN32
+          processes.remove(processes.find(process));
+          childrenByProcess.remove(process);
+#endif
+          delete child->process;
+          child->process = 0;
         }
-        actions.removeFront();
-        mutex.unlock();
+        removeChild(*child);
+      }
+      break;
+    case Action::setIdType:
+      {
+        HashMap<uint64_t, Child*>::Iterator it = children.find(action.id);
+        if(it == children.end())
+          break;
+        Child* child = *it;
+        child->id = action.newId;
+        children.remove(it);
+        children.append(action.newId, child);
       }
+      break;
     }
   }
-  return 0;
+  return true;
+}
+
+bool_t ProcessManager::launch(Child& child)
+{
+  Process* process = new Process();
+#ifndef _WIN32
+  // the child inherits the signal mask of this thread, so SIGCHLD must not be blocked while it is started
+  sigset_t mask;
+  if(signalFd >= 0)
+  {
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    pthread_sigmask(SIG_UNBLOCK, &mask, 0);
+  }
+#endif
+  bool_t started = process->start(child.commandLine);
+#ifndef _WIN32
+  if(signalFd >= 0)
+  {
+    pthread_sigmask(SIG_BLOCK, &mask, 0);
+    checkTerminations = true;
+  }
+#endif
+  if(!started)
+  {
+    delete process;
+    return false;
+  }
+  Log::infof("started process %u: %s", process->getProcessId(), (const char_t*)child.commandLine);
+  child.process = process;
+  child.startTime = Time::ticks();
+#ifdef _WIN32
+  processes.append(process);
+  childrenByProcess.append(process, &child);
+#else
+  applyResourceLimits(child);
+  applySchedulingProfile(child);
+  if(signalFd < 0)
+  {
+    child.pidFd = (int_t)syscall(SYS_pidfd_open, process->getProcessId(), 0);
+    if(child.pidFd < 0)
+    {
+      Log::errorf("Could not open pidfd of process %u: %s", process->getProcessId(), (const char_t*)Error::getErrorString());
+      return true; // the process is left running, but it is not supervised
+    }
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = &child;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, child.pidFd, &event);
+  }
+#endif
+  return true;
+}
+
+void_t ProcessManager::handleTermination(Child& child)
+{
+  Process* process = child.process;
+  if(!process)
+    return;
+  uint32_t pid = process->getProcessId();
+  uint32_t exitCode = 0;
+  process->join(exitCode);
+#ifdef _WIN32
+  processes.remove(processes.find(process));
+  childrenByProcess.remove(process);
+#else
+  closePidFd(child);
+#endif
+  delete process;
+  child.process = 0;
+
+  if(!child.restartPolicy.restart)
+  {
+    Log::infof("reaped process %u", pid);
+    removeChild(child);
+    return;
+  }
+
+  // delay the restart exponentially if the process did not run for long
+  int64_t now = Time::ticks();
+  const RestartPolicy& policy = child.restartPolicy;
+  if(now - child.startTime >= policy.stableTime)
+    child.restartDelay = 0;
+  else
+    child.restartDelay = child.restartDelay == 0 ? initialRestartDelay : child.restartDelay * 2;
+  if(child.restartDelay > policy.maxDelay)
+    child.restartDelay = policy.maxDelay;
+
+  // give up the process when it keeps crashing
+  if(now - child.crashLoopStart > policy.crashLoopTime)
+  {
+    child.crashLoopStart = now;
+    child.crashLoopRestarts = 0;
+  }
+  if(++child.crashLoopRestarts > policy.maxRestarts)
+  {
+    Log::errorf("process %u terminated with exit code %u and was restarted %u times within %lld s, giving up: %s", pid, exitCode,
+      policy.maxRestarts, policy.crashLoopTime / 1000, (const char_t*)child.commandLine);
+    removeChild(child);
+    return;
+  }
+
+#ifdef _WIN32
+  child.restartDelay = 0;
+#endif
+  Log::infof("process %u terminated with exit code %u, restarting in %lld ms: %s", pid, exitCode, child.restartDelay, (const char_t*)child.commandLine);
+  child.restartTime = now + child.restartDelay;
+}
+
+void_t ProcessManager::removeChild(Child& child)
+{
+  uint64_t id = child.id;
+  children.remove(id);
+  removedChildren.append(&child); // an event of the current epoll batch may still refer to the child
+  if(!unreportedProcesses.isEmpty() || !callback->terminatedProcess(id))
+    unreportedProcesses.append(id);
+}
+
+void_t ProcessManager::deleteRemovedChildren()
+{
+  for(Array<Child*>::Iterator i = removedChildren.begin(), end = removedChildren.end(); i != end; ++i)
+    delete *i;
+  removedChildren.clear();
+}
+
+bool_t ProcessManager::reportTerminations()
+{
+  while(!unreportedProcesses.isEmpty())
+  {
+    if(!callback->terminatedProcess(unreportedProcesses.front()))
+      return false;
+    unreportedProcesses.removeFront();
+  }
+  return true;
+}
+
+int64_t ProcessManager::restartChildren()
+{
+  int64_t now = Time::ticks();
+  int64_t timeout = -1;
+  Array<Child*> dueChildren;
+  for(HashMap<uint64_t, Child*>::Iterator i = children.begin(), end = children.end(); i != end; ++i)
+  {
+    Child* child = *i;
+    if(child->process)
+      continue;
+    int64_t wait = child->restartTime - now;
+    if(wait <= 0)
+      dueChildren.append(child);
+    else if(timeout < 0 || wait < timeout)
+      timeout = wait;
+  }
+  for(Array<Child*>::Iterator i = dueChildren.begin(), end = dueChildren.end(); i != end; ++i)
+  {
+    Child& child = **i;
+    if(!launch(child))
+    {
+      Log::errorf("could not restart: %s", (const char_t*)child.commandLine);
+      removeChild(child);
+    }
+  }
+  return timeout;
+}
+
+#ifndef _WIN32
+void_t ProcessManager::applyResourceLimits(Child& child)
+{
+  const ResourceLimits& limits = child.resourceLimits;
+  uint32_t pid = child.process->getProcessId();
+  if(limits.memory)
+  {
+    rlimit limit;
+    limit.rlim_cur = limit.rlim_max = (rlim_t)limits.memory;
+    if(prlimit((pid_t)pid, RLIMIT_AS, &limit, 0) != 0)
+      Log::warningf("Could not limit memory of process %u: %s", pid, (const char_t*)Error::getErrorString());
+  }
+}
+
+void_t ProcessManager::applySchedulingProfile(Child& child)
+{
+  const SchedulingProfile& profile = child.schedulingProfile;
+  if(profile.policy == SchedulingProfile::otherPolicy && profile.nice == 0 && profile.cpuMask == 0 && profile.ioClass == SchedulingProfile::noIoClass)
+    return;
+  uint32_t pid = child.process->getProcessId();
+
+  cpu_set_t cpus;
+  if(profile.cpuMask)
+  {
+    CPU_ZERO(&cpus);
+    for(uint_t i = 0; i < 64; ++i)
+      if(profile.cpuMask & (1ULL << i))
+        CPU_SET(i, &cpus);
+  }
+
+  // the scheduling attributes belong to the threads, so the profile is applied to every thread that the process has
+  // already created, threads that are created later inherit it
+  char_t path[64];
+  snprintf(path, sizeof(path), "/proc/%u/task", pid);
+  DIR* dir = opendir(path);
+  if(!dir)
+    return;
+  bool_t fifoFailed = false;
+  String error;
+  while(dirent* entry = readdir(dir))
+  {
+    if(*entry->d_name == '.')
+      continue;
+    pid_t tid = (pid_t)String::toUInt64(entry->d_name);
+
+    int_t nice = profile.nice;
+    if(profile.policy == SchedulingProfile::fifoPolicy && !fifoFailed)
+    {
+      sched_param param;
+      param.sched_priority = profile.priority;
+      if(sched_setscheduler(tid, SCHED_FIFO, &param) == 0)
+        nice = 0;
+      else
+        fifoFailed = true;
+    }
+    else if(profile.policy == SchedulingProfile::idlePolicy)
+    {
+      sched_param param;
+      param.sched_priority = 0;
+      if(sched_setscheduler(tid, SCHED_IDLE, &param) != 0)
+        error = String("sched_setscheduler: ") + Error::getErrorString();
+    }
+    if(nice && setpriority(PRIO_PROCESS, (id_t)tid, nice) != 0)
+      error = String("setpriority: ") + Error::getErrorString();
+    if(profile.cpuMask && sched_setaffinity(tid, sizeof(cpus), &cpus) != 0)
+      error = String("sched_setaffinity: ") + Error::getErrorString();
+    if(profile.ioClass != SchedulingProfile::noIoClass &&
+      syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, (int_t)tid, ((int_t)profile.ioClass << IOPRIO_CLASS_SHIFT) | profile.ioPriority) != 0)
+      error = String("ioprio_set: ") + Error::getErrorString();
+  }
+  closedir(dir);
+  if(fifoFailed)
+    Log::infof("Could not use real-time scheduling for process %u, using nice value %d instead", pid, profile.nice);
+  if(!error.isEmpty())
+    Log::warningf("Could not apply scheduling profile to process %u: %s", pid, (const char_t*)error);
+}
+
+int64_t ProcessManager::sampleUsage()
+{
+  int64_t now = Time::ticks();
+  if(now < nextUsageTime)
+    return nextUsageTime - now;
+  nextUsageTime = now + usageInterval;
+
+  // a process that has terminated but was not reaped yet is skipped
+  Array<Usage> usage;
+  usage.reserve(children.size());
+  Usage childUsage;
+  for(HashMap<uint64_t, Child*>::Iterator i = children.begin(), end = children.end(); i != end; ++i)
+  {
+    Child* child = *i;
+    if(!child->process)
+      continue;
+    childUsage.id = child->id;
+    childUsage.pid = child->process->getProcessId();
+    if(readUsage(childUsage.pid, childUsage))
+      usage.append(childUsage);
+  }
+  if(!usage.isEmpty())
+    callback->sampledUsage(usage);
+  return usageInterval;
+}
+
+static bool_t readProcFile(uint32_t pid, const char_t* name, char_t* buffer, size_t size)
+{
+  char_t path[64];
+  snprintf(path, sizeof(path), "/proc/%u/%s", pid, name);
+  int_t fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if(fd < 0)
+    return false;
+  ssize_t length = ::read(fd, buffer, size - 1);
+  ::close(fd);
+  if(length < 0)
+    return false;
+  buffer[length] = '\0';
+  return true;
+}
+
+static uint64_t getProcField(const char_t* buffer, const char_t* name)
+{
+  const char_t* pos = String::find(buffer, name);
+  if(!pos)
+    return 0;
+  pos += String::length(name);
+  while(*pos == ' ' || *pos == '\t')
+    ++pos;
+  return String::toUInt64(pos);
+}
+
+bool_t ProcessManager::readUsage(uint32_t pid, Usage& usage)
+{
+  char_t buffer[4096];
+
+  // the fields of the stat file follow the command name in parentheses, utime and stime are the 14th and 15th field
+  if(!readProcFile(pid, "stat", buffer, sizeof(buffer)))
+    return false;
+  const char_t* fields = strrchr(buffer, ')');
+  unsigned long long userTime, systemTime;
+  if(!fields || sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &userTime, &systemTime) != 2)
+    return false;
+  static const uint64_t ticksPerSecond = sysconf(_SC_CLK_TCK);
+  usage.cpuTime = (userTime + systemTime) * 1000 / ticksPerSecond;
+
+  if(!readProcFile(pid, "status", buffer, sizeof(buffer)))
+    return false;
+  usage.residentMemory = getProcField(buffer, "\nVmRSS:") * 1024;
+  usage.voluntaryContextSwitches = getProcField(buffer, "\nvoluntary_ctxt_switches:");
+  usage.involuntaryContextSwitches = getProcField(buffer, "\nnonvoluntary_ctxt_switches:");
+
+  // the io file is missing when the kernel was built without task io accounting
+  if(readProcFile(pid, "io", buffer, sizeof(buffer)))
+  {
+    usage.readBytes = getProcField(buffer, "\nread_bytes:");
+    usage.writtenBytes = getProcField(buffer, "\nwrite_bytes:");
+  }
+  else
+    usage.readBytes = usage.writtenBytes = 0;
+  return true;
 }
+#endif
@@ -3,28 +3,130 @@
 
 #include <nstd/String.h>
 #include <nstd/Thread.h>
-#include <nstd/Mutex.h>
 #include <nstd/List.h>
 #include <nstd/Array.h>
+#include <nstd/HashMap.h>
+
+#include "MpscQueue.h"
 
 class Process;
 
+/**
+* Starts and supervises child processes in a dedicated thread. On Linux the thread waits in an epoll loop for the pidfds
+* of the children and for an eventfd that signals new actions. Kernels without pidfd support are handled with a signalfd
+* for SIGCHLD. Actions are passed to the thread through a lock-free queue. The thread also samples the resource usage of the children from /proc in a fixed interval.
+*/
 class ProcessManager
 {
 public:
+  struct Usage;
+
   class Callback
   {
   public:
-    virtual void_t terminatedProcess(uint64_t entityId) = 0;
+    /**
+    * Is called from the thread of the process manager when a process has terminated and will not be restarted.
+    * @return \c false when the termination could not be handled now. The call is repeated a little later.
+    */
+    virtual bool_t terminatedProcess(uint64_t entityId) = 0;
+
+    /**
+    * Is called from the thread of the process manager with the resource usage of all running processes.
+    */
+    virtual void_t sampledUsage(const Array<Usage>& usage) = 0;
+  };
+
+  /**
+  * Describes whether a process is restarted when it terminates without being killed. A process that was running for a
+  * while is restarted immediately. The restarts of a process that terminates soon after being started are delayed
+  * exponentially and the process is given up when it is restarted too often.
+  */
+  struct RestartPolicy
+  {
+    bool_t restart;
+    int64_t maxDelay; // the maximum delay of a restart in milliseconds
+    int64_t stableTime; // the time in milliseconds after which a running process is not considered crashing
+    uint_t maxRestarts; // the maximum amount of restarts within the crash loop time
+    int64_t crashLoopTime; // in milliseconds
+
+    RestartPolicy(bool_t restart = false, int64_t maxDelay = 60 * 1000, int64_t stableTime = 60 * 1000, uint_t maxRestarts = 10, int64_t crashLoopTime = 10 * 60 * 1000) :
+      restart(restart), maxDelay(maxDelay), stableTime(stableTime), maxRestarts(maxRestarts), crashLoopTime(crashLoopTime) {}
+  };
+
+  /**
+  * Limits the resources of a process. The limits are applied right after the process was started and again after
+  * each restart.
+  */
+  struct ResourceLimits
+  {
+    uint64_t memory; // the maximum size of the address space in bytes or 0
+
+    ResourceLimits(uint64_t memory = 0) : memory(memory) {}
+  };
+
+  /**
+  * Describes how the cpu and the disk are shared between a process and the other processes. The profile is applied to
+  * all threads of the process right after it was started and again after each restart. A real-time policy that is not
+  * permitted falls back to the nice value.
+  */
+  struct SchedulingProfile
+  {
+    enum Policy
+    {
+      otherPolicy,
+      fifoPolicy, // requires CAP_SYS_NICE or an RLIMIT_RTPRIO
+      idlePolicy,
+    };
+
+    enum IoClass // matches the io priority classes of the kernel
+    {
+      noIoClass,
+      realtimeIoClass, // requires CAP_SYS_ADMIN
+      bestEffortIoClass,
+      idleIoClass,
+    };
+
+    Policy policy;
+    int_t priority; // the real-time priority of the fifo policy from 1 to 99
+    int_t nice; // the nice value of the other policy, a negative value requires CAP_SYS_NICE
+    uint64_t cpuMask; // the cpus the process may run on or 0 for all cpus
+    IoClass ioClass;
+    int_t ioPriority; // the priority within the io class from 0 (highest) to 7
+
+    SchedulingProfile(Policy policy = otherPolicy, int_t priority = 0, int_t nice = 0, uint64_t cpuMask = 0, IoClass ioClass = noIoClass, int_t ioPriority = 0) :
+      policy(policy), priority(priority), nice(nice), cpuMask(cpuMask), ioClass(ioClass), ioPriority(ioPriority) {}
+  };
+
+  /**
+  * The resource usage of a process since it was started.
+  */
+  struct Usage
+  {
+    uint64_t id;
+    uint32_t pid;
+    uint64_t cpuTime; // user and system time in milliseconds
+    uint64_t residentMemory; // in bytes
+    uint64_t readBytes;
+    uint64_t writtenBytes;
+    uint64_t voluntaryContextSwitches;
+    uint64_t involuntaryContextSwitches;
   };
 
 public:
+  ProcessManager();
+  ~ProcessManager();
+
   const String& getErrorString() const {return error;}
 
-  bool_t start(Callback& callback);
+  /**
+  * @param callback The callback that receives the terminated processes and the resource usage.
+  * @param usageInterval The time in milliseconds between two samples of the resource usage.
+  */
+  bool_t start(Callback& callback, int64_t usageInterval = 60 * 1000);
   void_t stop();
 
-  void_t startProcess(uint64_t id, const String& commandLine);
+  void_t startProcess(uint64_t id, const String& commandLine, const RestartPolicy& restartPolicy = RestartPolicy(),
+    const ResourceLimits& resourceLimits = ResourceLimits(), const SchedulingProfile& schedulingProfile = SchedulingProfile());
   void_t setProcessId(uint64_t id, uint64_t newId);
   void_t killProcess(uint64_t id);
 
@@ -35,24 +137,74 @@ private:
     {
       startType,
       killType,
+      setIdType,
       quitType,
     } type;
     String commandLine;
     uint64_t id;
+    uint64_t newId;
+    RestartPolicy restartPolicy;
+    ResourceLimits resourceLimits;
+    SchedulingProfile schedulingProfile;
+  };
+
+  struct Child
+  {
+    uint64_t id;
+    String commandLine;
+    RestartPolicy restartPolicy;
+    ResourceLimits resourceLimits;
+    SchedulingProfile schedulingProfile;
+    Process* process;
+    int_t pidFd;
+    int64_t startTime;
+    int64_t restartTime;
+    int64_t restartDelay;
+    int64_t crashLoopStart;
+    uint_t crashLoopRestarts;
   };
 
 private:
   String error;
   Thread thread;
   Callback* callback;
+  int64_t usageInterval;
+  int64_t nextUsageTime;
 
-  Mutex mutex;
-  List<Action> actions;
+  MpscQueue<Action, 1024> actions;
+  uint32_t wakeUpPending;
+  HashMap<uint64_t, Child*> children;
+  Array<Child*> removedChildren;
+  List<uint64_t> unreportedProcesses;
+#ifdef _WIN32
   Array<Process*> processes;
-  HashMap<Process*, uint64_t> idsByProcessMap;
-  HashMap<uint64_t, Process*> processesByIdMap;
+  HashMap<Process*, Child*> childrenByProcess;
+#else
+  int_t epollFd;
+  int_t eventFd;
+  int_t signalFd;
+  bool_t checkTerminations;
+#endif
 
 private:
   static uint_t proc(void_t* param) {return ((ProcessManager*)param)->proc();}
   uint_t proc();
+
+  void_t pushAction(const Action& action);
+  void_t wakeUp();
+  bool_t handleActions();
+  bool_t launch(Child& child);
+  void_t handleTermination(Child& child);
+  void_t removeChild(Child& child);
+  void_t deleteRemovedChildren();
+  bool_t reportTerminations();
+  int64_t restartChildren();
+#ifndef _WIN32
+  void_t applyResourceLimits(Child& child);
+  void_t applySchedulingProfile(Child& child);
+  void_t closePidFd(Child& child);
+  void_t handleTerminations();
+  int64_t sampleUsage();
+  static bool_t readUsage(uint32_t pid, Usage& usage);
+#endif
 };
@@ -0,0 +1,55 @@
+
+#pragma once
+
+#include <zlimdbclient.h>
+
+/**
+* The entities and control codes of the server that are not part of megucoprotocol.h.
+*/
+
+#pragma pack(push, 1)
+/**
+* The entity of the process statistics table ("processes/stats"). A sample of the resource usage of a process is
+* added periodically.
+*/
+struct meguco_process_stats_entity
+{
+  zlimdb_entity entity;
+  uint64_t process_id; // the id of the process in the processes table
+  uint32_t pid;
+  uint64_t cpu_time; // in milliseconds
+  uint64_t resident_memory;
+  uint64_t read_bytes;
+  uint64_t written_bytes;
+  uint64_t voluntary_context_switches;
+  uint64_t involuntary_context_switches;
+};
+#pragma pack(pop)
+
+/**
+* The control codes of the users table that start or stop several sessions of a user with one request.
+*/
+enum meguco_user_bulk_control
+{
+  meguco_user_control_start_sessions = 0x100,
+  meguco_user_control_stop_sessions,
+};
+
+enum meguco_user_sessions_flag
+{
+  meguco_user_sessions_flag_none = 0x00,
+  meguco_user_sessions_flag_shared_process = 0x01, // run simulations in shared bot processes, the sessions of a process are stopped together
+};
+
+#pragma pack(push, 1)
+/**
+* The arguments of the bulk control requests. They are followed by \c count session ids. The response contains a
+* zlimdb error code for each session, or 0 when the session was started or stopped.
+*/
+struct meguco_user_sessions_control
+{
+  uint8_t mode; // the mode of the started sessions
+  uint8_t flags;
+  uint16_t count;
+};
+#pragma pack(pop)
@@ -0,0 +1,46 @@
+
+#include <nstd/Math.h>
+
+#include "RateLimiter.h"
+
+bool_t RateLimiter::tryAcquire(Priority priority, int64_t now, int64_t& wait)
+{
+  // refill the token bucket
+  if(now > lastTime)
+  {
+    if(lastTime != 0)
+    {
+      tokens += (double)(now - lastTime) / (double)interval;
+      if(tokens > (double)burst)
+        tokens = (double)burst;
+    }
+    lastTime = now;
+  }
+
+  // forget requests that left the sliding window
+  while(!requestTimes.isEmpty() && requestTimes.front() <= now - window)
+    requestTimes.removeFront();
+
+  // check the budget of the priority class
+  wait = 0;
+  double requiredTokens = 1. + (double)(burstReserve * (uint_t)priority);
+  if(tokens < requiredTokens)
+    wait = (int64_t)Math::ceil((requiredTokens - tokens) * (double)interval);
+  size_t windowBudget = windowLimit - windowReserve * (uint_t)priority;
+  if(requestTimes.size() >= windowBudget)
+  {
+    size_t expiring = requestTimes.size() - windowBudget;
+    List<int64_t>::Iterator i = requestTimes.begin();
+    for(size_t j = 0; j < expiring; ++j)
+      ++i;
+    int64_t windowWait = *i + window - now;
+    if(windowWait > wait)
+      wait = windowWait;
+  }
+  if(wait > 0)
+    return false;
+
+  tokens -= 1.;
+  requestTimes.append(now);
+  return true;
+}
@@ -0,0 +1,53 @@
+
+#pragma once
+
+#include <nstd/List.h>
+
+/**
+* Schedules requests to a rate limited api using a token bucket that allows short bursts and a
+* sliding window that limits the number of requests within a longer period. Part of the budget is
+* reserved for requests of higher priority so that they do not have to wait for requests of lower priority.
+*/
+class RateLimiter
+{
+public:
+  enum Priority
+  {
+    highPriority,
+    normalPriority,
+    lowPriority
+  };
+
+public:
+  /**
+  * @param burst The capacity of the token bucket.
+  * @param interval The time in milliseconds in which the token bucket gains a token.
+  * @param windowLimit The maximum amount of requests within the sliding window.
+  * @param window The length of the sliding window in milliseconds.
+  * @param burstReserve The amount of tokens reserved for each higher priority class.
+  * @param windowReserve The amount of requests within the sliding window reserved for each higher priority class.
+  */
+  RateLimiter(uint_t burst, int64_t interval, uint_t windowLimit, int64_t window, uint_t burstReserve, uint_t windowReserve) :
+    burst(burst), interval(interval), windowLimit(windowLimit), window(window), burstReserve(burstReserve), windowReserve(windowReserve),
+    tokens(burst), lastTime(0) {}
+
+  /**
+  * Takes a request from the budget if it is available.
+  * @param priority The priority of the request.
+  * @param now The current time in milliseconds.
+  * @param wait Receives the time in milliseconds after which the request should be tried again.
+  * @return \c true when the request can be made now
+  */
+  bool_t tryAcquire(Priority priority, int64_t now, int64_t& wait);
+
+private:
+  uint_t burst;
+  int64_t interval;
+  uint_t windowLimit;
+  int64_t window;
+  uint_t burstReserve;
+  uint_t windowReserve;
+  double tokens;
+  int64_t lastTime;
+  List<int64_t> requestTimes;
+};
@@ -16,6 +16,19 @@ This code is based on public domain code from Wei Dai's Crypto++ library. */
 
 #endif
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHA256_X86_SHA
+#include <immintrin.h>
+#include <cpuid.h>
+#elif defined(__GNUC__) && defined(__linux__) && (defined(__aarch64__) || \
+  (defined(__arm__) && !defined(__clang__) && __GNUC__ >= 8 && defined(__ARM_ARCH) && __ARM_ARCH >= 7 && !defined(__SOFTFP__)))
+/* on 32-bit arm the crypto extension is only enabled for the accelerated transform, so the binary still runs
+   on cpus without it */
+#define SHA256_ARM_SHA
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#endif
+
 #define SHA256_DIGEST_SIZE 32
 
 typedef unsigned int UInt32;
@@ -165,34 +178,172 @@ static void Sha256_Transform(UInt32 *state, const UInt32 *data)
 #undef s0
 #undef s1
 
-static void Sha256_WriteByteBlock(CSha256 *p)
+static void Sha256_TransformBlocks(UInt32 *state, const Byte *data, size_t blocks)
 {
   UInt32 data32[16];
   unsigned i;
-  for (i = 0; i < 16; i++)
-    data32[i] =
-      ((UInt32)(p->buffer[i * 4    ]) << 24) +
-      ((UInt32)(p->buffer[i * 4 + 1]) << 16) +
-      ((UInt32)(p->buffer[i * 4 + 2]) <<  8) +
-      ((UInt32)(p->buffer[i * 4 + 3]));
-  Sha256_Transform(p->state, data32);
+  for (; blocks > 0; blocks--, data += 64)
+  {
+    for (i = 0; i < 16; i++)
+      data32[i] =
+        ((UInt32)(data[i * 4    ]) << 24) +
+        ((UInt32)(data[i * 4 + 1]) << 16) +
+        ((UInt32)(data[i * 4 + 2]) <<  8) +
+        ((UInt32)(data[i * 4 + 3]));
+    Sha256_Transform(state, data32);
+  }
+}
+
+#ifdef SHA256_X86_SHA
+
+__attribute__((target("sha,sse4.1")))
+static void Sha256_TransformBlocksShaNi(UInt32 *state, const Byte *data, size_t blocks)
+{
+  const __m128i byteSwapMask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[0]), 0xB1); /* CDAB */
+  __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[4]), 0x1B); /* EFGH */
+  __m128i state0 = _mm_alignr_epi8(tmp, state1, 8); /* ABEF */
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0); /* CDGH */
+
+  for (; blocks > 0; blocks--, data += 64)
+  {
+    __m128i abefSave = state0;
+    __m128i cdghSave = state1;
+    __m128i w[4];
+    unsigned i;
+    for (i = 0; i < 4; i++)
+      w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + i * 16)), byteSwapMask);
+    for (i = 0; i < 16; i++)
+    {
+      __m128i msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i*)&K[i * 4]));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+      if (i < 12)
+      {
+        /* w[i + 4] = s1(w[i + 2]) + w[i + 9] + s0(w[i + 1]) + w[i] for four words at once */
+        tmp = _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4);
+        w[i & 3] = _mm_add_epi32(_mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]), tmp);
+        w[i & 3] = _mm_sha256msg2_epu32(w[i & 3], w[(i + 3) & 3]);
+      }
+    }
+    state0 = _mm_add_epi32(state0, abefSave);
+    state1 = _mm_add_epi32(state1, cdghSave);
+  }
+
+  tmp = _mm_shuffle_epi32(state0, 0x1B); /* FEBA */
+  state1 = _mm_shuffle_epi32(state1, 0xB1); /* DCHG */
+  _mm_storeu_si128((__m128i*)&state[0], _mm_blend_epi16(tmp, state1, 0xF0)); /* DCBA */
+  _mm_storeu_si128((__m128i*)&state[4], _mm_alignr_epi8(state1, tmp, 8)); /* ABEF */
+}
+
+#endif
+
+#ifdef SHA256_ARM_SHA
+
+#ifdef __aarch64__
+__attribute__((target("+crypto")))
+#else
+__attribute__((target("fpu=crypto-neon-fp-armv8")))
+#endif
+static void Sha256_TransformBlocksArm(UInt32 *state, const Byte *data, size_t blocks)
+{
+  uint32x4_t state0 = vld1q_u32(&state[0]); /* ABCD */
+  uint32x4_t state1 = vld1q_u32(&state[4]); /* EFGH */
+
+  for (; blocks > 0; blocks--, data += 64)
+  {
+    uint32x4_t abcdSave = state0;
+    uint32x4_t efghSave = state1;
+    uint32x4_t w[4];
+    unsigned i;
+    for (i = 0; i < 4; i++)
+      w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+    for (i = 0; i < 16; i++)
+    {
+      uint32x4_t msg = vaddq_u32(w[i & 3], vld1q_u32(&K[i * 4]));
+      uint32x4_t abcd = state0;
+      state0 = vsha256hq_u32(state0, state1, msg);
+      state1 = vsha256h2q_u32(state1, abcd, msg);
+      if (i < 12)
+        w[i & 3] = vsha256su1q_u32(vsha256su0q_u32(w[i & 3], w[(i + 1) & 3]), w[(i + 2) & 3], w[(i + 3) & 3]);
+    }
+    state0 = vaddq_u32(state0, abcdSave);
+    state1 = vaddq_u32(state1, efghSave);
+  }
+
+  vst1q_u32(&state[0], state0);
+  vst1q_u32(&state[4], state1);
+}
+
+#endif
+
+typedef void (*Sha256_TransformBlocksFunc)(UInt32 *state, const Byte *data, size_t blocks);
+
+/* pick the hardware accelerated transform if the cpu supports it */
+static Sha256_TransformBlocksFunc Sha256_SelectTransformBlocks()
+{
+#ifdef SHA256_X86_SHA
+  unsigned int eax, ebx, ecx, edx;
+  if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_1) &&
+      __get_cpuid_max(0, 0) >= 7)
+  {
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    if (ebx & (1 << 29)) /* SHA */
+      return Sha256_TransformBlocksShaNi;
+  }
+#endif
+#ifdef SHA256_ARM_SHA
+#ifdef __aarch64__
+  if (getauxval(AT_HWCAP) & (1 << 6)) /* HWCAP_SHA2 */
+#else
+  if (getauxval(AT_HWCAP2) & (1 << 3)) /* HWCAP2_SHA2 */
+#endif
+    return Sha256_TransformBlocksArm;
+#endif
+  return Sha256_TransformBlocks;
+}
+
+static Sha256_TransformBlocksFunc Sha256_TransformBlocksImpl = Sha256_SelectTransformBlocks();
+
+bool_t Sha256::setAcceleration(bool_t enable)
+{
+  Sha256_TransformBlocksImpl = enable ? Sha256_SelectTransformBlocks() : Sha256_TransformBlocks;
+  return Sha256_TransformBlocksImpl != Sha256_TransformBlocks;
+}
+
+static void Sha256_WriteByteBlock(CSha256 *p)
+{
+  Sha256_TransformBlocksImpl(p->state, p->buffer, 1);
 }
 
 void Sha256::update(const Byte *data, unsigned int size)
 {
   CSha256 *p = this;
   UInt32 curBufferPos = (UInt32)p->count & 0x3F;
-  while (size > 0)
+  p->count += size;
+  if (curBufferPos > 0)
   {
-    p->buffer[curBufferPos++] = *data++;
-    p->count++;
-    size--;
-    if (curBufferPos == 64)
-    {
-      curBufferPos = 0;
-      Sha256_WriteByteBlock(p);
-    }
+    UInt32 n = 64 - curBufferPos;
+    if (n > size)
+      n = size;
+    Memory::copy(p->buffer + curBufferPos, data, n);
+    data += n;
+    size -= n;
+    curBufferPos += n;
+    if (curBufferPos < 64)
+      return;
+    Sha256_WriteByteBlock(p);
   }
+  if (size >= 64)
+  {
+    /* hash complete blocks without copying them into the buffer */
+    size_t blocks = size / 64;
+    Sha256_TransformBlocksImpl(p->state, data, blocks);
+    data += blocks * 64;
+    size -= (unsigned int)(blocks * 64);
+  }
+  if (size > 0)
+    Memory::copy(p->buffer, data, size);
 }
 
 void Sha256::finalize(byte_t (&digestBuf)[digestSize])
@@ -226,3 +377,46 @@ void Sha256::finalize(byte_t (&digestBuf)[digestSize])
   }
   reset();
 }
+
+Sha256::Hmac::Hmac(const byte_t* key, size_t keySize)
+{
+  byte_t hashKey[blockSize];
+  if(keySize > blockSize)
+  {
+    inner.update(key, keySize);
+    inner.finalize((byte_t (&)[digestSize])hashKey);
+    Memory::zero(hashKey + digestSize, blockSize - digestSize);
+  }
+  else
+  {
+    Memory::copy(hashKey, key, keySize);
+    if(keySize < blockSize)
+      Memory::zero(hashKey + keySize, blockSize - keySize);
+  }
+
+  byte_t oKeyPad[blockSize];
+  byte_t iKeyPad[blockSize];
+  for(unsigned int i = 0; i < blockSize; ++i)
+  {
+    oKeyPad[i] = hashKey[i] ^ 0x5c;
+    iKeyPad[i] = hashKey[i] ^ 0x36;
+  }
+  inner.update(iKeyPad, blockSize);
+  outer.update(oKeyPad, blockSize);
+}
+
+void_t Sha256::Hmac::sign(const byte_t* message, size_t messageSize, byte_t (&result)[digestSize]) const
+{
+  byte_t hash[digestSize];
+  Sha256 sha256(inner);
+  sha256.update(message, messageSize);
+  sha256.finalize(hash);
+  sha256 = outer;
+  sha256.update(hash, digestSize);
+  sha256.finalize(result);
+}
+
+void_t Sha256::hmac(const byte_t* key, size_t keySize, const byte_t* message, size_t messageSize, byte_t (&result)[digestSize])
+{
+  Hmac(key, keySize).sign(message, messageSize, result);
+}
@@ -27,41 +27,36 @@ public:
     sha256.finalize(result);
   }
 
-  static void_t hmac(const byte_t* key, size_t keySize, const byte_t* message, size_t messageSize, byte_t (&result)[digestSize])
-  {
-    Sha256 sha256;
-    byte_t hashKey[blockSize];
-    if(keySize > blockSize)
-    {
-      sha256.update(key, keySize);
-      sha256.finalize((byte_t (&)[digestSize])hashKey);
-      Memory::zero(hashKey + 32, 32);
-    }
-    else
-    {
-      Memory::copy(hashKey, key, keySize);
-      if(keySize < blockSize)
-        Memory::zero(hashKey + keySize, blockSize - keySize);
-    }
-    
-    byte_t oKeyPad[blockSize];
-    byte_t iKeyPad[blockSize];
-    for(int i = 0; i < 64; ++i)
-    {
-      oKeyPad[i] = hashKey[i] ^ 0x5c;
-      iKeyPad[i] = hashKey[i] ^ 0x36;
-    }
-    byte_t hash[digestSize];
-    sha256.update(iKeyPad, blockSize);
-    sha256.update(message, messageSize);
-    sha256.finalize(hash);
-    sha256.update(oKeyPad, blockSize);
-    sha256.update(hash, digestSize);
-    sha256.finalize(result);
-  }
+  class Hmac;
+
+  /**
+  * Selects the hardware accelerated transform if the cpu supports it (the default) or the portable one.
+  * This is meant for testing and must not be called while other threads are hashing.
+  * @param enable Whether the hardware accelerated transform should be used.
+  * @return \c true when a hardware accelerated transform is used
+  */
+  static bool_t setAcceleration(bool_t enable);
+
+  static void_t hmac(const byte_t* key, size_t keySize, const byte_t* message, size_t messageSize, byte_t (&result)[digestSize]);
 
 public: // TODO: private
   unsigned int state[8];
   unsigned long long count;
   unsigned char buffer[64];
 };
+
+/**
+* An HMAC-SHA256 context. The hash states after absorbing the inner and outer key pads are computed once
+* so that signing a message costs only the message blocks and two finalizations.
+*/
+class Sha256::Hmac
+{
+public:
+  Hmac(const byte_t* key, size_t keySize);
+
+  void_t sign(const byte_t* message, size_t messageSize, byte_t (&result)[digestSize]) const;
+
+private:
+  Sha256 inner;
+  Sha256 outer;
+};
@@ -0,0 +1,108 @@
+
+#include <nstd/Log.h>
+#include <nstd/Memory.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "Stats.h"
+
+void_t Stats::Histogram::clear()
+{
+  Memory::zero(counts, sizeof(counts));
+  count = 0;
+  max = 0;
+}
+
+int64_t Stats::Histogram::getPercentile(double percentile) const
+{
+  if(count == 0)
+    return 0;
+  uint64_t rank = (uint64_t)((double)count * percentile / 100.);
+  if(rank >= count)
+    rank = count - 1;
+  uint64_t seen = 0;
+  for(uint_t i = 0; i < numOfBuckets; ++i)
+  {
+    seen += counts[i];
+    if(seen > rank)
+    {
+      int64_t value = getBucketValue(i);
+      return value > max ? max : value;
+    }
+  }
+  return max;
+}
+
+uint_t Stats::Histogram::getMostSignificantBit(uint64_t value)
+{
+#if defined(__GNUC__)
+  return 63 - __builtin_clzll(value);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return index;
+#else
+  uint_t result = 0;
+  while(value >>= 1)
+    ++result;
+  return result;
+#endif
+}
+
+int64_t Stats::Histogram::getBucketValue(uint_t bucket)
+{
+  // the middle of the bucket
+  uint_t exponent = bucket / subBuckets;
+  if(exponent == 0)
+    return bucket;
+  uint64_t start = (uint64_t)(subBuckets + bucket % subBuckets) << (exponent - 1);
+  return (int64_t)(start + ((1ULL << (exponent - 1)) >> 1));
+}
+
+Stats::Histogram& Stats::addHistogram(const String& name)
+{
+  NamedHistogram& namedHistogram = histograms.append(NamedHistogram());
+  namedHistogram.name = name;
+  return namedHistogram.histogram;
+}
+
+void_t Stats::addCounter(const String& name, const uint64_t& counter)
+{
+  NamedCounter& namedCounter = counters.append(NamedCounter());
+  namedCounter.name = name;
+  namedCounter.counter = &counter;
+  namedCounter.lastValue = counter;
+}
+
+void_t Stats::log(int64_t now)
+{
+  if(lastLogTime != 0)
+  {
+    String line;
+    String entry;
+    for(List<NamedHistogram>::Iterator i = histograms.begin(), end = histograms.end(); i != end; ++i)
+    {
+      const Histogram& histogram = i->histogram;
+      if(histogram.getCount() == 0)
+        continue;
+      entry.printf("%s: n=%llu p50=%lldus p99=%lldus p999=%lldus max=%lldus; ", (const char_t*)i->name, histogram.getCount(),
+        histogram.getPercentile(50.), histogram.getPercentile(99.), histogram.getPercentile(99.9), histogram.getMax());
+      line += entry;
+    }
+    for(List<NamedCounter>::Iterator i = counters.begin(), end = counters.end(); i != end; ++i)
+    {
+      entry.printf("%s=%llu; ", (const char_t*)i->name, *i->counter - i->lastValue);
+      line += entry;
+    }
+    if(!line.isEmpty())
+      Log::infof("Stats over %lld s: %s", (now - lastLogTime) / 1000, (const char_t*)line);
+  }
+
+  for(List<NamedHistogram>::Iterator i = histograms.begin(), end = histograms.end(); i != end; ++i)
+    i->histogram.clear();
+  for(List<NamedCounter>::Iterator i = counters.begin(), end = counters.end(); i != end; ++i)
+    i->lastValue = *i->counter;
+  lastLogTime = now;
+}
@@ -0,0 +1,122 @@
+
+#pragma once
+
+#include <nstd/String.h>
+#include <nstd/List.h>
+
+/**
+* Collects latency histograms and counters of a process and writes a summary to the log in a fixed interval.
+* Recording a value is a few integer operations without allocations, so the statistics can stay enabled in production.
+*/
+class Stats
+{
+public:
+  /**
+  * A histogram of durations in microseconds with logarithmic buckets that are split into 16 linear sub buckets.
+  * The reported percentiles are off by at most 1/32 of the value.
+  */
+  class Histogram
+  {
+  public:
+    Histogram() {clear();}
+
+    void_t add(int64_t duration)
+    {
+      uint64_t value = duration < 0 ? 0 : (uint64_t)duration;
+      if(value > maxValue)
+        value = maxValue;
+      ++counts[getBucket(value)];
+      ++count;
+      if((int64_t)value > max)
+        max = (int64_t)value;
+    }
+
+    void_t clear();
+
+    uint64_t getCount() const {return count;}
+    int64_t getMax() const {return max;}
+
+    /**
+    * @param percentile The percentile in the range 0 to 100.
+    * @return The value below which the given percentage of the recorded values lies.
+    */
+    int64_t getPercentile(double percentile) const;
+
+  private:
+    static const uint_t subBucketBits = 4;
+    static const uint_t subBuckets = 1 << subBucketBits;
+    static const uint_t valueBits = 40; // about 12 days in microseconds
+    static const uint64_t maxValue = (1ULL << valueBits) - 1;
+    static const uint_t numOfBuckets = (valueBits - subBucketBits + 1) * subBuckets;
+
+  private:
+    uint32_t counts[numOfBuckets];
+    uint64_t count;
+    int64_t max;
+
+  private:
+    static uint_t getBucket(uint64_t value)
+    {
+      if(value < subBuckets)
+        return (uint_t)value;
+      uint_t exponent = getMostSignificantBit(value) - subBucketBits + 1;
+      return exponent * subBuckets + (uint_t)((value >> (exponent - 1)) & (subBuckets - 1));
+    }
+
+    static uint_t getMostSignificantBit(uint64_t value);
+    static int64_t getBucketValue(uint_t bucket);
+  };
+
+public:
+  /**
+  * @param interval The time in milliseconds between two summaries.
+  */
+  Stats(int64_t interval = 60 * 1000) : interval(interval), lastLogTime(0) {}
+
+  /**
+  * Creates a histogram that is included in the summary.
+  * @param name The name of the histogram in the summary.
+  * @return The histogram. It stays valid as long as the statistics object exists.
+  */
+  Histogram& addHistogram(const String& name);
+
+  /**
+  * Includes an external counter in the summary. The summary shows how much the counter has grown since the previous summary.
+  * @param name The name of the counter in the summary.
+  * @param counter The counter. It has to stay valid as long as the statistics object exists.
+  */
+  void_t addCounter(const String& name, const uint64_t& counter);
+
+  /**
+  * Writes the summary to the log and clears the histograms when the interval has elapsed.
+  * @param now The current time in milliseconds.
+  */
+  void_t check(int64_t now)
+  {
+    if(now - lastLogTime >= interval)
+      log(now);
+  }
+
+private:
+  struct NamedHistogram
+  {
+    String name;
+    Histogram histogram;
+  };
+
+  struct NamedCounter
+  {
+    String name;
+    const uint64_t* counter;
+    uint64_t lastValue;
+  };
+
+private:
+  int64_t interval;
+  int64_t lastLogTime;
+  List<NamedHistogram> histograms;
+  List<NamedCounter> counters;
+
+private:
+  void_t log(int64_t now);
+};
@@ -0,0 +1,160 @@
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#endif
+
+#include "TradeRing.h"
+
+static const uint32_t ringMagic = 0x54524431; // "TRD1"
+static const uint32_t ringCapacity = 4096; // a power of two
+static const uint32_t ringMargin = ringCapacity / 8;
+
+bool_t TradeRing::open(const String& channelName, bool_t create)
+{
+  close();
+
+#ifdef _WIN32
+  return false;
+#else
+  String name("/meguco-trades-");
+  for(const char_t* p = channelName; *p; ++p)
+    name.append(*p == '/' ? '-' : *p);
+  int fd = shm_open(name, create ? O_RDWR | O_CREAT : O_RDWR, 0600);
+  if(fd < 0)
+    return false;
+  size_t size = sizeof(Header) + sizeof(Slot) * ringCapacity;
+  struct stat st;
+  if(fstat(fd, &st) != 0 || ((size_t)st.st_size != size && (!create || ftruncate(fd, size) != 0)))
+  {
+    ::close(fd);
+    return false;
+  }
+  void_t* data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(data == MAP_FAILED)
+    return false;
+  Header* header = (Header*)data;
+  if(__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != ringMagic)
+  {
+    if(!create)
+    {
+      munmap(data, size);
+      return false;
+    }
+    // a new ring is zeroed by ftruncate, a restarted writer continues at the head of the existing ring
+    header->capacity = ringCapacity;
+    __atomic_store_n(&header->magic, ringMagic, __ATOMIC_RELEASE);
+  }
+  else if(header->capacity != ringCapacity)
+  {
+    munmap(data, size);
+    return false;
+  }
+  if(create)
+    __atomic_store_n(&header->writerPid, (uint32_t)getpid(), __ATOMIC_RELEASE);
+  this->header = header;
+  this->slots = (Slot*)(header + 1);
+  this->size = size;
+  if(!create && !isWriterAlive())
+  {
+    close();
+    return false;
+  }
+  return true;
+#endif
+}
+
+void_t TradeRing::close()
+{
+#ifndef _WIN32
+  if(header)
+  {
+    munmap(header, size);
+    header = 0;
+    slots = 0;
+  }
+#endif
+}
+
+void_t TradeRing::publish(const meguco_trade_entity& trade)
+{
+#ifndef _WIN32
+  uint64_t position = header->head;
+  Slot& slot = slots[position & (ringCapacity - 1)];
+  __atomic_store_n(&slot.sequence, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  slot.trade = trade;
+  __atomic_store_n(&slot.sequence, position + 1, __ATOMIC_RELEASE);
+  __atomic_store_n(&header->head, position + 1, __ATOMIC_RELEASE);
+
+  // wake up waiting readers
+  __atomic_add_fetch(&header->futex, 1, __ATOMIC_SEQ_CST);
+  if(__atomic_load_n(&header->waiters, __ATOMIC_SEQ_CST) != 0)
+    syscall(SYS_futex, &header->futex, FUTEX_WAKE, 0x7fffffff, 0, 0, 0);
+#endif
+}
+
+uint64_t TradeRing::getTail() const
+{
+  uint64_t head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+  return head > ringCapacity - ringMargin ? head - (ringCapacity - ringMargin) : 0;
+}
+
+TradeRing::Result TradeRing::read(uint64_t& position, meguco_trade_entity& trade) const
+{
+  uint64_t head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+  if(position >= head)
+    return empty;
+  if(head - position > ringCapacity)
+    return overrun;
+  const Slot& slot = slots[position & (ringCapacity - 1)];
+  uint64_t sequence = __atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE);
+  if(sequence != position + 1)
+    return overrun;
+  trade = slot.trade;
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if(__atomic_load_n(&slot.sequence, __ATOMIC_RELAXED) != sequence)
+    return overrun;
+  ++position;
+  return ok;
+}
+
+void_t TradeRing::wait(uint64_t position, int64_t timeout) const
+{
+#ifndef _WIN32
+  uint32_t futex = __atomic_load_n(&header->futex, __ATOMIC_SEQ_CST);
+  if(__atomic_load_n(&header->head, __ATOMIC_ACQUIRE) > position)
+    return;
+  timespec ts;
+  ts.tv_sec = timeout / 1000;
+  ts.tv_nsec = (timeout % 1000) * 1000000L;
+  __atomic_add_fetch(&header->waiters, 1, __ATOMIC_SEQ_CST);
+  syscall(SYS_futex, &header->futex, FUTEX_WAIT, futex, &ts, 0, 0);
+  __atomic_sub_fetch(&header->waiters, 1, __ATOMIC_SEQ_CST);
+#endif
+}
+
+void_t TradeRing::interrupt() const
+{
+#ifndef _WIN32
+  syscall(SYS_futex, &header->futex, FUTEX_WAKE, 0x7fffffff, 0, 0, 0);
+#endif
+}
+
+bool_t TradeRing::isWriterAlive() const
+{
+#ifdef _WIN32
+  return false;
+#else
+  pid_t pid = (pid_t)__atomic_load_n(&header->writerPid, __ATOMIC_ACQUIRE);
+  return pid != 0 && (kill(pid, 0) == 0 || errno == EPERM);
+#endif
+}
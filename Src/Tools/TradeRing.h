@@ -0,0 +1,94 @@
+
+#pragma once
+
+#include <nstd/String.h>
+
+#include <megucoprotocol.h>
+
+/**
+* A ring buffer in shared memory that passes the trades of a market from the market process to the bot processes on
+* the same host. The ring has one writer and any number of readers. The writer never waits for the readers, so a reader
+* that falls behind by more than the capacity of the ring is overrun and has to load the missed trades from zlimdb.
+*/
+class TradeRing
+{
+public:
+  enum Result
+  {
+    ok,
+    empty,
+    overrun,
+  };
+
+public:
+  TradeRing() : header(0), slots(0), size(0) {}
+  ~TradeRing() {close();}
+
+  /**
+  * Maps the ring of a market.
+  * @param channelName The channel name of the market, e.g. "Bitstamp/BTC/USD".
+  * @param create Whether the ring is created when it does not exist. Only the writer creates the ring.
+  * @return \c false when the ring does not exist or could not be mapped
+  */
+  bool_t open(const String& channelName, bool_t create);
+  void_t close();
+  bool_t isOpen() const {return header != 0;}
+
+  /**
+  * Passes a trade on to the readers. This must only be called by the one writer of the ring.
+  */
+  void_t publish(const meguco_trade_entity& trade);
+
+  /**
+  * @return The position of the oldest trade that can safely be read. A margin of the ring is left to the writer.
+  */
+  uint64_t getTail() const;
+
+  /**
+  * Reads the trade at a position of the ring.
+  * @param position The position. It is advanced when a trade was read.
+  * @param trade Receives the trade.
+  * @return \c ok when a trade was read, \c empty when no trade was published at the position yet or \c overrun when the
+  *         trade at the position has already been overwritten
+  */
+  Result read(uint64_t& position, meguco_trade_entity& trade) const;
+
+  /**
+  * Waits until a trade is published at a position of the ring.
+  * @param position The position.
+  * @param timeout The maximum time to wait in milliseconds.
+  */
+  void_t wait(uint64_t position, int64_t timeout) const;
+
+  /**
+  * Wakes up all readers that are waiting for a trade.
+  */
+  void_t interrupt() const;
+
+  /**
+  * @return \c true when the process that publishes trades in the ring is running
+  */
+  bool_t isWriterAlive() const;
+
+private:
+  struct Header
+  {
+    uint32_t magic;
+    uint32_t capacity;
+    uint64_t head;
+    uint32_t futex;
+    uint32_t waiters;
+    uint32_t writerPid;
+  };
+
+  struct Slot
+  {
+    uint64_t sequence;
+    meguco_trade_entity trade;
+  };
+
+private:
+  Header* header;
+  Slot* slots;
+  size_t size;
+};
@@ -7,6 +7,8 @@
 
 #include "ZlimdbConnection.h"
 
+static const size_t querySize = sizeof(zlimdb_header) + sizeof(uint32_t) + sizeof(uint8_t) * 2 + sizeof(uint64_t); // the approximate size of a query or subscribe request
+
 static class ZlimdbFramework
 {
 public:
@@ -49,31 +51,31 @@ void_t ZlimdbConnection::setErrno(int_t error) {zlimdb_seterrno(error);}
 
 bool_t ZlimdbConnection::subscribe(uint32_t tableId, uint8_t flags)
 {
-  if(zlimdb_subscribe(zdb, tableId, zlimdb_query_type_all, 0, flags) != 0)
+  if(!sent(zlimdb_subscribe(zdb, tableId, zlimdb_query_type_all, 0, flags), querySize, 0))
     return false;
   return true;
 }
 
 bool_t ZlimdbConnection::subscribe(uint32_t tableId, zlimdb_query_type type, uint64_t param, uint8_t flags)
 {
-  if(zlimdb_subscribe(zdb, tableId, type, param, flags) != 0)
+  if(!sent(zlimdb_subscribe(zdb, tableId, type, param, flags), querySize, 0))
     return false;
   return true;
 }
 
 bool_t ZlimdbConnection::unsubscribe(uint32_t tableId)
 {
-  if(zlimdb_unsubscribe(zdb, tableId) != 0)
+  if(!sent(zlimdb_unsubscribe(zdb, tableId), sizeof(zlimdb_header) + sizeof(uint32_t), sizeof(zlimdb_header)))
     return false;
   return true;
 }
 
 bool_t ZlimdbConnection::listen(uint32_t tableId)
 {
-  if(zlimdb_subscribe(zdb, tableId, zlimdb_query_type_since_next, 0, zlimdb_subscribe_flag_responder) != 0)
+  if(!sent(zlimdb_subscribe(zdb, tableId, zlimdb_query_type_since_next, 0, zlimdb_subscribe_flag_responder), querySize, 0))
     return false;
   byte_t buffer[ZLIMDB_MAX_MESSAGE_SIZE];
-  while(zlimdb_get_response(zdb, (zlimdb_header*)buffer, ZLIMDB_MAX_MESSAGE_SIZE) == 0);
+  while(getResponse(buffer));
   if(zlimdb_errno() != 0)
     return false;
   return true;
@@ -81,14 +83,21 @@ bool_t ZlimdbConnection::listen(uint32_t tableId)
 
 bool_t ZlimdbConnection::sync(uint32_t tableId, int64_t& serverTime, int64_t& tableTime)
 {
-  if(zlimdb_sync(zdb, tableId, &serverTime, &tableTime) != 0)
+  if(!sent(zlimdb_sync(zdb, tableId, &serverTime, &tableTime), sizeof(zlimdb_header) + sizeof(uint32_t), sizeof(zlimdb_header) + sizeof(int64_t) * 2))
     return false;
   return true;
 }
 
 bool_t ZlimdbConnection::query(uint32_t tableId)
 {
-  if(zlimdb_query(zdb, tableId, zlimdb_query_type_all, 0) != 0)
+  if(!sent(zlimdb_query(zdb, tableId, zlimdb_query_type_all, 0), querySize, 0))
+    return false;
+  return true;
+}
+
+bool_t ZlimdbConnection::query(uint32_t tableId, zlimdb_query_type type, uint64_t param)
+{
+  if(!sent(zlimdb_query(zdb, tableId, type, param), querySize, 0))
     return false;
   return true;
 }
@@ -97,6 +106,7 @@ bool_t ZlimdbConnection::getResponse(byte_t (&buffer)[ZLIMDB_MAX_MESSAGE_SIZE])
 {
   if(zlimdb_get_response(zdb, (zlimdb_header*)buffer, ZLIMDB_MAX_MESSAGE_SIZE) != 0)
     return false;
+  received(((const zlimdb_header*)buffer)->size);
   return true;
 }
 /*
@@ -115,28 +125,28 @@ bool_t ZlimdbConnection::queryEntity(uint32_t tableId, uint64_t entityId, byte_t
 */
 bool_t ZlimdbConnection::queryEntity(uint32_t tableId, uint64_t entityId, zlimdb_entity& entity, size_t minSize, size_t maxSize)
 {
-  if(zlimdb_query_entity(zdb, tableId, entityId, &entity, minSize, maxSize) != 0)
+  if(!sent(zlimdb_query_entity(zdb, tableId, entityId, &entity, minSize, maxSize), querySize, sizeof(zlimdb_header) + entity.size))
     return false;
   return true;
 }
 
 bool_t ZlimdbConnection::createTable(const String& name, uint32_t& tableId)
 {
-  if(zlimdb_add_table(zdb, name, &tableId) != 0)
+  if(!sent(zlimdb_add_table(zdb, name, &tableId), sizeof(zlimdb_header) + sizeof(uint32_t) + sizeof(zlimdb_entity) + name.length(), sizeof(zlimdb_header) + sizeof(uint64_t)))
     return false;
   return true;
 }
 
 bool_t ZlimdbConnection::findTable(const String& name, uint32_t& tableId)
 {
-  if(zlimdb_find_table(zdb, name, &tableId) != 0)
+  if(!sent(zlimdb_find_table(zdb, name, &tableId), sizeof(zlimdb_header) + name.length(), sizeof(zlimdb_header) + sizeof(uint32_t)))
     return false;
   return true;
 }
 
 bool_t ZlimdbConnection::copyTable(uint32_t sourceTableId, const String& name, uint32_t& tableId)
 {
-  if(zlimdb_copy_table(zdb, sourceTableId, name, &tableId) != 0)
+  if(!sent(zlimdb_copy_table(zdb, sourceTableId, name, &tableId), sizeof(zlimdb_header) + sizeof(uint32_t) + name.length(), sizeof(zlimdb_header) + sizeof(uint32_t)))
     return false;
   return true;
 }
@@ -144,30 +154,30 @@ bool_t ZlimdbConnection::copyTable(uint32_t sourceTableId, const String& name, u
 bool_t ZlimdbConnection::moveTable(const String& sourceName, uint32_t destTableId, bool succeedIfNotExist)
 {
   uint32_t sourceTableId;
-  if(zlimdb_find_table(zdb, sourceName, &sourceTableId) != 0)
+  if(!sent(zlimdb_find_table(zdb, sourceName, &sourceTableId), sizeof(zlimdb_header) + sourceName.length(), sizeof(zlimdb_header) + sizeof(uint32_t)))
   {
     if(succeedIfNotExist && zlimdb_errno() == zlimdb_error_table_not_found)
       return true;
     return false;
   }
-  if(zlimdb_rename_table_replace(zdb, sourceTableId, destTableId) != 0)
+  if(!sent(zlimdb_rename_table_replace(zdb, sourceTableId, destTableId), sizeof(zlimdb_header) + sizeof(uint32_t) * 2, sizeof(zlimdb_header)))
     return false;
   return true;
 }
 
 bool_t ZlimdbConnection::clearTable(uint32_t tableId)
 {
-  if(zlimdb_clear(zdb, tableId) != 0)
+  if(!sent(zlimdb_clear(zdb, tableId), sizeof(zlimdb_header) + sizeof(uint32_t), sizeof(zlimdb_header)))
     return false;
   return true;
 }
 
 bool_t ZlimdbConnection::add(uint32_t tableId, const zlimdb_entity& entity, uint64_t& id, bool_t succeedIfExists)
 {
-  if(zlimdb_add(zdb, tableId, &entity, &id) != 0)
+  if(!sent(zlimdb_add(zdb, tableId, &entity, &id), sizeof(zlimdb_add_request) + entity.size, sizeof(zlimdb_header) + sizeof(uint64_t)))
   {
     if (succeedIfExists && zlimdb_errno() == zlimdb_error_entity_id)
-      return true;
+      return id = 0, true;
     return false;
   }
   return true;
@@ -175,22 +185,23 @@ bool_t ZlimdbConnection::add(uint32_t tableId, const zlimdb_entity& entity, uint
 
 bool_t ZlimdbConnection::update(uint32_t tableId, const zlimdb_entity& entity)
 {
-  if(zlimdb_update(zdb, tableId, &entity) != 0)
+  if(!sent(zlimdb_update(zdb, tableId, &entity), sizeof(zlimdb_update_request) + entity.size, sizeof(zlimdb_header)))
     return false;
   return true;
 }
 
 bool_t ZlimdbConnection::remove(uint32_t tableId, uint64_t entityId)
 {
-  if(zlimdb_remove(zdb, tableId, entityId) != 0)
+  if(!sent(zlimdb_remove(zdb, tableId, entityId), sizeof(zlimdb_remove_request), sizeof(zlimdb_header)))
     return false;
   return true;
 }
 
 bool_t ZlimdbConnection::control(uint32_t tableId, uint64_t entityId, uint32_t controlCode, const void_t* data, uint32_t size, byte_t(&buffer)[ZLIMDB_MAX_MESSAGE_SIZE])
 {
-  if(zlimdb_control(zdb, tableId, entityId, controlCode, data, size, (zlimdb_header*)buffer, ZLIMDB_MAX_MESSAGE_SIZE) != 0)
+  if(!sent(zlimdb_control(zdb, tableId, entityId, controlCode, data, size, (zlimdb_header*)buffer, ZLIMDB_MAX_MESSAGE_SIZE), sizeof(zlimdb_control_request) + size, 0))
     return false;
+  received(((const zlimdb_header*)buffer)->size);
   return true;
 }
 
@@ -204,29 +215,31 @@ bool_t ZlimdbConnection::startProcess(uint32_t tableId, const String& command)
     zlimdb_seterrno(zlimdb_local_error_invalid_parameter);
     return false;
   }
-  if(zlimdb_control(zdb, tableId, 0, meguco_process_control_start, process, process->entity.size, (zlimdb_header*)buffer, ZLIMDB_MAX_MESSAGE_SIZE) != 0)
+  if(!sent(zlimdb_control(zdb, tableId, 0, meguco_process_control_start, process, process->entity.size, (zlimdb_header*)buffer, ZLIMDB_MAX_MESSAGE_SIZE), sizeof(zlimdb_control_request) + process->entity.size, 0))
     return false;
+  received(((const zlimdb_header*)buffer)->size);
   return true;
 }
 
 bool_t ZlimdbConnection::stopProcess(uint32_t tableId, uint64_t entityId)
 {
   char buffer[ZLIMDB_MAX_MESSAGE_SIZE];
-  if(zlimdb_control(zdb, tableId, entityId, meguco_process_control_stop, 0, 0, (zlimdb_header*)buffer, ZLIMDB_MAX_MESSAGE_SIZE) != 0)
+  if(!sent(zlimdb_control(zdb, tableId, entityId, meguco_process_control_stop, 0, 0, (zlimdb_header*)buffer, ZLIMDB_MAX_MESSAGE_SIZE), sizeof(zlimdb_control_request), 0))
     return false;
+  received(((const zlimdb_header*)buffer)->size);
   return true;
 }
 
 bool_t ZlimdbConnection::sendControlResponse(uint32_t requestId, const byte_t* data, size_t size)
 {
-  if(zlimdb_control_respond(zdb, requestId, data, size) != 0)
+  if(!sent(zlimdb_control_respond(zdb, requestId, data, size), sizeof(zlimdb_header) + size, 0))
     return false;
   return true;
 }
 
 bool_t ZlimdbConnection::sendControlResponse(uint32_t requestId, uint16_t error)
 {
-  if(zlimdb_control_respond_error(zdb, requestId, error) != 0)
+  if(!sent(zlimdb_control_respond_error(zdb, requestId, error), sizeof(zlimdb_header) + sizeof(uint16_t), 0))
     return false;
   return true;
 }
@@ -247,6 +260,20 @@ bool_t ZlimdbConnection::process()
     }
 }
 
+bool_t ZlimdbConnection::process(uint_t timeout)
+{
+  if(zlimdb_exec(zdb, timeout))
+    switch(zlimdb_errno())
+    {
+    case zlimdb_local_error_interrupted:
+    case zlimdb_local_error_timeout:
+      return true;
+    default:
+      return false;
+    }
+  return true;
+}
+
 void_t ZlimdbConnection::interrupt()
 {
   zlimdb_interrupt(zdb);
@@ -264,8 +291,26 @@ String ZlimdbConnection::getErrorString()
   }
 }
 
+bool_t ZlimdbConnection::sent(int_t result, size_t size, size_t responseSize)
+{
+  ++counters.sentMessages;
+  counters.sentBytes += size;
+  if(result != 0)
+    return false;
+  if(responseSize)
+    received(responseSize);
+  return true;
+}
+
+void_t ZlimdbConnection::received(size_t size)
+{
+  ++counters.receivedMessages;
+  counters.receivedBytes += size;
+}
+
 void ZlimdbConnection::zlimdbCallback(const zlimdb_header& message)
 {
+  received(message.size);
   switch(message.message_type)
   {
   case zlimdb_message_add_request:
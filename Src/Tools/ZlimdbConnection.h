@@ -17,8 +17,24 @@ public:
     virtual void_t controlEntity(uint32_t tableId, uint32_t requestId, uint64_t entityId, uint32_t controlCode, const byte_t* data, size_t size) = 0;
   };
 
+  /**
+  * Counts the messages that were exchanged with the zlimdb server and their sizes in bytes. The client library does
+  * not report the sizes of the requests it sends and of the responses it waits for, so these are approximated.
+  */
+  struct Counters
+  {
+    uint64_t sentMessages;
+    uint64_t sentBytes;
+    uint64_t receivedMessages;
+    uint64_t receivedBytes;
+  };
+
 public:
-  ZlimdbConnection() : zdb(0) {}
+  ZlimdbConnection() : zdb(0)
+  {
+    counters.sentMessages = counters.sentBytes = 0;
+    counters.receivedMessages = counters.receivedBytes = 0;
+  }
   ~ZlimdbConnection() {close();}
 
   bool_t connect(Callback& callback);
@@ -31,6 +47,7 @@ public:
   bool_t listen(uint32_t tableId);
   bool_t sync(uint32_t tableId, int64_t& serverTime, int64_t& tableTime);
   bool_t query(uint32_t tableId);
+  bool_t query(uint32_t tableId, zlimdb_query_type type, uint64_t param);
   bool_t getResponse(byte_t (&buffer)[ZLIMDB_MAX_MESSAGE_SIZE]);
   bool_t queryEntity(uint32_t tableId, uint64_t entityId, zlimdb_entity& entity, size_t minSize, size_t maxSize);
   bool_t createTable(const String& name, uint32_t& tableId);
@@ -38,6 +55,15 @@ public:
   bool_t copyTable(uint32_t sourceTableId, const String& name, uint32_t& tableId);
   bool_t moveTable(const String& sourceName, uint32_t destTableId, bool succeedIfNotExist = false);
   bool_t clearTable(uint32_t tableId);
+
+  /**
+  * Adds an entity to a table.
+  * @param tableId The table.
+  * @param entity The entity. Its id is assigned by the server if it is 0.
+  * @param id Receives the id of the added entity or 0 if \c succeedIfExists is set and the table already contained an entity with the same id.
+  * @param succeedIfExists Whether adding an entity whose id is already used succeeds without adding it.
+  * @return \c false when the entity could not be added
+  */
   bool_t add(uint32_t tableId, const zlimdb_entity& entity, uint64_t& id, bool_t succeedIfExists = false);
   bool_t update(uint32_t tableId, const zlimdb_entity& entity);
   bool_t remove(uint32_t tableId, uint64_t entityId);
@@ -50,8 +76,18 @@ public:
   bool_t sendControlResponse(uint32_t requestId, uint16_t error);
 
   bool_t process();
+
+  /**
+  * Handles incoming messages until the connection is interrupted or the timeout has elapsed.
+  * @param timeout The timeout in milliseconds.
+  * @return \c false when the connection was lost
+  */
+  bool_t process(uint_t timeout);
+
   void_t interrupt();
 
+  const Counters& getCounters() const {return counters;}
+
 public:
   static int_t getErrno();
   static void_t setErrno(int_t error);
@@ -112,8 +148,19 @@ public:
 private:
   zlimdb* zdb;
   Callback* callback;
+  Counters counters;
 
 private:
+  /**
+  * Counts a request that was sent with a call of the client library and, if the call waited for it, its response.
+  * @param result The result of the client library call.
+  * @param size The size of the request.
+  * @param responseSize The size of the response or 0 when the call does not wait for one.
+  * @return \c true when the call succeeded
+  */
+  bool_t sent(int_t result, size_t size, size_t responseSize);
+  void_t received(size_t size);
+
   void zlimdbCallback(const zlimdb_header& message);
 
 private: